@@ -0,0 +1,489 @@
+// clang++ ../LoopScheduler/*.cpp benchmark.cpp -o Build/benchmark --std=c++20 -pthread -O2 && ./Build/benchmark --help
+// Non-interactive benchmark, sweeps the parameters and writes CSV or JSON results.
+
+#include "../LoopScheduler/LoopScheduler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+volatile int WorkSink;
+
+void WorkUnit()
+{
+    for (int i = 0; i < 100; i++)
+        WorkSink = i; // Prevents optimizing the work away
+}
+
+void Work(int WorkAmount)
+{
+    for (int i = 0; i < WorkAmount; i++)
+        WorkUnit();
+}
+
+class WorkingModule : public LoopScheduler::Module
+{
+public:
+    WorkingModule(int WorkAmount);
+protected:
+    virtual void OnRun() override;
+    int WorkAmount;
+};
+
+WorkingModule::WorkingModule(int WorkAmount)
+    : WorkAmount(WorkAmount)
+{}
+
+void WorkingModule::OnRun()
+{
+    Work(WorkAmount);
+}
+
+class StopperWorkingModule : public LoopScheduler::Module
+{
+public:
+    StopperWorkingModule(int WorkAmount, int IterationsCountLimit);
+protected:
+    virtual void OnRun() override;
+    int WorkAmount;
+    int IterationsCount;
+    int IterationsCountLimit;
+};
+
+StopperWorkingModule::StopperWorkingModule(int WorkAmount, int IterationsCountLimit)
+    : WorkAmount(WorkAmount), IterationsCount(0), IterationsCountLimit(IterationsCountLimit)
+{}
+
+void StopperWorkingModule::OnRun()
+{
+    IterationsCount++;
+    Work(WorkAmount);
+    if (IterationsCount >= IterationsCountLimit) // Will stop after this iteration
+        GetLoop()->Stop();
+}
+
+class Options
+{
+public:
+    std::vector<std::string> Groups = { "parallel", "sequential" };
+    std::vector<int> ThreadCounts = { 1, 2, 4 };
+    std::vector<int> ModuleCounts = { 4 };
+    std::vector<int> WorkAmounts = { 0, 100, 1000 };
+    int IterationsCount = 1000;
+    int Repeats = 3;
+    std::string Executor = "default";
+    std::string Format = "csv";
+    std::string Output;
+    /// @brief Fails (exit code 1) if the efficiency of any result is lower. Not checked if 0.
+    double MinEfficiency = 0;
+
+    void Set(const std::string& Key, const std::string& Value);
+};
+
+class Result
+{
+public:
+    std::string Group;
+    std::string Executor;
+    int ThreadsCount;
+    int ModulesCount;
+    int WorkAmount;
+    int IterationsCount;
+    double WorkTime;
+    double LoopSchedulerTime;
+    double BaselineTime;
+    double Efficiency;
+    double LoopSchedulerIterationsPerSecond;
+    double BaselineIterationsPerSecond;
+    double OverheadPerRun;
+};
+
+std::vector<std::string> split(const std::string& Value)
+{
+    std::vector<std::string> result;
+    std::stringstream stream(Value);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (!item.empty())
+            result.push_back(item);
+    return result;
+}
+
+std::vector<int> split_ints(const std::string& Value)
+{
+    std::vector<int> result;
+    for (auto& item : split(Value))
+        result.push_back(std::stoi(item));
+    return result;
+}
+
+void Options::Set(const std::string& Key, const std::string& Value)
+{
+    if (Key == "groups")
+        Groups = split(Value);
+    else if (Key == "threads")
+        ThreadCounts = split_ints(Value);
+    else if (Key == "modules")
+        ModuleCounts = split_ints(Value);
+    else if (Key == "work")
+        WorkAmounts = split_ints(Value);
+    else if (Key == "iterations")
+        IterationsCount = std::stoi(Value);
+    else if (Key == "repeats")
+        Repeats = std::stoi(Value);
+    else if (Key == "executor")
+        Executor = Value;
+    else if (Key == "format")
+        Format = Value;
+    else if (Key == "output")
+        Output = Value;
+    else if (Key == "min-efficiency")
+        MinEfficiency = std::stod(Value);
+    else
+        throw std::invalid_argument("Unknown option: " + Key);
+}
+
+/// @brief Reads a flat JSON object with number, string, or array values, like {"threads": [1, 2], "format": "json"}.
+void read_config(const std::string& Filename, Options& Output)
+{
+    std::ifstream file(Filename);
+    if (!file)
+        throw std::invalid_argument("Cannot open the config file: " + Filename);
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t i = 0;
+    const auto skip_spaces = [&] {
+        while (i < text.size() && std::isspace((unsigned char)text[i]))
+            i++;
+    };
+    const auto expect = [&](char c) {
+        skip_spaces();
+        if (i >= text.size() || text[i] != c)
+            throw std::invalid_argument(std::string("Invalid config file, expected '") + c + "'.");
+        i++;
+    };
+    const auto read_scalar = [&] {
+        skip_spaces();
+        std::string result;
+        if (i < text.size() && text[i] == '"')
+        {
+            i++;
+            while (i < text.size() && text[i] != '"')
+                result += text[i++];
+            expect('"');
+        }
+        else
+        {
+            while (i < text.size() && text[i] != ',' && text[i] != ']' && text[i] != '}' && !std::isspace((unsigned char)text[i]))
+                result += text[i++];
+        }
+        return result;
+    };
+
+    expect('{');
+    skip_spaces();
+    if (i < text.size() && text[i] == '}')
+        return;
+    while (true)
+    {
+        std::string key = read_scalar();
+        expect(':');
+        skip_spaces();
+        std::string value;
+        if (i < text.size() && text[i] == '[')
+        {
+            i++;
+            skip_spaces();
+            while (i < text.size() && text[i] != ']')
+            {
+                if (!value.empty())
+                    value += ',';
+                value += read_scalar();
+                skip_spaces();
+                if (i < text.size() && text[i] == ',')
+                    i++;
+                skip_spaces();
+            }
+            expect(']');
+        }
+        else
+        {
+            value = read_scalar();
+        }
+        Output.Set(key, value);
+        skip_spaces();
+        if (i < text.size() && text[i] == ',')
+        {
+            i++;
+            continue;
+        }
+        expect('}');
+        return;
+    }
+}
+
+void print_help()
+{
+    std::cout << "Runs the benchmarks for every combination of the parameters.\n"
+              << "Options (lists are comma-separated):\n"
+              << "  --groups <list>          Groups to benchmark: parallel, sequential. Default: parallel,sequential\n"
+              << "  --threads <list>         Loop threads counts. Default: 1,2,4\n"
+              << "  --modules <list>         Modules counts. Default: 4\n"
+              << "  --work <list>            Work amounts per module run, in units of 100 loop iterations. Default: 0,100,1000\n"
+              << "  --iterations <n>         Loop iterations per run. Default: 1000\n"
+              << "  --repeats <n>            Runs per combination, the median is reported. Default: 3\n"
+              << "  --executor <name>        Loop executor: default, work-stealing. Default: default\n"
+              << "  --format <name>          Output format: csv, json. Default: csv\n"
+              << "  --output <file>          Output file. Default: standard output\n"
+              << "  --min-efficiency <x>     Exits with 1 if an efficiency is lower than x. Default: not checked\n"
+              << "  --config <file>          Reads the options from a flat JSON object, like {\"threads\": [1, 2]}\n"
+              << "\n"
+              << "The baseline for ParallelGroup is the calling thread and raw std::threads running the modules' work without scheduling,\n"
+              << "and for SequentialGroup a simple loop in 1 thread.\n"
+              << "efficiency = baseline_time / loopscheduler_time\n"
+              << "overhead_per_run = (loopscheduler_time - baseline_time) * parallelism / module runs\n";
+}
+
+double median(std::vector<double> Values)
+{
+    std::sort(Values.begin(), Values.end());
+    size_t n = Values.size();
+    return n % 2 == 1 ? Values[n / 2] : (Values[n / 2 - 1] + Values[n / 2]) / 2;
+}
+
+double measure_work_time(int WorkAmount)
+{
+    constexpr int repeats = 100;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+        Work(WorkAmount);
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return duration.count() / repeats;
+}
+
+double run_loopscheduler(const std::string& GroupName, LoopScheduler::Loop::ExecutorType Executor,
+                         int ThreadsCount, int ModulesCount, int WorkAmount, int IterationsCount)
+{
+    std::shared_ptr<LoopScheduler::Group> group;
+    if (GroupName == "parallel")
+    {
+        std::vector<LoopScheduler::ParallelGroupMember> members;
+        members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<StopperWorkingModule>(WorkAmount, IterationsCount)));
+        for (int i = 1; i < ModulesCount; i++)
+            members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<WorkingModule>(WorkAmount)));
+        group = std::make_shared<LoopScheduler::ParallelGroup>(members);
+    }
+    else
+    {
+        std::vector<LoopScheduler::SequentialGroupMember> members;
+        members.push_back(std::make_shared<StopperWorkingModule>(WorkAmount, IterationsCount));
+        for (int i = 1; i < ModulesCount; i++)
+            members.push_back(std::make_shared<WorkingModule>(WorkAmount));
+        group = std::make_shared<LoopScheduler::SequentialGroup>(members);
+    }
+    LoopScheduler::Loop loop(group, Executor);
+
+    auto start = std::chrono::steady_clock::now();
+    loop.Run(ThreadsCount);
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return duration.count();
+}
+
+/// @return The baseline time and its parallelism.
+std::pair<double, int> run_baseline(const std::string& GroupName, int ThreadsCount, int ModulesCount, int WorkAmount, int IterationsCount)
+{
+    auto start = std::chrono::steady_clock::now();
+    int parallelism = 1;
+    if (GroupName == "parallel")
+    {
+        parallelism = std::min(ThreadsCount, ModulesCount);
+        auto run_worker = [=](int i) {
+            int first = (ModulesCount * i) / parallelism;
+            int last = (ModulesCount * (i + 1)) / parallelism;
+            for (int j = 0; j < IterationsCount; j++)
+                for (int k = first; k < last; k++)
+                    Work(WorkAmount);
+        };
+        // Like Loop::Run, the calling thread is the first worker.
+        std::vector<std::thread> threads;
+        for (int i = 1; i < parallelism; i++)
+            threads.push_back(std::thread(run_worker, i));
+        run_worker(0);
+        for (auto& thread : threads)
+            thread.join();
+    }
+    else
+    {
+        for (int j = 0; j < IterationsCount; j++)
+            for (int k = 0; k < ModulesCount; k++)
+                Work(WorkAmount);
+    }
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return { duration.count(), parallelism };
+}
+
+void write_csv(std::ostream& Stream, const std::vector<Result>& Results)
+{
+    Stream << "group,executor,threads,modules,work_amount,iterations_count,"
+           << "avg_work_amount_time,loopscheduler_time,baseline_time,efficiency,"
+           << "loopscheduler_iterations_per_second,baseline_iterations_per_second,overhead_per_run\n";
+    for (auto& r : Results)
+    {
+        Stream << r.Group << ',' << r.Executor << ',' << r.ThreadsCount << ',' << r.ModulesCount << ','
+               << r.WorkAmount << ',' << r.IterationsCount << ','
+               << r.WorkTime << ',' << r.LoopSchedulerTime << ',' << r.BaselineTime << ',' << r.Efficiency << ','
+               << r.LoopSchedulerIterationsPerSecond << ',' << r.BaselineIterationsPerSecond << ','
+               << r.OverheadPerRun << '\n';
+    }
+}
+
+void write_json(std::ostream& Stream, const std::vector<Result>& Results)
+{
+    Stream << "[";
+    for (size_t i = 0; i < Results.size(); i++)
+    {
+        auto& r = Results[i];
+        Stream << (i == 0 ? "\n" : ",\n")
+               << "  {\"group\": \"" << r.Group << "\", \"executor\": \"" << r.Executor << "\""
+               << ", \"threads\": " << r.ThreadsCount << ", \"modules\": " << r.ModulesCount
+               << ", \"work_amount\": " << r.WorkAmount << ", \"iterations_count\": " << r.IterationsCount
+               << ", \"avg_work_amount_time\": " << r.WorkTime
+               << ", \"loopscheduler_time\": " << r.LoopSchedulerTime << ", \"baseline_time\": " << r.BaselineTime
+               << ", \"efficiency\": " << r.Efficiency
+               << ", \"loopscheduler_iterations_per_second\": " << r.LoopSchedulerIterationsPerSecond
+               << ", \"baseline_iterations_per_second\": " << r.BaselineIterationsPerSecond
+               << ", \"overhead_per_run\": " << r.OverheadPerRun << "}";
+    }
+    Stream << "\n]\n";
+}
+
+int main(int argc, char * argv[])
+{
+    Options options;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h")
+            {
+                print_help();
+                return 0;
+            }
+            if (arg.rfind("--", 0) != 0 || i + 1 >= argc)
+                throw std::invalid_argument("Invalid argument: " + arg);
+            std::string value = argv[++i];
+            if (arg == "--config")
+                read_config(value, options);
+            else
+                options.Set(arg.substr(2), value);
+        }
+        for (auto& group : options.Groups)
+            if (group != "parallel" && group != "sequential")
+                throw std::invalid_argument("Unknown group: " + group);
+        if (options.Executor != "default" && options.Executor != "work-stealing")
+            throw std::invalid_argument("Unknown executor: " + options.Executor);
+        if (options.Format != "csv" && options.Format != "json")
+            throw std::invalid_argument("Unknown format: " + options.Format);
+        if (options.IterationsCount < 1 || options.Repeats < 1)
+            throw std::invalid_argument("The iterations and repeats have to be more than 0.");
+        for (int n : options.ThreadCounts)
+            if (n < 1)
+                throw std::invalid_argument("The threads counts have to be more than 0.");
+        for (int n : options.ModuleCounts)
+            if (n < 1)
+                throw std::invalid_argument("The modules counts have to be more than 0.");
+        for (int n : options.WorkAmounts)
+            if (n < 0)
+                throw std::invalid_argument("The work amounts can't be negative.");
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << "\nUse --help to see the options.\n";
+        return 2;
+    }
+
+    auto executor = options.Executor == "work-stealing" ?
+        LoopScheduler::Loop::WorkStealingExecutor : LoopScheduler::Loop::DefaultExecutor;
+
+    std::vector<Result> results;
+    for (auto& group : options.Groups)
+    for (int threads_count : options.ThreadCounts)
+    for (int modules_count : options.ModuleCounts)
+    for (int work_amount : options.WorkAmounts)
+    {
+        std::vector<double> loopscheduler_times;
+        std::vector<double> baseline_times;
+        int parallelism = 1;
+        for (int i = 0; i < options.Repeats; i++)
+        {
+            loopscheduler_times.push_back(
+                run_loopscheduler(group, executor, threads_count, modules_count, work_amount, options.IterationsCount)
+            );
+            auto baseline = run_baseline(group, threads_count, modules_count, work_amount, options.IterationsCount);
+            baseline_times.push_back(baseline.first);
+            parallelism = baseline.second;
+        }
+
+        Result r;
+        r.Group = group;
+        r.Executor = options.Executor;
+        r.ThreadsCount = threads_count;
+        r.ModulesCount = modules_count;
+        r.WorkAmount = work_amount;
+        r.IterationsCount = options.IterationsCount;
+        r.WorkTime = measure_work_time(work_amount);
+        r.LoopSchedulerTime = median(loopscheduler_times);
+        r.BaselineTime = median(baseline_times);
+        r.Efficiency = r.BaselineTime / r.LoopSchedulerTime;
+        r.LoopSchedulerIterationsPerSecond = r.IterationsCount / r.LoopSchedulerTime;
+        r.BaselineIterationsPerSecond = r.IterationsCount / r.BaselineTime;
+        r.OverheadPerRun = (r.LoopSchedulerTime - r.BaselineTime) * parallelism
+                         / ((double)r.IterationsCount * modules_count);
+        results.push_back(r);
+        std::cerr << group << ", " << threads_count << " threads, " << modules_count << " modules, "
+                  << work_amount << " work amount: efficiency " << r.Efficiency << '\n';
+    }
+
+    std::ofstream file;
+    if (!options.Output.empty())
+    {
+        file.open(options.Output);
+        if (!file)
+        {
+            std::cerr << "Cannot open the output file: " << options.Output << '\n';
+            return 2;
+        }
+    }
+    std::ostream& stream = options.Output.empty() ? std::cout : file;
+    if (options.Format == "json")
+        write_json(stream, results);
+    else
+        write_csv(stream, results);
+
+    if (options.MinEfficiency > 0)
+    {
+        bool failed = false;
+        for (auto& r : results)
+        {
+            if (r.Efficiency < options.MinEfficiency)
+            {
+                std::cerr << "Efficiency lower than " << options.MinEfficiency << ": " << r.Group << ", "
+                          << r.ThreadsCount << " threads, " << r.ModulesCount << " modules, "
+                          << r.WorkAmount << " work amount: " << r.Efficiency << '\n';
+                failed = true;
+            }
+        }
+        if (failed)
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ChannelBase.h"
+
+#include <algorithm>
+
+#include "Module.h"
+
+namespace LoopScheduler
+{
+    ChannelBase::ChannelBase() : PushedCount(0), PoppedCount(0), ConsumersCount(0) {}
+
+    bool ChannelBase::IsEmpty()
+    {
+        // Loaded before PushedCount, so a push that isn't seen here sees these pops (see NotifyIfWasEmpty).
+        std::uint64_t popped_count = PoppedCount.load();
+        return popped_count >= PushedCount.load();
+    }
+
+    std::size_t ChannelBase::GetSize()
+    {
+        std::uint64_t popped_count = PoppedCount.load();
+        std::uint64_t pushed_count = PushedCount.load();
+        return pushed_count > popped_count ? pushed_count - popped_count : 0;
+    }
+
+    std::uint64_t ChannelBase::GetPushedCount()
+    {
+        return PushedCount.load(std::memory_order_acquire);
+    }
+
+    std::uint64_t ChannelBase::GetPoppedCount()
+    {
+        return PoppedCount.load(std::memory_order_acquire);
+    }
+
+    void ChannelBase::ReportPush(std::size_t Count)
+    {
+        NotifyIfWasEmpty(PushedCount.fetch_add(Count));
+    }
+
+    void ChannelBase::ReportPop(std::size_t Count)
+    {
+        PoppedCount.fetch_add(Count);
+    }
+
+    void ChannelBase::PublishPushedCount(std::uint64_t Count)
+    {
+        std::uint64_t previous_count = PushedCount.load(std::memory_order_relaxed);
+        PushedCount.store(Count);
+        NotifyIfWasEmpty(previous_count);
+    }
+
+    void ChannelBase::PublishPoppedCount(std::uint64_t Count)
+    {
+        PoppedCount.store(Count);
+    }
+
+    inline void ChannelBase::NotifyIfWasEmpty(std::uint64_t PreviousPushedCount)
+    {
+        // Sequentially consistent with IsEmpty: a consumer that has seen the channel empty before this push
+        // has seen all the pops seen here.
+        if (PoppedCount.load() < PreviousPushedCount || ConsumersCount.load() == 0)
+            return;
+        std::unique_lock<std::mutex> lock(ConsumersMutex);
+        for (auto consumer : Consumers)
+            consumer->NotifyInputAvailability();
+    }
+
+    void ChannelBase::AddConsumer(Module * Consumer)
+    {
+        std::unique_lock<std::mutex> lock(ConsumersMutex);
+        Consumers.push_back(Consumer);
+        ConsumersCount.store(Consumers.size());
+    }
+
+    void ChannelBase::RemoveConsumer(Module * Consumer)
+    {
+        std::unique_lock<std::mutex> lock(ConsumersMutex);
+        auto it = std::find(Consumers.begin(), Consumers.end(), Consumer);
+        if (it != Consumers.end())
+            Consumers.erase(it);
+        ConsumersCount.store(Consumers.size());
+    }
+}
@@ -0,0 +1,94 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace LoopScheduler
+{
+    /// @brief The base of the bounded lock-free channels (SPSCChannel and MPMCChannel),
+    ///        that makes the consumer modules runnable when the channel is not empty (see Module::AddInputChannel).
+    ///
+    /// The pushed and popped counts are published after the items, so checking for emptiness doesn't lock,
+    /// and the consumers are notified when a push finds the channel empty, instead of polling a custom CanRun.
+    class ChannelBase
+    {
+        friend Module;
+    public:
+        ChannelBase();
+        ChannelBase(const ChannelBase&) = delete;
+        ChannelBase& operator=(const ChannelBase&) = delete;
+        /// @brief Checks whether the channel is empty without locking.
+        ///        The result may be outdated immediately, and may be true while a push or pop is in progress.
+        ///
+        /// Thread-safe
+        bool IsEmpty();
+        /// @brief Returns the approximate number of the items in the channel without locking.
+        ///
+        /// Thread-safe
+        std::size_t GetSize();
+    protected:
+        /// @brief Returns the published number of the pushed items, acquiring the items.
+        std::uint64_t GetPushedCount();
+        /// @brief Returns the published number of the popped items, acquiring their cells.
+        std::uint64_t GetPoppedCount();
+        /// @brief Used by the derived channels after publishing the pushed items,
+        ///        notifies the consumers if the channel was empty.
+        ///
+        /// LOCKS MUTEX if the channel was empty
+        void ReportPush(std::size_t Count);
+        /// @brief Used by the derived channels after popping the items.
+        void ReportPop(std::size_t Count);
+        /// @brief Used by SPSCChannel, which owns each count in 1 thread, to publish it without a read-modify-write.
+        ///
+        /// LOCKS MUTEX if the channel was empty
+        void PublishPushedCount(std::uint64_t Count);
+        /// @brief Used by SPSCChannel, which owns each count in 1 thread, to publish it without a read-modify-write.
+        void PublishPoppedCount(std::uint64_t Count);
+    private:
+        alignas(64) std::atomic<std::uint64_t> PushedCount;
+        alignas(64) std::atomic<std::uint64_t> PoppedCount;
+
+        alignas(64) std::mutex ConsumersMutex;
+        /// @brief The modules that have this channel as an input. Guarded by ConsumersMutex.
+        std::vector<Module*> Consumers;
+        /// @brief The size of Consumers, read without locking.
+        std::atomic<int> ConsumersCount;
+
+        /// @brief Notifies the consumers if the channel was empty before a push.
+        ///
+        /// LOCKS MUTEX if the channel was empty
+        inline void NotifyIfWasEmpty(std::uint64_t PreviousPushedCount);
+        /// @brief Used by Module.
+        ///
+        /// LOCKS MUTEX
+        void AddConsumer(Module*);
+        /// @brief Used by Module.
+        ///
+        /// LOCKS MUTEX
+        void RemoveConsumer(Module*);
+    };
+}
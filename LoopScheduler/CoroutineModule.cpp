@@ -0,0 +1,237 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "CoroutineModule.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+#include "ExecutionStatistics.h"
+#include "Loop.h"
+#include "TimeSpanPredictor.h"
+#include "Tracer.h"
+
+namespace LoopScheduler
+{
+    CoroutineModule::Task CoroutineModule::Task::promise_type::get_return_object()
+    {
+        return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always CoroutineModule::Task::promise_type::initial_suspend() noexcept
+    {
+        return {};
+    }
+    std::suspend_always CoroutineModule::Task::promise_type::final_suspend() noexcept
+    {
+        return {};
+    }
+    void CoroutineModule::Task::promise_type::return_void() {}
+    void CoroutineModule::Task::promise_type::unhandled_exception()
+    {
+        Exception = std::current_exception();
+    }
+
+    CoroutineModule::Task::Task(std::coroutine_handle<promise_type> Handle) : Handle(Handle) {}
+    CoroutineModule::Task::Task(Task&& op)
+    {
+        Handle = std::exchange(op.Handle, nullptr);
+    }
+    CoroutineModule::Task& CoroutineModule::Task::operator=(Task&& op)
+    {
+        if (this == &op)
+            return *this;
+        if (Handle)
+            Handle.destroy();
+        Handle = std::exchange(op.Handle, nullptr);
+        return *this;
+    }
+    CoroutineModule::Task::~Task()
+    {
+        if (Handle)
+            Handle.destroy();
+    }
+
+    double CoroutineModule::Awaitable::GetPollingPeriod()
+    {
+        return DEFAULT_POLLING_PERIOD;
+    }
+    bool CoroutineModule::Awaitable::await_ready()
+    {
+        return IsReady();
+    }
+    void CoroutineModule::Awaitable::await_suspend(std::coroutine_handle<Task::promise_type> Handle)
+    {
+        // The coroutine is resumed or published by the thread that has resumed it, after it's suspended.
+        Handle.promise().Owner->CurrentAwaitable = this;
+    }
+    void CoroutineModule::Awaitable::await_resume() {}
+
+    CoroutineModule::DelayAwaitable::DelayAwaitable(std::chrono::steady_clock::time_point EndTime) : EndTime(EndTime) {}
+    bool CoroutineModule::DelayAwaitable::IsReady()
+    {
+        return std::chrono::steady_clock::now() >= EndTime;
+    }
+    double CoroutineModule::DelayAwaitable::GetPollingPeriod()
+    {
+        std::chrono::duration<double> remaining_time = EndTime - std::chrono::steady_clock::now();
+        return std::max(remaining_time.count(), MNIMAL_TIME);
+    }
+
+    CoroutineModule::RunAwaitable::RunAwaitable(Module& AwaitedModule)
+        : AwaitedModule(AwaitedModule), FinishedRunsCount(AwaitedModule.GetFinishedRunsCount())
+    {
+    }
+    bool CoroutineModule::RunAwaitable::IsReady()
+    {
+        return AwaitedModule.GetFinishedRunsCount() != FinishedRunsCount;
+    }
+
+    CoroutineModule::CoroutineModule(
+            std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor,
+            std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor,
+            std::shared_ptr<SmartCVWaiter> CVWaiter
+        ) : Module(false, std::move(HigherExecutionTimePredictor), std::move(LowerExecutionTimePredictor), false, CVWaiter),
+            CurrentAwaitable(nullptr), FrameIndex(-1)
+    {
+    }
+
+    CoroutineModule::~CoroutineModule()
+    {
+        if (Handle)
+            Handle.destroy();
+    }
+
+    CoroutineModule::DelayAwaitable CoroutineModule::Delay(double Time)
+    {
+        return DelayAwaitable(
+            std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(Time))
+        );
+    }
+
+    CoroutineModule::RunAwaitable CoroutineModule::WaitForRun(Module& AwaitedModule)
+    {
+        return RunAwaitable(AwaitedModule);
+    }
+
+    void CoroutineModule::OnRun()
+    {
+        StartCoroutine();
+        while (!ResumeCoroutine())
+        {
+            // Nothing can resume the coroutine in another thread.
+            while (!CurrentAwaitable->IsReady())
+            {
+                double time = CurrentAwaitable->GetPollingPeriod();
+                if (GetLoop() != nullptr)
+                    Idle(time);
+                else
+                    std::this_thread::sleep_for(std::chrono::duration<double>(time));
+            }
+        }
+    }
+
+    bool CoroutineModule::OnSuspendableRun()
+    {
+        auto loop = GetLoop();
+        if (loop == nullptr)
+        {
+            OnRun();
+            return true;
+        }
+        FrameIndex = loop->GetFrameIndexForCurrentThread();
+        StartCoroutine();
+        if (ResumeCoroutine())
+            return true;
+        // Not accessed by this thread after being published.
+        loop->AddSuspendedModule(this);
+        return false;
+    }
+
+    inline void CoroutineModule::StartCoroutine()
+    {
+        Task task = OnRunAsync();
+        Handle = std::exchange(task.Handle, nullptr);
+        Handle.promise().Owner = this;
+    }
+
+    bool CoroutineModule::ResumeCoroutine()
+    {
+        CurrentAwaitable = nullptr;
+        Handle.resume();
+        if (!Handle.done())
+            return false;
+        auto exception = std::exchange(Handle.promise().Exception, nullptr);
+        Handle.destroy();
+        Handle = nullptr;
+        if (exception != nullptr)
+        {
+            try
+            {
+                std::rethrow_exception(exception);
+            }
+            catch (const std::exception& e)
+            {
+                try
+                {
+                    HandleException(e);
+                }
+                catch (...) {}
+            }
+            catch (...)
+            {
+                try
+                {
+                    HandleException(std::current_exception());
+                }
+                catch (...) {}
+            }
+        }
+        return true;
+    }
+
+    void CoroutineModule::ResumeSuspendedRun()
+    {
+        bool is_finished;
+        {
+            LOOPSCHEDULER_TRACE_SCOPE("CoroutineModule::Resume", "run", this);
+            Loop::FrameScope frame_scope(FrameIndex);
+            is_finished = ResumeCoroutine();
+        }
+        if (is_finished)
+        {
+            FinishSuspendedRun();
+            return;
+        }
+        // Not accessed by this thread after being published.
+        GetLoop()->AddSuspendedModule(this);
+    }
+
+    bool CoroutineModule::IsResumable()
+    {
+        return CurrentAwaitable->IsReady();
+    }
+
+    double CoroutineModule::GetPollingPeriod()
+    {
+        return CurrentAwaitable->GetPollingPeriod();
+    }
+}
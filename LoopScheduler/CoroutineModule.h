@@ -0,0 +1,204 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+#include "Module.h"
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+
+namespace LoopScheduler
+{
+    /// @brief A module that runs a C++20 coroutine on each run, which can suspend instead of calling Idle.
+    ///
+    /// When the coroutine co_awaits something that isn't ready (e.g. Delay, WaitFor or WaitForRun),
+    /// the run is suspended and the thread returns to the loop.
+    /// The coroutine is resumed later by a thread of the loop that becomes free,
+    /// which is not necessarily the same thread.
+    /// Meanwhile, the run is treated as running by its group, and the module can't run again.
+    ///
+    /// The predicted execution time includes the suspended time, as the run occupies its group meanwhile.
+    /// When run by a group that doesn't support suspended runs, or outside a loop,
+    /// the thread idles until the awaited thing is ready instead.
+    ///
+    /// Example:
+    ///   class MyModule : public CoroutineModule
+    ///   {
+    ///   protected:
+    ///       Task OnRunAsync() override
+    ///       {
+    ///           auto data = co_await WaitFor(DataFuture);
+    ///           co_await Delay(0.001);
+    ///       }
+    ///   };
+    class CoroutineModule : public Module
+    {
+        friend Loop;
+    public:
+        /// @brief The type returned by OnRunAsync.
+        class Task final
+        {
+            friend CoroutineModule;
+        public:
+            class promise_type
+            {
+                friend CoroutineModule;
+            public:
+                Task get_return_object();
+                std::suspend_always initial_suspend() noexcept;
+                std::suspend_always final_suspend() noexcept;
+                void return_void();
+                void unhandled_exception();
+            private:
+                CoroutineModule * Owner = nullptr;
+                std::exception_ptr Exception;
+            };
+            Task(Task&) = delete;
+            Task(Task&&);
+            Task& operator=(Task&) = delete;
+            Task& operator=(Task&&);
+            ~Task();
+        private:
+            Task(std::coroutine_handle<promise_type> Handle);
+            std::coroutine_handle<promise_type> Handle;
+        };
+
+        /// @brief The base of the objects that can be co_awaited in OnRunAsync.
+        ///
+        /// Can be derived to await other things.
+        class Awaitable
+        {
+        public:
+            /// @brief The default time in seconds to check again whether the awaited thing is ready.
+            static constexpr double DEFAULT_POLLING_PERIOD = 0.0005;
+            virtual ~Awaitable() = default;
+            /// @brief Whether the coroutine can be resumed. Called in any thread.
+            virtual bool IsReady() = 0;
+            /// @brief Returns the time in seconds to check IsReady again, if nothing else is run meanwhile.
+            ///        The default is DEFAULT_POLLING_PERIOD.
+            virtual double GetPollingPeriod();
+
+            bool await_ready();
+            void await_suspend(std::coroutine_handle<Task::promise_type> Handle);
+            void await_resume();
+        };
+
+        /// @brief Waits until a time point.
+        class DelayAwaitable final : public Awaitable
+        {
+        public:
+            DelayAwaitable(std::chrono::steady_clock::time_point EndTime);
+            virtual bool IsReady() override;
+            /// @brief Returns the remaining time.
+            virtual double GetPollingPeriod() override;
+        private:
+            std::chrono::steady_clock::time_point EndTime;
+        };
+
+        /// @brief Waits until a std::future or std::shared_future is ready, and returns its get()'s result.
+        template <typename FutureType>
+        class FutureAwaitable final : public Awaitable
+        {
+        public:
+            FutureAwaitable(FutureType& Future) : Future(Future) {}
+            virtual bool IsReady() override
+            {
+                return Future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            }
+            decltype(auto) await_resume()
+            {
+                return Future.get();
+            }
+        private:
+            FutureType& Future;
+        };
+
+        /// @brief Waits until a module finishes a run that's finished after this object is constructed.
+        class RunAwaitable final : public Awaitable
+        {
+        public:
+            RunAwaitable(Module& AwaitedModule);
+            virtual bool IsReady() override;
+        private:
+            Module& AwaitedModule;
+            int FinishedRunsCount;
+        };
+
+        /// @param HigherExecutionTimePredictor Predictor to predict the higher timespan. nullptr to use default.
+        /// @param LowerExecutionTimePredictor Predictor to predict the lower timespan. nullptr to use default.
+        /// @param CVWaiter One waiter can be shared between different objects or have different time predictors.
+        CoroutineModule(
+            std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor = nullptr,
+            std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor = nullptr,
+            std::shared_ptr<SmartCVWaiter> CVWaiter = nullptr
+        );
+        virtual ~CoroutineModule();
+    protected:
+        /// @brief The coroutine to run on each run. Has to be implemented by the derived class.
+        virtual Task OnRunAsync() = 0;
+
+        /// @brief Returns an object to co_await in OnRunAsync, to wait for a time in seconds.
+        DelayAwaitable Delay(double Time);
+        /// @brief Returns an object to co_await in OnRunAsync, to wait for a std::future or std::shared_future.
+        ///        The co_await expression returns the result of the future's get().
+        ///
+        /// The future has to outlive the co_await expression.
+        template <typename FutureType>
+        FutureAwaitable<FutureType> WaitFor(FutureType& Future)
+        {
+            return FutureAwaitable<FutureType>(Future);
+        }
+        /// @brief Returns an object to co_await in OnRunAsync, to wait for the next finished run of another module.
+        ///
+        /// The awaited module has to be able to run meanwhile, e.g. not be after this module in a SequentialGroup.
+        RunAwaitable WaitForRun(Module& AwaitedModule);
+
+        /// @brief Runs the coroutine to the end, idling while it's suspended.
+        virtual void OnRun() override final;
+        /// @brief Runs the coroutine until it's finished or suspended.
+        virtual bool OnSuspendableRun() override final;
+    private:
+        /// @brief The coroutine of the current run. Only accessed by the thread that runs or resumes it.
+        std::coroutine_handle<Task::promise_type> Handle;
+        /// @brief Set when the coroutine is suspended.
+        Awaitable * CurrentAwaitable;
+        /// @brief The frame of the current run, kept when it's resumed in another thread (see Loop::FrameScope).
+        std::int64_t FrameIndex;
+
+        /// @brief Starts the coroutine of a new run.
+        inline void StartCoroutine();
+        /// @brief Resumes the coroutine, and handles its exception when it's finished.
+        /// @return Whether the coroutine is finished.
+        bool ResumeCoroutine();
+        /// @brief Used by Loop to resume the suspended run when CurrentAwaitable is ready,
+        ///        and to finish the run or suspend it again.
+        void ResumeSuspendedRun();
+        /// @brief Used by Loop.
+        bool IsResumable();
+        /// @brief Used by Loop.
+        double GetPollingPeriod();
+    };
+}
@@ -0,0 +1,619 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "DependencyGroup.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "Module.h"
+#include "BiasedEMATimeSpanPredictor.h"
+#include "ExecutionStatistics.h"
+#include "Loop.h"
+#include "SmartCVWaiter.h"
+#include "Tracer.h"
+
+namespace LoopScheduler
+{
+    DependencyGroup::DependencyGroup(
+            std::vector<DependencyGroupMember> Members,
+            std::vector<std::pair<int, int>> Dependencies,
+            std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor,
+            std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor,
+            std::shared_ptr<SmartCVWaiter> CVWaiter
+        ) : Members(Members), SuccessorsStart(Members.size() + 1, 0), DependenciesCounts(Members.size(), 0),
+            ReadySet(Members.size()), RunningSet(Members.size()), DoneSet(Members.size()),
+            RemainingMembersCount(0), RunningThreadsCount(0), BudgetPacking(false), NotifyingCounter(0),
+            RunInfos(Members.size()), MeasuringTimespan(false)
+    {
+        int count = Members.size();
+        for (auto& dependency : Dependencies)
+        {
+            if (dependency.first < 0 || dependency.first >= count
+                || dependency.second < 0 || dependency.second >= count)
+                throw std::logic_error("A dependency's member index is out of range.");
+            SuccessorsStart[dependency.first + 1]++;
+            DependenciesCounts[dependency.second]++;
+        }
+        for (int i = 0; i < count; i++)
+            SuccessorsStart[i + 1] += SuccessorsStart[i];
+        Successors.resize(Dependencies.size());
+        std::vector<int> positions(SuccessorsStart.begin(), SuccessorsStart.end() - 1);
+        for (auto& dependency : Dependencies)
+            Successors[positions[dependency.first]++] = dependency.second;
+
+        // Kahn's algorithm, the members left out are in a cycle.
+        RemainingDependenciesCounts = DependenciesCounts;
+        for (int i = 0; i < count; i++)
+            if (RemainingDependenciesCounts[i] == 0)
+                TopologicalOrder.push_back(i);
+        for (int k = 0; k < TopologicalOrder.size(); k++)
+        {
+            int i = TopologicalOrder[k];
+            for (int j = SuccessorsStart[i]; j < SuccessorsStart[i + 1]; j++)
+                if (--RemainingDependenciesCounts[Successors[j]] == 0)
+                    TopologicalOrder.push_back(Successors[j]);
+        }
+        if (TopologicalOrder.size() != count)
+            throw std::logic_error("The dependencies cannot have a cycle.");
+
+        std::vector<std::shared_ptr<Group>> member_groups;
+        std::vector<std::shared_ptr<Module>> member_modules;
+        for (auto& member : Members)
+            if (std::holds_alternative<std::shared_ptr<Group>>(member))
+                member_groups.push_back(std::get<std::shared_ptr<Group>>(member));
+            else
+                member_modules.push_back(std::get<std::shared_ptr<Module>>(member));
+
+        IntroduceMembers(std::move(member_groups), std::move(member_modules));
+
+        for (auto& member : Members)
+            if (std::holds_alternative<std::shared_ptr<Group>>(member))
+                GroupMembers.push_back(std::get<std::shared_ptr<Group>>(member));
+
+        if (HigherExecutionTimePredictor == nullptr)
+            HigherExecutionTimePredictor = std::unique_ptr<BiasedEMATimeSpanPredictor>(
+                new BiasedEMATimeSpanPredictor(
+                    0,
+                    BiasedEMATimeSpanPredictor::DEFAULT_FAST_ALPHA,
+                    BiasedEMATimeSpanPredictor::DEFAULT_SLOW_ALPHA
+                )
+            );
+        if (LowerExecutionTimePredictor == nullptr)
+            LowerExecutionTimePredictor = std::unique_ptr<BiasedEMATimeSpanPredictor>(
+                new BiasedEMATimeSpanPredictor(
+                    0,
+                    BiasedEMATimeSpanPredictor::DEFAULT_SLOW_ALPHA,
+                    BiasedEMATimeSpanPredictor::DEFAULT_FAST_ALPHA
+                )
+            );
+        if (CVWaiter == nullptr)
+            CVWaiter = std::shared_ptr<SmartCVWaiter>(new SmartCVWaiter());
+
+        this->HigherExecutionTimePredictor = std::move(HigherExecutionTimePredictor);
+        this->LowerExecutionTimePredictor = std::move(LowerExecutionTimePredictor);
+        HigherPrediction.store(this->HigherExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+        LowerPrediction.store(this->LowerExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+        this->CVWaiter = CVWaiter;
+
+        StartNextIterationForThisGroup();
+    }
+
+    bool DependencyGroup::RunNext(double MaxEstimatedExecutionTime)
+    {
+        std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        StartMeasuringLockHolding();
+
+        if (!MeasuringTimespan && RemainingMembersCount != 0)
+        {
+            IterationStartTime = std::chrono::steady_clock::now();
+            MeasuringTimespan = true;
+        }
+
+        if (BudgetPacking && MaxEstimatedExecutionTime != 0 && RunBestFits(lock, MaxEstimatedExecutionTime))
+            return true;
+
+        // The modules that prefer other threads (Module::SoftAffinity) only run on a second pass,
+        // when nothing else can run.
+        bool is_first_pass = true;
+        bool has_deferred = false;
+        while (true)
+        {
+            int i = ReadySet.FindNext(0);
+            while (i != -1)
+            {
+                if (std::holds_alternative<std::shared_ptr<Module>>(Members[i]))
+                {
+                    auto& m = std::get<std::shared_ptr<Module>>(Members[i]);
+                    if (is_first_pass && m->PrefersAnotherThread())
+                        has_deferred = true;
+                    else if ((MaxEstimatedExecutionTime == 0 || m->PredictHigherExecutionTime() <= MaxEstimatedExecutionTime)
+                        && RunModule(i, lock))
+                        return true;
+                }
+                else
+                {
+                    auto& g = std::get<std::shared_ptr<Group>>(Members[i]);
+                    if (g->IsDone())
+                    {
+                        if (RunInfos[i].RunCount == 0)
+                        {
+                            MarkDone(i);
+                            // The members that became ready can have smaller indexes.
+                            i = ReadySet.FindNext(0);
+                            continue;
+                        }
+                    }
+                    else if (g->IsRunAvailable(MaxEstimatedExecutionTime))
+                    {
+                        return RunGroup(i, lock, MaxEstimatedExecutionTime);
+                    }
+                }
+                i = ReadySet.FindNext(i + 1);
+            }
+            if (!has_deferred || !is_first_pass)
+                break;
+            is_first_pass = false;
+        }
+        StopMeasuringLockHolding();
+        if (RemainingMembersCount == 0) // IsDone()
+        {
+            lock.unlock();
+            return RunUnfinishedMemberGroup(MaxEstimatedExecutionTime);
+        }
+        return false;
+    }
+    inline bool DependencyGroup::RunModule(int Index, std::unique_lock<std::shared_mutex>& lock)
+    {
+        auto& m = std::get<std::shared_ptr<Module>>(Members[Index]);
+        auto token = m->GetRunningToken();
+        if (!token.CanRun())
+            return false;
+        ReadySet.Remove(Index);
+        RunningSet.Add(Index);
+        auto& runinfo = RunInfos[Index];
+        runinfo.RunCount++;
+        RunningThreadsCount++;
+        runinfo.StartTime = std::chrono::steady_clock::now();
+        runinfo.HigherPredictedTimeSpan = m->PredictHigherExecutionTime();
+        runinfo.LowerPredictedTimeSpan = m->PredictLowerExecutionTime();
+        StopMeasuringLockHolding();
+        lock.unlock();
+
+        if (token.Run(this, Index))
+            FinishModuleRun(Index);
+        // Else, released by FinishSuspendedRun
+        return true;
+    }
+    inline bool DependencyGroup::RunBestFits(std::unique_lock<std::shared_mutex>& lock, double MaxEstimatedExecutionTime)
+    {
+        auto start = std::chrono::steady_clock::now();
+        double remaining_time = MaxEstimatedExecutionTime;
+        bool has_run = false;
+        // The modules that are available but can't run now, are skipped to pack the next best fits instead.
+        std::vector<int> skipped_indexes;
+        while (remaining_time > 0)
+        {
+            if (!lock.owns_lock())
+                lock.lock();
+            int best_fit = -1;
+            double best_fit_time = -1;
+            for (int i = ReadySet.FindNext(0); i != -1; i = ReadySet.FindNext(i + 1))
+            {
+                if (!std::holds_alternative<std::shared_ptr<Module>>(Members[i])
+                    || std::find(skipped_indexes.begin(), skipped_indexes.end(), i) != skipped_indexes.end())
+                    continue;
+                auto& m = std::get<std::shared_ptr<Module>>(Members[i]);
+                double time = m->PredictHigherExecutionTime();
+                if (time <= remaining_time && time > best_fit_time && m->IsAvailable())
+                {
+                    best_fit = i;
+                    best_fit_time = time;
+                }
+            }
+            if (best_fit == -1)
+                break;
+            if (!RunModule(best_fit, lock))
+            {
+                skipped_indexes.push_back(best_fit);
+                continue;
+            }
+            has_run = true;
+            std::chrono::duration<double> passed_time = std::chrono::steady_clock::now() - start;
+            remaining_time = MaxEstimatedExecutionTime - passed_time.count();
+        }
+        return has_run;
+    }
+    inline void DependencyGroup::FinishModuleRun(int Index)
+    {
+        // Lock before MembersSharedMutex lock for modifications before notify_all()
+        std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+        std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        RunInfos[Index].RunCount--;
+        RunningThreadsCount--;
+        NotifyingCounter++;
+        RunningSet.Remove(Index);
+        int ready_count = MarkDone(Index);
+        int wake_ups_count = Waiters.GetWakeUpsCount(ready_count, RemainingMembersCount == 0, RunningThreadsCount == 0);
+        lock.unlock();
+        cv_lock.unlock();
+        TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
+    }
+    void DependencyGroup::FinishSuspendedRun(int MemberIndex)
+    {
+        FinishModuleRun(MemberIndex);
+    }
+    inline bool DependencyGroup::RunGroup(int Index, std::unique_lock<std::shared_mutex>& lock, double MaxEstimatedExecutionTime)
+    {
+        auto& g = std::get<std::shared_ptr<Group>>(Members[Index]);
+        auto& runinfo = RunInfos[Index];
+        RunningSet.Add(Index);
+        runinfo.RunCount++;
+        RunningThreadsCount++;
+        StopMeasuringLockHolding();
+        lock.unlock();
+
+        bool success;
+        {
+#if LOOPSCHEDULER_ENABLE_TRACING
+            Tracer::Scope trace_scope("DependencyGroup::RunGroup", "run", g.get());
+#endif
+            success = g->RunNext(MaxEstimatedExecutionTime);
+#if LOOPSCHEDULER_ENABLE_TRACING
+            if (!success)
+                trace_scope.Discard();
+#endif
+        }
+
+        // Lock before MembersSharedMutex lock for modifications before notify_all()
+        std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+        lock.lock();
+        RunningThreadsCount--;
+        NotifyingCounter++;
+        if (--runinfo.RunCount == 0)
+        {
+            RunningSet.Remove(Index);
+            if (ReadySet.Contains(Index) && g->IsDone())
+                MarkDone(Index);
+        }
+        // The number of the runs available in the group is unknown.
+        int wake_ups_count = Waiters.GetWakeUpsCount(TargetedNotifier::ALL, RemainingMembersCount == 0, RunningThreadsCount == 0);
+        lock.unlock();
+        cv_lock.unlock();
+        TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
+        return success;
+    }
+    inline int DependencyGroup::MarkDone(int Index)
+    {
+        // NO MUTEX LOCK
+        ReadySet.Remove(Index);
+        DoneSet.Add(Index);
+        int ready_count = 0;
+        for (int j = SuccessorsStart[Index]; j < SuccessorsStart[Index + 1]; j++)
+        {
+            int successor = Successors[j];
+            if (--RemainingDependenciesCounts[successor] == 0)
+            {
+                ReadySet.Add(successor);
+                // The number of the runs available in a group is unknown.
+                if (ready_count == TargetedNotifier::ALL || std::holds_alternative<std::shared_ptr<Group>>(Members[successor]))
+                    ready_count = TargetedNotifier::ALL;
+                else
+                    ready_count++;
+            }
+        }
+        if (--RemainingMembersCount == 0 && MeasuringTimespan)
+        {
+            std::chrono::duration<double> duration = std::chrono::steady_clock::now() - IterationStartTime;
+            double time = duration.count();
+            HigherExecutionTimePredictor->ReportObservation(time);
+            LowerExecutionTimePredictor->ReportObservation(time);
+            HigherPrediction.store(HigherExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+            LowerPrediction.store(LowerExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+            if (auto statistics = GetStatistics())
+                statistics->ReportRun(time);
+            MeasuringTimespan = false;
+        }
+        return ready_count;
+    }
+
+    bool DependencyGroup::IsRunAvailable(double MaxEstimatedExecutionTime)
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        if (RemainingMembersCount == 0) // IsDone()
+            return IsUnfinishedMemberGroupRunAvailable(MaxEstimatedExecutionTime);
+        return IsRunAvailableNoLock(MaxEstimatedExecutionTime);
+    }
+    bool DependencyGroup::IsAvailable(double MaxEstimatedExecutionTime)
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        if (RemainingMembersCount == 0) // IsDone()
+            return true;
+        return IsRunAvailableNoLock(MaxEstimatedExecutionTime);
+    }
+    inline bool DependencyGroup::IsRunAvailableNoLock(double MaxEstimatedExecutionTime)
+    {
+        for (int i = ReadySet.FindNext(0); i != -1; i = ReadySet.FindNext(i + 1))
+        {
+            if (std::holds_alternative<std::shared_ptr<Module>>(Members[i]))
+            {
+                auto& m = std::get<std::shared_ptr<Module>>(Members[i]);
+                if (MaxEstimatedExecutionTime != 0 && m->PredictHigherExecutionTime() > MaxEstimatedExecutionTime)
+                    continue;
+                if (m->IsAvailable())
+                    return true;
+            }
+            else
+            {
+                auto& g = std::get<std::shared_ptr<Group>>(Members[i]);
+                if (g->IsDone())
+                {
+                    if (RunInfos[i].RunCount == 0) // Can be marked as done by RunNext
+                        return true;
+                }
+                else if (g->IsAvailable(MaxEstimatedExecutionTime))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void DependencyGroup::WaitForRunAvailability(double MaxEstimatedExecutionTime, double MaxWaitingTime)
+    {
+        // There's nothing left to do when IsDone=true, except in the unfinished member groups.
+        if (RemainingMembersCount.load() == 0)
+        {
+            WaitForUnfinishedMemberGroup(MaxEstimatedExecutionTime, MaxWaitingTime);
+            return;
+        }
+        WaitForAvailabilityCommon(MaxEstimatedExecutionTime, MaxWaitingTime);
+    }
+    void DependencyGroup::WaitForAvailability(double MaxEstimatedExecutionTime, double MaxWaitingTime)
+    {
+        WaitForAvailabilityCommon(MaxEstimatedExecutionTime, MaxWaitingTime);
+    }
+    inline void DependencyGroup::WaitForAvailabilityCommon(double MaxEstimatedExecutionTime, double MaxWaitingTime)
+    {
+        std::chrono::time_point<std::chrono::steady_clock> start;
+        if (MaxWaitingTime != 0)
+            start = std::chrono::steady_clock::now();
+
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        int start_notifying_counter = NotifyingCounter;
+
+        if (RunningThreadsCount == 0)
+            return;
+        if (RemainingMembersCount == 0) // IsDone()
+            return;
+        if (IsRunAvailableNoLock(MaxEstimatedExecutionTime))
+            return;
+
+        lock.unlock();
+
+        const auto predicate = [this, start_notifying_counter] {
+            // Doesn't need MembersSharedMutex, NotifyingCounter is only modified with NextEventConditionMutex locked.
+            return start_notifying_counter != NotifyingCounter.load(std::memory_order_relaxed)
+                || Loop::HasQueuedRunsForParkedWorker();
+        };
+
+        auto statistics = GetStatistics();
+        std::chrono::time_point<std::chrono::steady_clock> waiting_start;
+        if (statistics != nullptr)
+            waiting_start = std::chrono::steady_clock::now();
+
+        LOOPSCHEDULER_TRACE_SCOPE("DependencyGroup::Wait", "wait", this);
+        std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+        TargetedNotifier::WaitingGuard waiting_guard(
+                Waiters, MaxEstimatedExecutionTime != 0 || Loop::IsCurrentThreadConstrained(), true);
+        if (MaxWaitingTime == 0)
+        {
+#if LOOPSCHEDULER_USE_SMART_CV_WAITER
+            CVWaiter->Wait(NextEventConditionVariable, cv_lock, predicate);
+#else
+            NextEventConditionVariable.wait(cv_lock, predicate);
+#endif
+        }
+        else if (MaxWaitingTime > 0)
+        {
+            auto stop = start + std::chrono::duration<double>(MaxWaitingTime);
+            std::chrono::duration<double> time = stop - std::chrono::steady_clock::now();
+#if LOOPSCHEDULER_USE_SMART_CV_WAITER
+            CVWaiter->WaitFor(NextEventConditionVariable, cv_lock, time, predicate);
+#else
+            NextEventConditionVariable.wait_for(cv_lock, time, predicate);
+#endif
+        }
+
+        if (statistics != nullptr)
+        {
+            std::chrono::duration<double> duration = std::chrono::steady_clock::now() - waiting_start;
+            statistics->ReportWaiting(duration.count());
+        }
+    }
+
+    bool DependencyGroup::IsDone()
+    {
+        return RemainingMembersCount.load() == 0;
+    }
+
+    void DependencyGroup::StartNextIteration()
+    {
+        std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        StartNextIterationForThisGroup();
+        for (auto& group_member : GroupMembers)
+            group_member->StartNextIteration();
+    }
+    inline void DependencyGroup::StartNextIterationForThisGroup()
+    {
+        // NO MUTEX LOCK
+        RemainingDependenciesCounts = DependenciesCounts; // Same size, no allocation
+        ReadySet.Clear();
+        DoneSet.Clear();
+        for (int i = 0; i < Members.size(); i++)
+            if (DependenciesCounts[i] == 0)
+                ReadySet.Add(i);
+        RemainingMembersCount = Members.size();
+    }
+
+    double DependencyGroup::PredictHigherRemainingExecutionTime()
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        return PredictRemainingExecutionTimeNoLock<true>();
+    }
+
+    double DependencyGroup::PredictLowerRemainingExecutionTime()
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        return PredictRemainingExecutionTimeNoLock<false>();
+    }
+
+    void DependencyGroup::SetBudgetPacking(bool Enabled)
+    {
+        std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        BudgetPacking = Enabled;
+    }
+    bool DependencyGroup::GetBudgetPacking()
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        return BudgetPacking;
+    }
+
+    double DependencyGroup::PredictHigherExecutionTime()
+    {
+        return HigherPrediction.load(std::memory_order_relaxed);
+    }
+    double DependencyGroup::PredictLowerExecutionTime()
+    {
+        return LowerPrediction.load(std::memory_order_relaxed);
+    }
+
+    void DependencyGroup::NotifyAvailabilityChange()
+    {
+        {
+            // Lock before MembersSharedMutex lock for modifications before notify_all()
+            std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+            std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+            NotifyingCounter++;
+        }
+        NextEventConditionVariable.notify_all();
+        Group::NotifyAvailabilityChange();
+    }
+
+    void DependencyGroup::NotifyMemberInputAvailability()
+    {
+        int wake_ups_count;
+        {
+            // Lock before MembersSharedMutex lock for modifications before notify_all()
+            std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+            std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+            NotifyingCounter++;
+            // 1 run of the module became available.
+            wake_ups_count = Waiters.GetWakeUpsCount(1, false, false);
+        }
+        TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
+    }
+
+    bool DependencyGroup::UpdateLoop(Loop * LoopPtr)
+    {
+        for (int i = 0; i < Members.size(); i++)
+        {
+            if (std::holds_alternative<std::shared_ptr<Module>>(Members[i]))
+            {
+                auto& m = std::get<std::shared_ptr<Module>>(Members[i]);
+                if (!m->SetLoop(LoopPtr))
+                {
+                    for (int j = 0; j < i; j++)
+                        if (std::holds_alternative<std::shared_ptr<Module>>(Members[j]))
+                            std::get<std::shared_ptr<Module>>(Members[j])->SetLoop(nullptr);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    template <bool Higher>
+    inline double DependencyGroup::PredictRemainingExecutionTimeNoLock()
+    {
+        // NO MUTEX LOCK
+        if (RunningThreadsCount == 0)
+            return 0;
+        // The longest path through the members that are not done,
+        // path_times[i] is the time until member i is done.
+        // Reused by each thread to avoid allocations.
+        thread_local std::vector<double> path_times;
+        path_times.assign(Members.size(), 0);
+        double result = MNIMAL_TIME;
+        auto now = std::chrono::steady_clock::now();
+        for (int i : TopologicalOrder)
+        {
+            double time = 0;
+            if (!DoneSet.Contains(i))
+            {
+                if (std::holds_alternative<std::shared_ptr<Module>>(Members[i]))
+                {
+                    auto& m = std::get<std::shared_ptr<Module>>(Members[i]);
+                    if (RunningSet.Contains(i))
+                    {
+                        std::chrono::duration<double> passed_time = now - RunInfos[i].StartTime;
+                        if constexpr (Higher)
+                            time = std::max(RunInfos[i].HigherPredictedTimeSpan - passed_time.count(), MNIMAL_TIME);
+                        else
+                            time = std::max(RunInfos[i].LowerPredictedTimeSpan - passed_time.count(), MNIMAL_TIME);
+                    }
+                    else
+                    {
+                        if constexpr (Higher)
+                            time = m->PredictHigherExecutionTime();
+                        else
+                            time = m->PredictLowerExecutionTime();
+                    }
+                }
+                else
+                {
+                    // Double mutex lock can occur if there's a group loop.
+                    auto& g = std::get<std::shared_ptr<Group>>(Members[i]);
+                    if (RunningSet.Contains(i))
+                    {
+                        if constexpr (Higher)
+                            time = g->PredictHigherRemainingExecutionTime();
+                        else
+                            time = g->PredictLowerRemainingExecutionTime();
+                    }
+                    else if (!g->IsDone())
+                    {
+                        if constexpr (Higher)
+                            time = g->PredictHigherExecutionTime();
+                        else
+                            time = g->PredictLowerExecutionTime();
+                    }
+                }
+            }
+            path_times[i] += time;
+            result = std::max(result, path_times[i]);
+            for (int j = SuccessorsStart[i]; j < SuccessorsStart[i + 1]; j++)
+                path_times[Successors[j]] = std::max(path_times[Successors[j]], path_times[i]);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,192 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+#include "ModuleHoldingGroup.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "IndexSet.h"
+#include "TargetedNotifier.h"
+
+namespace LoopScheduler
+{
+    /// @brief Represents a group member of either another group or a module.
+    ///        Used by DependencyGroup.
+    typedef std::variant<std::shared_ptr<Group>, std::shared_ptr<Module>> DependencyGroupMember;
+    /// @brief A group that runs the subgroups and modules once per iteration,
+    ///        each one as soon as the members it depends on are done.
+    ///
+    /// The dependencies are specified as pairs of member indexes, (A, B) meaning B runs after A is done.
+    /// Members without dependencies between them can run in parallel.
+    /// A module member is done when its run is finished,
+    /// a group member is done when its IsDone returns true and it's not running in any thread.
+    class DependencyGroup : public ModuleHoldingGroup
+    {
+    public:
+        /// @param Dependencies Pairs of member indexes, (A, B) meaning member B runs after member A is done.
+        ///                     Throws std::logic_error if an index is out of range or there is a cycle.
+        /// @param HigherExecutionTimePredictor Predictor to predict the higher execution time of the whole group.
+        ///                                     nullptr to use default.
+        /// @param LowerExecutionTimePredictor Predictor to predict the lower execution time of the whole group.
+        ///                                    nullptr to use default.
+        /// @param CVWaiter One waiter can be shared between different objects or have different time predictors.
+        DependencyGroup(
+            std::vector<DependencyGroupMember> Members,
+            std::vector<std::pair<int, int>> Dependencies,
+            std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor = nullptr,
+            std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor = nullptr,
+            std::shared_ptr<SmartCVWaiter> CVWaiter = nullptr
+        );
+        virtual bool RunNext(double MaxEstimatedExecutionTime = 0) override;
+        virtual bool IsRunAvailable(double MaxEstimatedExecutionTime = 0) override;
+        virtual void WaitForRunAvailability(double MaxEstimatedExecutionTime = 0, double MaxWaitingTime = 0) override;
+        virtual bool IsAvailable(double MaxEstimatedExecutionTime = 0) override;
+        virtual void WaitForAvailability(double MaxEstimatedExecutionTime = 0, double MaxWaitingTime = 0) override;
+        virtual bool IsDone() override;
+        virtual void StartNextIteration() override;
+        /// @brief Returns the higher predicted remaining time of the critical path
+        ///        through the members that are not done, using the members' predictions.
+        virtual double PredictHigherRemainingExecutionTime() override;
+        /// @brief Returns the lower predicted remaining time of the critical path
+        ///        through the members that are not done, using the members' predictions.
+        virtual double PredictLowerRemainingExecutionTime() override;
+        virtual double PredictHigherExecutionTime() override;
+        virtual double PredictLowerExecutionTime() override;
+        virtual void NotifyAvailabilityChange() override;
+        /// @brief Sets whether RunNext packs the time window when MaxEstimatedExecutionTime is provided (e.g. by Idle).
+        ///
+        /// When enabled, RunNext runs the ready module members back-to-back before returning,
+        /// each time choosing the one with the highest higher predicted execution time that fits the remaining time
+        /// (best-fit decreasing).
+        /// Group members only run as usual when no module member fits.
+        /// Disabled by default.
+        ///
+        /// Thread-safe
+        void SetBudgetPacking(bool Enabled);
+        /// @brief Thread-safe
+        bool GetBudgetPacking();
+    protected:
+        virtual bool UpdateLoop(Loop*) override;
+        virtual void FinishSuspendedRun(int MemberIndex) override;
+        virtual void NotifyMemberInputAvailability() override;
+    private:
+        /// @brief A shared mutex for class members.
+        std::shared_mutex MembersSharedMutex;
+
+        std::vector<DependencyGroupMember> Members;
+        std::vector<std::shared_ptr<Group>> GroupMembers;
+        /// @brief The successors of member i are in Successors[SuccessorsStart[i], SuccessorsStart[i + 1]).
+        std::vector<int> SuccessorsStart;
+        std::vector<int> Successors;
+        /// @brief The number of dependencies of each member.
+        std::vector<int> DependenciesCounts;
+        /// @brief The number of dependencies of each member that are not done in this iteration.
+        std::vector<int> RemainingDependenciesCounts;
+        /// @brief The member indexes in an order where each member comes after its dependencies.
+        std::vector<int> TopologicalOrder;
+
+        /// @brief The members that can run, modules until they start and groups until they're done.
+        IndexSet ReadySet;
+        /// @brief The members that have a RunCount more than 0.
+        IndexSet RunningSet;
+        IndexSet DoneSet;
+        /// @brief Atomic to check IsDone without locking.
+        std::atomic<int> RemainingMembersCount;
+        int RunningThreadsCount;
+        bool BudgetPacking;
+        /// @brief Incremented with both NextEventConditionMutex and MembersSharedMutex locked.
+        ///        Atomic to be read by the waiters' predicates without locking MembersSharedMutex.
+        std::atomic<int> NotifyingCounter;
+
+        /// @brief The run information of a member, indexed the same as Members.
+        class MemberRunInfo
+        {
+        public:
+            /// @brief The number of threads running the member.
+            int RunCount = 0;
+            /// @brief Only used for module members.
+            std::chrono::steady_clock::time_point StartTime;
+            double HigherPredictedTimeSpan = 0;
+            double LowerPredictedTimeSpan = 0;
+        };
+        std::vector<MemberRunInfo> RunInfos;
+
+        /// Is set to true on measurement start,
+        /// and set to false after the measurement.
+        /// Measurement starts on the first RunNext(...) call after StartNextIteration() is called.
+        bool MeasuringTimespan;
+        std::chrono::steady_clock::time_point IterationStartTime;
+
+        std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor;
+        std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor;
+        /// @brief The predictors' predictions, published on each observation to be read without locking.
+        std::atomic<double> HigherPrediction;
+        std::atomic<double> LowerPrediction;
+        std::shared_ptr<SmartCVWaiter> CVWaiter;
+
+        /// Must be locked BEFORE MembersSharedMutex lock
+        /// when modifying members before NextEventConditionVariable.notify_all().
+        std::mutex NextEventConditionMutex;
+        std::condition_variable NextEventConditionVariable;
+        /// @brief Counts the threads waiting on NextEventConditionVariable to wake up only the needed ones.
+        TargetedNotifier Waiters;
+
+        /// @brief Unlocks the lock if the module runs.
+        inline bool RunModule(int Index, std::unique_lock<std::shared_mutex>&);
+        /// @brief Unlocks the lock.
+        inline bool RunGroup(int Index, std::unique_lock<std::shared_mutex>&, double MaxEstimatedExecutionTime);
+        /// @brief Runs the ready module members that best fit the remaining time back-to-back. See SetBudgetPacking.
+        ///        Unlocks the lock if a module runs.
+        /// @return Whether something was run.
+        inline bool RunBestFits(std::unique_lock<std::shared_mutex>&, double MaxEstimatedExecutionTime);
+        /// @brief Releases a finished module run.
+        ///
+        /// LOCKS MUTEX
+        inline void FinishModuleRun(int Index);
+        /// @brief Marks the member as done and adds the members that have no remaining dependencies to ReadySet.
+        /// @return The number of the members that became ready,
+        ///         or TargetedNotifier::ALL if a group member became ready.
+        ///
+        /// NO MUTEX LOCK
+        inline int MarkDone(int Index);
+
+        /// NO MUTEX LOCK
+        inline bool IsRunAvailableNoLock(double MaxEstimatedExecutionTime);
+        /// LOCKS MUTEX
+        inline void WaitForAvailabilityCommon(double MaxEstimatedExecutionTime, double MaxWaitingTime);
+        /// NO SUBGROUP CALL
+        /// NO MUTEX LOCK
+        inline void StartNextIterationForThisGroup();
+        /// NO MUTEX LOCK
+        template <bool Higher>
+        inline double PredictRemainingExecutionTimeNoLock();
+    };
+}
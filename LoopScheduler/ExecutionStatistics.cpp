@@ -0,0 +1,188 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ExecutionStatistics.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace LoopScheduler
+{
+    /// @brief Assigns the shards to the threads in order.
+    static std::atomic<int> NextShardIndex(0);
+    static thread_local int ShardIndex = NextShardIndex.fetch_add(1, std::memory_order_relaxed)
+                                  % ExecutionStatistics::SHARDS_COUNT;
+
+    /// @brief The object that the calling thread is measuring a lock holding for.
+    static thread_local ExecutionStatistics * LockHoldingStatistics = nullptr;
+    static thread_local std::chrono::steady_clock::time_point LockHoldingStartTime;
+
+    ExecutionStatistics::ExecutionStatistics() : Shards(new Shard[SHARDS_COUNT])
+    {
+        for (int i = 0; i < SHARDS_COUNT; i++)
+            ResetShard(Shards[i]);
+    }
+
+    inline ExecutionStatistics::Shard& ExecutionStatistics::GetShard()
+    {
+        return Shards[ShardIndex];
+    }
+
+    inline void ExecutionStatistics::ResetShard(Shard& shard)
+    {
+        shard.RunsCount.store(0, std::memory_order_relaxed);
+        shard.TotalRunTime.store(0, std::memory_order_relaxed);
+        shard.MinRunTime.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+        shard.MaxRunTime.store(0, std::memory_order_relaxed);
+        shard.WaitsCount.store(0, std::memory_order_relaxed);
+        shard.TotalWaitingTime.store(0, std::memory_order_relaxed);
+        shard.LockHoldingsCount.store(0, std::memory_order_relaxed);
+        shard.TotalLockHoldingTime.store(0, std::memory_order_relaxed);
+        for (auto& bucket : shard.Histogram)
+            bucket.store(0, std::memory_order_relaxed);
+    }
+
+    inline std::uint64_t ExecutionStatistics::ToNanoseconds(double Time)
+    {
+        return Time > 0 ? (std::uint64_t)std::llround(Time * 1e9) : 0;
+    }
+
+    inline int ExecutionStatistics::GetBucketIndex(std::uint64_t Time)
+    {
+        if (Time < 4)
+            return (int)Time;
+        // 4 buckets per power of 2, using the 2 bits after the most significant bit.
+        int msb = std::bit_width(Time) - 1;
+        int index = (msb - 1) * 4 + (int)((Time >> (msb - 2)) & 3);
+        return std::min(index, HISTOGRAM_BUCKETS_COUNT - 1);
+    }
+
+    inline double ExecutionStatistics::GetBucketValue(int Index)
+    {
+        if (Index < 4)
+            return Index;
+        int msb = Index / 4 + 1;
+        double lower = std::ldexp(4 + Index % 4, msb - 2);
+        double upper = std::ldexp(5 + Index % 4, msb - 2);
+        return (lower + upper) / 2;
+    }
+
+    void ExecutionStatistics::ReportRun(double Time)
+    {
+        auto time = ToNanoseconds(Time);
+        auto& shard = GetShard();
+        shard.RunsCount.fetch_add(1, std::memory_order_relaxed);
+        shard.TotalRunTime.fetch_add(time, std::memory_order_relaxed);
+        auto min = shard.MinRunTime.load(std::memory_order_relaxed);
+        while (time < min && !shard.MinRunTime.compare_exchange_weak(min, time, std::memory_order_relaxed));
+        auto max = shard.MaxRunTime.load(std::memory_order_relaxed);
+        while (time > max && !shard.MaxRunTime.compare_exchange_weak(max, time, std::memory_order_relaxed));
+        shard.Histogram[GetBucketIndex(time)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void ExecutionStatistics::ReportWaiting(double Time)
+    {
+        auto& shard = GetShard();
+        shard.WaitsCount.fetch_add(1, std::memory_order_relaxed);
+        shard.TotalWaitingTime.fetch_add(ToNanoseconds(Time), std::memory_order_relaxed);
+    }
+
+    void ExecutionStatistics::ReportLockHolding(double Time)
+    {
+        auto& shard = GetShard();
+        shard.LockHoldingsCount.fetch_add(1, std::memory_order_relaxed);
+        shard.TotalLockHoldingTime.fetch_add(ToNanoseconds(Time), std::memory_order_relaxed);
+    }
+
+    void ExecutionStatistics::StartLockHolding()
+    {
+        LockHoldingStatistics = this;
+        LockHoldingStartTime = std::chrono::steady_clock::now();
+    }
+
+    void ExecutionStatistics::StopLockHolding()
+    {
+        if (LockHoldingStatistics != this)
+            return;
+        LockHoldingStatistics = nullptr;
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - LockHoldingStartTime;
+        ReportLockHolding(duration.count());
+    }
+
+    ExecutionStatistics::Snapshot ExecutionStatistics::GetSnapshot()
+    {
+        Snapshot result;
+        std::uint64_t total_run_time = 0;
+        std::uint64_t min_run_time = std::numeric_limits<std::uint64_t>::max();
+        std::uint64_t max_run_time = 0;
+        std::uint64_t total_waiting_time = 0;
+        std::uint64_t total_lock_holding_time = 0;
+        std::uint64_t histogram[HISTOGRAM_BUCKETS_COUNT] = {};
+        for (int i = 0; i < SHARDS_COUNT; i++)
+        {
+            auto& shard = Shards[i];
+            result.RunsCount += shard.RunsCount.load(std::memory_order_relaxed);
+            total_run_time += shard.TotalRunTime.load(std::memory_order_relaxed);
+            min_run_time = std::min(min_run_time, shard.MinRunTime.load(std::memory_order_relaxed));
+            max_run_time = std::max(max_run_time, shard.MaxRunTime.load(std::memory_order_relaxed));
+            result.WaitsCount += shard.WaitsCount.load(std::memory_order_relaxed);
+            total_waiting_time += shard.TotalWaitingTime.load(std::memory_order_relaxed);
+            result.LockHoldingsCount += shard.LockHoldingsCount.load(std::memory_order_relaxed);
+            total_lock_holding_time += shard.TotalLockHoldingTime.load(std::memory_order_relaxed);
+            for (int j = 0; j < HISTOGRAM_BUCKETS_COUNT; j++)
+                histogram[j] += shard.Histogram[j].load(std::memory_order_relaxed);
+        }
+        result.TotalWaitingTime = total_waiting_time * 1e-9;
+        result.TotalLockHoldingTime = total_lock_holding_time * 1e-9;
+        if (result.RunsCount == 0)
+            return result;
+        result.MinRunTime = min_run_time * 1e-9;
+        result.MaxRunTime = max_run_time * 1e-9;
+        result.MeanRunTime = total_run_time * 1e-9 / result.RunsCount;
+
+        std::uint64_t histogram_count = 0;
+        for (auto count : histogram)
+            histogram_count += count;
+        const auto percentile = [&](double fraction) {
+            auto target = (std::uint64_t)std::ceil(fraction * histogram_count);
+            std::uint64_t cumulative_count = 0;
+            for (int i = 0; i < HISTOGRAM_BUCKETS_COUNT; i++)
+            {
+                cumulative_count += histogram[i];
+                if (cumulative_count >= target && cumulative_count != 0)
+                    return std::clamp(GetBucketValue(i) * 1e-9, result.MinRunTime, result.MaxRunTime);
+            }
+            return result.MaxRunTime;
+        };
+        result.P50RunTime = percentile(0.50);
+        result.P95RunTime = percentile(0.95);
+        result.P99RunTime = percentile(0.99);
+        return result;
+    }
+
+    void ExecutionStatistics::Reset()
+    {
+        for (int i = 0; i < SHARDS_COUNT; i++)
+            ResetShard(Shards[i]);
+    }
+}
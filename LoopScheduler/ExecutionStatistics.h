@@ -0,0 +1,107 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace LoopScheduler
+{
+    /// @brief Records the execution statistics of a module or a group.
+    ///
+    /// Recording is lock-free, the counters are sharded between the threads and merged on read.
+    /// Thread-safe.
+    class ExecutionStatistics final
+    {
+    public:
+        ExecutionStatistics();
+
+        /// @brief A merged copy of the statistics. Times are in seconds.
+        class Snapshot
+        {
+        public:
+            /// @brief The number of module runs or group iterations.
+            std::uint64_t RunsCount = 0;
+            double MinRunTime = 0;
+            double MaxRunTime = 0;
+            double MeanRunTime = 0;
+            /// @brief The percentiles are approximated using a histogram with 4 buckets per power of 2.
+            double P50RunTime = 0;
+            double P95RunTime = 0;
+            double P99RunTime = 0;
+            /// @brief The number of times a thread waited for availability.
+            std::uint64_t WaitsCount = 0;
+            double TotalWaitingTime = 0;
+            /// @brief The number of times the lock was held.
+            std::uint64_t LockHoldingsCount = 0;
+            double TotalLockHoldingTime = 0;
+        };
+
+        /// @brief Reports a module run's or a group iteration's time in seconds.
+        void ReportRun(double Time);
+        /// @brief Reports a time spent waiting for availability in seconds.
+        void ReportWaiting(double Time);
+        /// @brief Reports a time that the lock was held in seconds.
+        void ReportLockHolding(double Time);
+        /// @brief Starts measuring a lock holding in the calling thread.
+        ///
+        /// Only one measurement per thread, a new one replaces the previous one.
+        void StartLockHolding();
+        /// @brief Reports the time since StartLockHolding was called in the calling thread.
+        ///        Does nothing if it wasn't started for this object or it's already stopped.
+        void StopLockHolding();
+
+        /// @brief Merges the shards. Can be called from outside the loop while it's running.
+        Snapshot GetSnapshot();
+        /// @brief Clears the statistics. The recordings at the same time may be partially cleared.
+        void Reset();
+
+        static constexpr int SHARDS_COUNT = 16;
+        static constexpr int HISTOGRAM_BUCKETS_COUNT = 160;
+    private:
+        /// @brief The counters of the threads that map to this shard. Times are in nanoseconds.
+        class alignas(64) Shard
+        {
+        public:
+            std::atomic<std::uint64_t> RunsCount;
+            std::atomic<std::uint64_t> TotalRunTime;
+            std::atomic<std::uint64_t> MinRunTime;
+            std::atomic<std::uint64_t> MaxRunTime;
+            std::atomic<std::uint64_t> WaitsCount;
+            std::atomic<std::uint64_t> TotalWaitingTime;
+            std::atomic<std::uint64_t> LockHoldingsCount;
+            std::atomic<std::uint64_t> TotalLockHoldingTime;
+            std::atomic<std::uint64_t> Histogram[HISTOGRAM_BUCKETS_COUNT];
+        };
+        std::unique_ptr<Shard[]> Shards;
+
+        /// @brief Returns the calling thread's shard.
+        inline Shard& GetShard();
+        inline void ResetShard(Shard&);
+        static inline std::uint64_t ToNanoseconds(double Time);
+        static inline int GetBucketIndex(std::uint64_t Time);
+        /// @brief Returns the middle of the bucket in nanoseconds.
+        static inline double GetBucketValue(int Index);
+    };
+}
@@ -0,0 +1,189 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "FixedTimestepGroup.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace LoopScheduler
+{
+    FixedTimestepGroup::FixedTimestepGroup(std::shared_ptr<Group> Member, double TimeStep, int MaxStepsPerIteration)
+        : Member(Member), TimeStep(TimeStep), MaxStepsPerIteration(MaxStepsPerIteration),
+          AccumulatedTime(0), HasLastIterationStartTime(false), StepsCount(1), RemainingStepsCount(1)
+    {
+        if (TimeStep <= 0)
+            throw std::logic_error("The timestep has to be more than 0.");
+        if (MaxStepsPerIteration < 1)
+            throw std::logic_error("The maximum steps per iteration has to be at least 1.");
+        IntroduceMembers({ Member });
+    }
+
+    bool FixedTimestepGroup::RunNext(double MaxEstimatedExecutionTime)
+    {
+        std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        StartMeasuringLockHolding();
+        if (RemainingStepsCount == 0)
+        {
+            StopMeasuringLockHolding();
+            lock.unlock();
+            return RunUnfinishedMemberGroup(MaxEstimatedExecutionTime);
+        }
+        if (!HasLastIterationStartTime)
+        {
+            LastIterationStartTime = std::chrono::steady_clock::now();
+            HasLastIterationStartTime = true;
+        }
+        if (Member->IsDone())
+        {
+            if (RemainingStepsCount == 1)
+            {
+                StopMeasuringLockHolding();
+                lock.unlock();
+                return RunUnfinishedMemberGroup(MaxEstimatedExecutionTime);
+            }
+            RemainingStepsCount--;
+            Member->StartNextIteration();
+        }
+        StopMeasuringLockHolding();
+        lock.unlock();
+        return Member->RunNext(MaxEstimatedExecutionTime);
+    }
+
+    bool FixedTimestepGroup::IsRunAvailable(double MaxEstimatedExecutionTime)
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        if (RemainingStepsCount == 0 || (RemainingStepsCount == 1 && Member->IsDone())) // IsDone()
+            return IsUnfinishedMemberGroupRunAvailable(MaxEstimatedExecutionTime);
+        if (Member->IsDone())
+            return true; // The next step can start
+        return Member->IsRunAvailable(MaxEstimatedExecutionTime);
+    }
+    bool FixedTimestepGroup::IsAvailable(double MaxEstimatedExecutionTime)
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        if (RemainingStepsCount == 0)
+            return true;
+        // True when the member is done too, which is either IsDone or the next step can start.
+        return Member->IsAvailable(MaxEstimatedExecutionTime);
+    }
+
+    void FixedTimestepGroup::WaitForRunAvailability(double MaxEstimatedExecutionTime, double MaxWaitingTime)
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        if (RemainingStepsCount == 0)
+        {
+            lock.unlock();
+            WaitForUnfinishedMemberGroup(MaxEstimatedExecutionTime, MaxWaitingTime);
+            return;
+        }
+        bool is_last_step = RemainingStepsCount == 1;
+        lock.unlock();
+        // The member notifies its own events, when it's done the next step can start.
+        if (is_last_step)
+            Member->WaitForRunAvailability(MaxEstimatedExecutionTime, MaxWaitingTime);
+        else
+            Member->WaitForAvailability(MaxEstimatedExecutionTime, MaxWaitingTime);
+    }
+    void FixedTimestepGroup::WaitForAvailability(double MaxEstimatedExecutionTime, double MaxWaitingTime)
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        if (RemainingStepsCount == 0)
+            return;
+        lock.unlock();
+        Member->WaitForAvailability(MaxEstimatedExecutionTime, MaxWaitingTime);
+    }
+
+    bool FixedTimestepGroup::IsDone()
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        return RemainingStepsCount == 0 || (RemainingStepsCount == 1 && Member->IsDone());
+    }
+
+    void FixedTimestepGroup::StartNextIteration()
+    {
+        std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        auto now = std::chrono::steady_clock::now();
+        if (HasLastIterationStartTime)
+        {
+            std::chrono::duration<double> passed_time = now - LastIterationStartTime;
+            AccumulatedTime += passed_time.count();
+            StepsCount = std::min((int)(AccumulatedTime / TimeStep), MaxStepsPerIteration);
+            AccumulatedTime -= StepsCount * TimeStep;
+            if (AccumulatedTime >= TimeStep) // Dropped
+                AccumulatedTime = std::fmod(AccumulatedTime, TimeStep);
+        }
+        else
+        {
+            StepsCount = 1;
+        }
+        LastIterationStartTime = now;
+        HasLastIterationStartTime = true;
+        RemainingStepsCount = StepsCount;
+        if (StepsCount != 0)
+            Member->StartNextIteration();
+    }
+
+    double FixedTimestepGroup::PredictHigherRemainingExecutionTime()
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        double remaining_time = Member->PredictHigherRemainingExecutionTime();
+        if (remaining_time == 0 || RemainingStepsCount <= 1)
+            return remaining_time;
+        return remaining_time + (RemainingStepsCount - 1) * Member->PredictHigherExecutionTime();
+    }
+
+    double FixedTimestepGroup::PredictLowerRemainingExecutionTime()
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        double remaining_time = Member->PredictLowerRemainingExecutionTime();
+        if (remaining_time == 0 || RemainingStepsCount <= 1)
+            return remaining_time;
+        return remaining_time + (RemainingStepsCount - 1) * Member->PredictLowerExecutionTime();
+    }
+
+    double FixedTimestepGroup::PredictHigherExecutionTime()
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        return StepsCount * Member->PredictHigherExecutionTime();
+    }
+    double FixedTimestepGroup::PredictLowerExecutionTime()
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        return StepsCount * Member->PredictLowerExecutionTime();
+    }
+
+    double FixedTimestepGroup::GetInterpolationFactor()
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        return AccumulatedTime / TimeStep;
+    }
+
+    double FixedTimestepGroup::GetTimeStep()
+    {
+        return TimeStep;
+    }
+
+    bool FixedTimestepGroup::UpdateLoop(Loop * /*LoopPtr*/)
+    {
+        return true; // No module members
+    }
+}
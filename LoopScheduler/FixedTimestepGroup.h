@@ -0,0 +1,86 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+#include "Group.h"
+
+#include <chrono>
+#include <memory>
+#include <shared_mutex>
+
+namespace LoopScheduler
+{
+    /// @brief A group that runs the iterations of its member group at a fixed timestep.
+    ///
+    /// On each iteration, the real time passed since the previous iteration's start is accumulated,
+    /// and the member group runs one iteration per whole timestep in the accumulated time.
+    /// This is used for a fixed-update/variable-render split,
+    /// e.g., a SequentialGroup with a FixedTimestepGroup of the simulation and then the rendering modules,
+    /// where the rendering interpolates using GetInterpolationFactor().
+    /// The first iteration runs the member group once.
+    class FixedTimestepGroup : public Group
+    {
+    public:
+        /// @param Member The group to run at a fixed timestep.
+        /// @param TimeStep The timestep in seconds.
+        /// @param MaxStepsPerIteration The maximum number of the member's iterations in each iteration.
+        ///                             The accumulated time beyond it is dropped to avoid falling behind more and more.
+        FixedTimestepGroup(std::shared_ptr<Group> Member, double TimeStep, int MaxStepsPerIteration = 4);
+        virtual bool RunNext(double MaxEstimatedExecutionTime = 0) override;
+        virtual bool IsRunAvailable(double MaxEstimatedExecutionTime = 0) override;
+        virtual void WaitForRunAvailability(double MaxEstimatedExecutionTime = 0, double MaxWaitingTime = 0) override;
+        virtual bool IsAvailable(double MaxEstimatedExecutionTime = 0) override;
+        virtual void WaitForAvailability(double MaxEstimatedExecutionTime = 0, double MaxWaitingTime = 0) override;
+        virtual bool IsDone() override;
+        virtual void StartNextIteration() override;
+        virtual double PredictHigherRemainingExecutionTime() override;
+        virtual double PredictLowerRemainingExecutionTime() override;
+        /// @brief Returns the member's higher predicted execution time for the steps of the current iteration.
+        virtual double PredictHigherExecutionTime() override;
+        /// @brief Returns the member's lower predicted execution time for the steps of the current iteration.
+        virtual double PredictLowerExecutionTime() override;
+        /// @brief Returns the accumulated time that is not run yet as a fraction of the timestep, in [0, 1).
+        ///        Used to interpolate between the last 2 steps.
+        ///
+        /// Thread-safe
+        double GetInterpolationFactor();
+        /// @brief Returns the timestep in seconds.
+        double GetTimeStep();
+    protected:
+        virtual bool UpdateLoop(Loop*) override;
+    private:
+        /// @brief A shared mutex for class members.
+        std::shared_mutex MembersSharedMutex;
+
+        std::shared_ptr<Group> Member;
+        const double TimeStep;
+        const int MaxStepsPerIteration;
+
+        double AccumulatedTime;
+        bool HasLastIterationStartTime;
+        std::chrono::steady_clock::time_point LastIterationStartTime;
+        /// @brief The number of the member's iterations in the current iteration.
+        int StepsCount;
+        /// @brief The number of the member's iterations remaining in the current iteration, including the running one.
+        int RemainingStepsCount;
+    };
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+namespace LoopScheduler
+{
+    /// @brief Buffers of a state that producer and consumer modules exchange without locking, keyed by the frames' indexes
+    ///        (see Module::GetFrame).
+    ///
+    /// The producer writes a frame's data to the frame's buffer and publishes it,
+    /// and the consumers read it using the frame's index, e.g. the previous frame's data while the next one is being written.
+    /// A buffer is reused BuffersCount frames later, so BuffersCount has to be greater than the number of frames
+    /// from a frame's producer run to the last consumer run that reads its data:
+    /// 2 when the consumers read the previous frame's data and the iterations don't overlap,
+    /// at least PipelineDepth + 1 when they do in a pipelined SequentialGroup.
+    ///
+    /// @tparam T The type of the state.
+    /// @tparam BuffersCount The number of the buffers, at least 2.
+    template <typename T, int BuffersCount = 2>
+    class FrameBuffer final
+    {
+        static_assert(BuffersCount >= 2, "FrameBuffer needs at least 2 buffers.");
+    public:
+        /// @param InitialValue The initial value of all the buffers.
+        FrameBuffer(const T& InitialValue = T())
+        {
+            Buffers.fill(InitialValue);
+            for (auto& frame_index : PublishedFrameIndexes)
+                frame_index.store(-1, std::memory_order_relaxed);
+        }
+        FrameBuffer(const FrameBuffer&) = delete;
+        FrameBuffer& operator=(const FrameBuffer&) = delete;
+
+        /// @brief Returns the buffer to write the frame's data to, making the data that it had unreadable.
+        ///        The buffer still contains the data written BuffersCount frames before, if any.
+        ///
+        /// Only 1 thread can write each frame's data.
+        /// Throws std::invalid_argument if the frame's index is negative, like an empty FrameContext's.
+        T& GetWriteBuffer(std::int64_t FrameIndex)
+        {
+            ThrowIfNegative(FrameIndex);
+            int index = GetBufferIndex(FrameIndex);
+            PublishedFrameIndexes[index].store(-1, std::memory_order_relaxed);
+            return Buffers[index];
+        }
+        /// @brief Makes the data written to the frame's buffer readable.
+        ///        Throws std::invalid_argument if the frame's index is negative.
+        void Publish(std::int64_t FrameIndex)
+        {
+            ThrowIfNegative(FrameIndex);
+            PublishedFrameIndexes[GetBufferIndex(FrameIndex)].store(FrameIndex, std::memory_order_release);
+        }
+        /// @brief Returns the data published for the frame, nullptr if it's not published or its buffer is reused.
+        ///
+        /// Thread-safe
+        const T* GetReadBuffer(std::int64_t FrameIndex) const
+        {
+            if (FrameIndex < 0)
+                return nullptr;
+            int index = GetBufferIndex(FrameIndex);
+            if (PublishedFrameIndexes[index].load(std::memory_order_acquire) != FrameIndex)
+                return nullptr;
+            return &Buffers[index];
+        }
+        /// @brief Returns the latest data published for a frame before the given one, nullptr if there's none,
+        ///        for the producers that don't run on every frame (see RunPeriod).
+        ///
+        /// Thread-safe
+        ///
+        /// @param PublishedFrameIndex Set to the index of the returned data's frame if not nullptr.
+        const T* GetLatestReadBuffer(std::int64_t FrameIndex, std::int64_t * PublishedFrameIndex = nullptr) const
+        {
+            int result = -1;
+            std::int64_t result_frame_index = -1;
+            for (int i = 0; i < BuffersCount; i++)
+            {
+                std::int64_t frame_index = PublishedFrameIndexes[i].load(std::memory_order_acquire);
+                if (frame_index < FrameIndex && frame_index > result_frame_index)
+                {
+                    result = i;
+                    result_frame_index = frame_index;
+                }
+            }
+            if (PublishedFrameIndex != nullptr)
+                *PublishedFrameIndex = result_frame_index;
+            return result == -1 ? nullptr : &Buffers[result];
+        }
+    private:
+        std::array<T, BuffersCount> Buffers;
+        /// @brief The frame of each buffer's published data, -1 if it's not published.
+        std::array<std::atomic<std::int64_t>, BuffersCount> PublishedFrameIndexes;
+
+        static int GetBufferIndex(std::int64_t FrameIndex)
+        {
+            return (int)(FrameIndex % BuffersCount);
+        }
+        static void ThrowIfNegative(std::int64_t FrameIndex)
+        {
+            if (FrameIndex < 0)
+                throw std::invalid_argument("A frame's index cannot be negative.");
+        }
+    };
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace LoopScheduler
+{
+    /// @brief The information of a loop iteration (frame), available to the modules using Module::GetFrame.
+    ///
+    /// A module's run belongs to the loop's current iteration when the run starts,
+    /// or to an older one when the iterations overlap, like in a pipelined SequentialGroup.
+    struct FrameContext final
+    {
+    public:
+        /// @brief Creates an empty context, with Index = -1.
+        FrameContext();
+        FrameContext(
+            std::int64_t Index,
+            std::chrono::steady_clock::time_point StartTime,
+            double DeltaTime,
+            double PredictedBudget
+        );
+        /// @brief The iteration's index, counted from 0 from the loop's first iteration. -1 if the context is empty.
+        std::int64_t Index;
+        /// @brief When the iteration started.
+        std::chrono::steady_clock::time_point StartTime;
+        /// @brief The time between the previous iteration's start and this one's in seconds,
+        ///        0 for the first iteration of each Loop::Run.
+        double DeltaTime;
+        /// @brief The time that the iteration is expected to take in seconds,
+        ///        the loop's target period if it's paced, otherwise the architecture's higher predicted execution time.
+        double PredictedBudget;
+    };
+}
@@ -26,11 +26,12 @@
 #include <stdexcept>
 #include <utility>
 
+#include "ExecutionStatistics.h"
 #include "Module.h"
 
 namespace LoopScheduler
 {
-    Group::Group() : Parent(nullptr), LoopPtr(nullptr) {}
+    Group::Group() : Parent(nullptr), LoopPtr(nullptr), Statistics(nullptr) {}
 
     Group::~Group()
     {
@@ -59,6 +60,140 @@ namespace LoopScheduler
         return LoopPtr;
     }
 
+    bool Group::IsFinished()
+    {
+        return IsDone() && AreMemberGroupsFinished();
+    }
+
+    bool Group::AreMemberGroupsFinished()
+    {
+        for (auto& member : MemberGroups)
+            if (!member->IsFinished())
+                return false;
+        return true;
+    }
+    bool Group::RunUnfinishedMemberGroup(double MaxEstimatedExecutionTime)
+    {
+        for (auto& member : MemberGroups)
+            if (!member->IsFinished() && member->RunNext(MaxEstimatedExecutionTime))
+                return true;
+        return false;
+    }
+    bool Group::IsUnfinishedMemberGroupRunAvailable(double MaxEstimatedExecutionTime)
+    {
+        for (auto& member : MemberGroups)
+            if (!member->IsFinished() && member->IsRunAvailable(MaxEstimatedExecutionTime))
+                return true;
+        return false;
+    }
+    void Group::WaitForUnfinishedMemberGroup(double MaxEstimatedExecutionTime, double MaxWaitingTime)
+    {
+        for (auto& member : MemberGroups)
+        {
+            if (!member->IsFinished())
+            {
+                member->WaitForRunAvailability(MaxEstimatedExecutionTime, MaxWaitingTime);
+                return;
+            }
+        }
+    }
+
+    void Group::NotifyAvailabilityChange()
+    {
+        for (auto& member : MemberGroups)
+            member->NotifyAvailabilityChange();
+    }
+
+    void Group::EnableStatistics()
+    {
+        std::unique_lock<std::shared_mutex> lock(SharedMutex);
+        if (StatisticsPtr != nullptr)
+            return;
+        StatisticsPtr = std::unique_ptr<ExecutionStatistics>(new ExecutionStatistics());
+        Statistics.store(StatisticsPtr.get(), std::memory_order_release);
+    }
+
+    ExecutionStatistics * Group::GetStatistics()
+    {
+        return Statistics.load(std::memory_order_acquire);
+    }
+
+    void Group::StartMeasuringLockHolding()
+    {
+        if (auto statistics = Statistics.load(std::memory_order_acquire))
+            statistics->StartLockHolding();
+    }
+
+    void Group::StopMeasuringLockHolding()
+    {
+        if (auto statistics = Statistics.load(std::memory_order_acquire))
+            statistics->StopLockHolding();
+    }
+
+    int Group::ReserveNext(
+            std::vector<ReservedRun>& /*Output*/, int /*MaxCount*/, const std::function<void()>& /*OnReserved*/
+        )
+    {
+        return 0;
+    }
+
+    Group::ReservedRun Group::CreateReservedRun(int MemberIndex, Module::RunningToken&& Token)
+    {
+        return ReservedRun(this, MemberIndex, std::move(Token));
+    }
+
+    void Group::RunReserved(int /*MemberIndex*/, Module::RunningToken& Token)
+    {
+        Token.Run();
+    }
+
+    void Group::CancelReserved(int /*MemberIndex*/) {}
+
+    void Group::FinishSuspendedRun(int /*MemberIndex*/) {}
+    void Group::NotifyMemberInputAvailability() {}
+
+    Group::ReservedRun::ReservedRun() : Owner(nullptr), MemberIndex(-1) {}
+    Group::ReservedRun::ReservedRun(Group * Owner, int MemberIndex, Module::RunningToken&& Token)
+        : Owner(Owner), MemberIndex(MemberIndex), Token(std::move(Token))
+    {}
+    Group::ReservedRun::ReservedRun(ReservedRun&& op) : Token(std::move(op.Token))
+    {
+        Owner = std::exchange(op.Owner, nullptr);
+        MemberIndex = std::exchange(op.MemberIndex, -1);
+    }
+    Group::ReservedRun& Group::ReservedRun::operator=(ReservedRun&& op)
+    {
+        if (this == &op)
+            return *this;
+        Cancel();
+        Owner = std::exchange(op.Owner, nullptr);
+        MemberIndex = std::exchange(op.MemberIndex, -1);
+        Token = std::move(op.Token);
+        return *this;
+    }
+    Group::ReservedRun::~ReservedRun()
+    {
+        Cancel();
+    }
+    inline void Group::ReservedRun::Cancel()
+    {
+        if (Owner == nullptr)
+            return;
+        auto owner = std::exchange(Owner, nullptr);
+        {
+            // Releases the module before releasing the reservation in the group
+            Module::RunningToken token = std::move(Token);
+        }
+        owner->CancelReserved(MemberIndex);
+    }
+    void Group::ReservedRun::Run()
+    {
+        if (Owner == nullptr)
+            return;
+        auto owner = std::exchange(Owner, nullptr);
+        owner->RunReserved(MemberIndex, Token);
+    }
+
     void Group::IntroduceMembers(std::vector<std::shared_ptr<Group>> MemberGroups)
     {
         if (this->MemberGroups.size() != 0)
@@ -22,11 +22,15 @@
 
 #include "LoopScheduler.dec.h"
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <shared_mutex>
 #include <variant>
 #include <vector>
 
+#include "Module.h"
+
 namespace LoopScheduler
 {
     /// @brief Represents a group of runnable objects or (optionally) other groups scheduled in a certain way.
@@ -37,6 +41,7 @@ namespace LoopScheduler
     class Group
     {
         friend Loop;
+        friend Module;
     public:
         Group();
         virtual ~Group();
@@ -63,6 +68,12 @@ namespace LoopScheduler
         virtual void WaitForAvailability(double MaxEstimatedExecutionTime = 0, double MaxWaitingTime = 0) = 0;
         /// @brief Thread-safe method to check whether the group is ready to finish the iteration.
         virtual bool IsDone() = 0;
+        /// @brief Thread-safe method to check whether the group's iterations are all finished,
+        ///        including the ones that overlap the next iterations, like in a pipelined SequentialGroup.
+        ///
+        /// The loop waits for this before stopping.
+        /// The default implementation returns whether IsDone() and the member groups' IsFinished() return true.
+        virtual bool IsFinished();
         /// @brief Thread-safe method to start a new iteration.
         virtual void StartNextIteration() = 0;
         /// @brief Returns the higher predicted remaining execution time in seconds.
@@ -81,12 +92,124 @@ namespace LoopScheduler
         ///
         /// Thread-safe
         virtual double PredictLowerExecutionTime() = 0;
+        /// @brief Wakes up the threads waiting for availability in the group and its member groups,
+        ///        to return and check again.
+        ///
+        /// Used when something the waiting threads can run became available outside the group,
+        /// like the chunks of a Module::ParallelFor.
+        /// The default implementation only calls this for the member groups.
+        ///
+        /// Thread-safe
+        virtual void NotifyAvailabilityChange();
         /// @brief Returns the group's parent group.
         Group * GetParent();
         /// @brief Returns the group's group members.
         std::vector<std::weak_ptr<Group>> GetMemberGroups();
         Loop * GetLoop();
+
+        /// @brief Starts recording the execution statistics. Can't be disabled after being enabled.
+        ///
+        /// The runs are the group's iterations, measured the same as for the group's predictors.
+        /// The waiting time is the time spent in WaitForAvailability and WaitForRunAvailability.
+        /// The lock holding time is the time the group's lock is held in RunNext to decide what to run next.
+        ///
+        /// Thread-safe
+        void EnableStatistics();
+        /// @brief Returns the statistics, or nullptr if not enabled.
+        ///        The object is valid as long as the group is.
+        ///
+        /// Thread-safe
+        ExecutionStatistics * GetStatistics();
+
+        /// @brief A run reserved by ReserveNext to be run later, possibly in another thread.
+        ///
+        /// The reservation is held until the object is run or destructed.
+        /// Not thread-safe, use in a single thread.
+        class ReservedRun final
+        {
+            friend Group;
+        public:
+            /// @brief Creates an empty object that doesn't run anything.
+            ReservedRun();
+            ReservedRun(ReservedRun&) = delete;
+            ReservedRun(ReservedRun&&);
+            ReservedRun& operator=(ReservedRun&) = delete;
+            ReservedRun& operator=(ReservedRun&&);
+            ~ReservedRun();
+            /// @brief Runs the reserved run and releases the reservation. Only works once per object.
+            void Run();
+        private:
+            ReservedRun(Group * Owner, int MemberIndex, Module::RunningToken&& Token);
+            /// @brief Cancels the reservation if not used.
+            inline void Cancel();
+            Group * Owner;
+            int MemberIndex;
+            Module::RunningToken Token;
+        };
+        friend ReservedRun;
+
+        /// @brief Thread-safe method to reserve the next things to run without running them.
+        ///
+        /// Used by executors that distribute the runs themselves, like the Loop's work-stealing executor.
+        /// Reserved runs count as running in the group until they are run or destructed.
+        /// The default implementation doesn't reserve anything, RunNext should be used instead.
+        ///
+        /// @param Output Reserved runs are appended to this vector.
+        /// @param MaxCount Maximum number of runs to reserve.
+        /// @param OnReserved Called when something is reserved, before waking up the threads waiting for the group,
+        ///                   e.g. to make the reserved runs available to them.
+        /// @return The number of reserved runs.
+        virtual int ReserveNext(
+            std::vector<ReservedRun>& Output, int MaxCount, const std::function<void()>& OnReserved = nullptr
+        );
     protected:
+        /// @brief Used by derived classes to create ReservedRun objects in ReserveNext.
+        ///
+        /// @param MemberIndex An index defined by the derived class, passed back to RunReserved or CancelReserved.
+        /// @param Token A token that can run.
+        ReservedRun CreateReservedRun(int MemberIndex, Module::RunningToken&& Token);
+        /// @brief Called once by ReservedRun::Run, in the thread that runs it.
+        ///        Should run the token and release the reservation.
+        ///
+        /// The default implementation only runs the token.
+        virtual void RunReserved(int MemberIndex, Module::RunningToken& Token);
+        /// @brief Called once when a ReservedRun object is destructed without running.
+        ///        Should release the reservation. The token is already released.
+        ///
+        /// The default implementation does nothing.
+        virtual void CancelReserved(int MemberIndex);
+        /// @brief Called once by the module when a run that was suspended is finished (see Module::RunningToken::Run(Group*, int)),
+        ///        possibly in another thread. Should release the run like when a module's run is finished.
+        ///
+        /// The default implementation does nothing, it's only called for the groups that run modules using Run(Group*, int).
+        virtual void FinishSuspendedRun(int MemberIndex);
+        /// @brief Called by a module member, or a member group's module, when its input became available
+        ///        (see Module::NotifyInputAvailability), possibly in another thread.
+        ///        Should wake up the threads waiting in the group itself, not the ones in its member groups.
+        ///
+        /// The module calls this for its parent group and the parent's ancestors.
+        /// The default implementation does nothing, for the groups that don't have their own waiting threads.
+        virtual void NotifyMemberInputAvailability();
+        /// @brief Returns whether all the member groups' IsFinished() return true.
+        bool AreMemberGroupsFinished();
+        /// @brief Runs the next thing in a member group that is not finished (see IsFinished),
+        ///        like a pipelined SequentialGroup with iterations in progress.
+        ///
+        /// Used by the derived classes when they're done and have nothing else to run,
+        /// so that the member groups' iterations finish before the loop stops.
+        /// Call without the derived class's lock.
+        ///
+        /// @return Whether something was run.
+        bool RunUnfinishedMemberGroup(double MaxEstimatedExecutionTime);
+        /// @brief Checks whether a member group that is not finished has something available to run via RunNext.
+        bool IsUnfinishedMemberGroupRunAvailable(double MaxEstimatedExecutionTime);
+        /// @brief Waits for run availability in a member group that is not finished, returns if there is none.
+        ///        Call without the derived class's lock.
+        void WaitForUnfinishedMemberGroup(double MaxEstimatedExecutionTime, double MaxWaitingTime);
+        /// @brief Starts measuring the time the group's lock is held in the calling thread, if the statistics are enabled.
+        void StartMeasuringLockHolding();
+        /// @brief Reports the time since StartMeasuringLockHolding in the calling thread, if it's not already reported.
+        void StopMeasuringLockHolding();
         /// @brief Has to be called once in the derived class's constructor.
         ///
         /// Members list change should not be allowed.
@@ -116,5 +239,9 @@ namespace LoopScheduler
         Loop * LoopPtr;
         std::vector<std::shared_ptr<Group>> MemberGroups;
         std::vector<std::weak_ptr<Group>> WeakMemberGroups;
+
+        std::unique_ptr<ExecutionStatistics> StatisticsPtr;
+        /// @brief Set once by EnableStatistics, read without locking.
+        std::atomic<ExecutionStatistics*> Statistics;
     };
 }
@@ -0,0 +1,177 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "IdlingHelperPool.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "Group.h"
+#include "Loop.h"
+
+namespace LoopScheduler
+{
+    IdlingHelperPool::IdlingHelperPool(Loop * LoopPtr)
+        : LoopPtr(LoopPtr), MaxHelpersCount(std::max((int)std::thread::hardware_concurrency(), 1))
+    {}
+
+    IdlingHelperPool::~IdlingHelperPool()
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        for (auto& helper : Helpers)
+        {
+            std::unique_lock<std::mutex> helper_lock(helper->Mutex);
+            helper->ShouldExit = true;
+            helper->ShouldStop = true;
+            helper_lock.unlock();
+            helper->ConditionVariable.notify_all();
+        }
+        for (auto& helper : Helpers)
+            if (helper->Thread.joinable())
+                helper->Thread.join();
+    }
+
+    int IdlingHelperPool::Start(double MaxWaitingTimeAfterStop, double TotalMaxWaitingTime)
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        int index;
+        if (ParkedHelpers.size() != 0)
+        {
+            index = ParkedHelpers.back();
+            ParkedHelpers.pop_back();
+        }
+        else if (Helpers.size() < MaxHelpersCount)
+        {
+            index = Helpers.size();
+            Helpers.push_back(std::unique_ptr<Helper>(new Helper()));
+            Helper& helper = *Helpers.back();
+            helper.Thread = std::thread([this, &helper] { RunHelper(helper); });
+        }
+        else
+        {
+            return -1;
+        }
+        Helper& helper = *Helpers[index];
+        lock.unlock();
+
+        std::unique_lock<std::mutex> helper_lock(helper.Mutex);
+        helper.MaxWaitingTimeAfterStop = MaxWaitingTimeAfterStop;
+        helper.TotalMaxWaitingTime = TotalMaxWaitingTime;
+        helper.ShouldStop = false;
+        helper.HasTask = true;
+        helper_lock.unlock();
+        helper.ConditionVariable.notify_all();
+        return index;
+    }
+
+    void IdlingHelperPool::Stop(int HelperIndex)
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        Helper& helper = *Helpers[HelperIndex];
+        lock.unlock();
+
+        std::unique_lock<std::mutex> helper_lock(helper.Mutex);
+        helper.ShouldStop = true;
+        helper.ConditionVariable.wait(helper_lock, [&helper] { return !helper.HasTask; });
+        helper_lock.unlock();
+
+        lock.lock();
+        ParkedHelpers.push_back(HelperIndex);
+    }
+
+    void IdlingHelperPool::SetMaxHelpersCount(int Count)
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        MaxHelpersCount = std::max(Count, 0);
+    }
+
+    int IdlingHelperPool::GetMaxHelpersCount()
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        return MaxHelpersCount;
+    }
+
+    int IdlingHelperPool::GetHelpersCount()
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        return Helpers.size();
+    }
+
+    int IdlingHelperPool::GetBusyHelpersCount()
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        return Helpers.size() - ParkedHelpers.size();
+    }
+
+    void IdlingHelperPool::RunHelper(Helper& helper)
+    {
+        std::unique_lock<std::mutex> helper_lock(helper.Mutex);
+        while (true)
+        {
+            helper.ConditionVariable.wait(helper_lock, [&helper] { return helper.HasTask || helper.ShouldExit; });
+            if (helper.ShouldExit)
+            {
+                helper.HasTask = false;
+                helper_lock.unlock();
+                helper.ConditionVariable.notify_all();
+                return;
+            }
+            helper_lock.unlock();
+            Idle(helper);
+            helper_lock.lock();
+            helper.HasTask = false;
+            helper.ConditionVariable.notify_all(); // For Stop
+        }
+    }
+
+    void IdlingHelperPool::Idle(Helper& helper)
+    {
+        double MaxWaitingTimeAfterStop = helper.MaxWaitingTimeAfterStop;
+        double TotalMaxWaitingTime = helper.TotalMaxWaitingTime;
+        if (TotalMaxWaitingTime == 0)
+        {
+            if (MaxWaitingTimeAfterStop <= MNIMAL_TIME)
+                return; // Prevent unnecessary waiting or potential freezing
+            while (!helper.ShouldStop)
+            {
+                auto architecture = LoopPtr->GetArchitecture();
+                if (!architecture->RunNext(MaxWaitingTimeAfterStop))
+                    architecture->WaitForAvailability(MaxWaitingTimeAfterStop, MaxWaitingTimeAfterStop * 0.25);
+            }
+        }
+        else
+        {
+            auto start = std::chrono::steady_clock::now();
+            double remaining_time = TotalMaxWaitingTime;
+            while (remaining_time > 0 && !helper.ShouldStop)
+            {
+                double time = std::min(remaining_time, MaxWaitingTimeAfterStop);
+                if (time <= MNIMAL_TIME)
+                    return; // Prevent unnecessary waiting or potential freezing
+                auto architecture = LoopPtr->GetArchitecture();
+                if (!architecture->RunNext(time))
+                    architecture->WaitForAvailability(time, time * 0.25);
+                remaining_time = TotalMaxWaitingTime - (
+                        (std::chrono::duration<double>)(std::chrono::steady_clock::now() - start)
+                    ).count();
+            }
+        }
+    }
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace LoopScheduler
+{
+    /// @brief A loop-owned pool of parked helper threads, used by Module::StartIdling
+    ///        to run the loop's architecture while a module is idling.
+    ///
+    /// The helper threads are created on demand up to the max helpers count and parked when they're not used,
+    /// so starting to idle hands the work to a parked thread instead of creating a new thread.
+    /// Each helper's state is allocated once with the helper and reused.
+    /// Thread-safe.
+    class IdlingHelperPool final
+    {
+    public:
+        IdlingHelperPool(Loop * LoopPtr);
+        /// @brief Stops the helpers and waits for them to exit.
+        ///        The idling tokens using this pool should be stopped before.
+        ~IdlingHelperPool();
+        IdlingHelperPool(const IdlingHelperPool&) = delete;
+        IdlingHelperPool& operator=(const IdlingHelperPool&) = delete;
+
+        /// @brief Hands the idling to a parked helper, or to a new one if none is parked.
+        /// @return The helper's index to be passed to Stop, or -1 if the max helpers count is reached.
+        int Start(double MaxWaitingTimeAfterStop, double TotalMaxWaitingTime);
+        /// @brief Stops the idling, waits for the helper to finish it and parks the helper.
+        void Stop(int HelperIndex);
+
+        /// @brief Sets the maximum number of helper threads. Doesn't remove the existing helpers.
+        ///
+        /// The default is the number of logical CPU cores.
+        void SetMaxHelpersCount(int Count);
+        int GetMaxHelpersCount();
+        /// @brief Returns the number of helper threads, including the parked ones.
+        int GetHelpersCount();
+        /// @brief Returns the number of helpers that are used by idling tokens.
+        int GetBusyHelpersCount();
+    private:
+        class Helper
+        {
+        public:
+            std::thread Thread;
+            std::mutex Mutex;
+            std::condition_variable ConditionVariable;
+            /// @brief Set by Start, and reset by the helper when the idling is finished.
+            bool HasTask = false;
+            bool ShouldExit = false;
+            /// @brief Checked by the helper without locking while it's idling.
+            std::atomic<bool> ShouldStop = false;
+            double MaxWaitingTimeAfterStop = 0;
+            double TotalMaxWaitingTime = 0;
+        };
+
+        void RunHelper(Helper&);
+        void Idle(Helper&);
+
+        Loop * LoopPtr;
+        std::mutex Mutex;
+        /// @brief The helpers are never removed before destruction, the indexes remain valid.
+        std::vector<std::unique_ptr<Helper>> Helpers;
+        std::vector<int> ParkedHelpers;
+        int MaxHelpersCount;
+    };
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "IndexSet.h"
+
+#include <bit>
+
+namespace LoopScheduler
+{
+    IndexSet::IndexSet(int Size) : Words((Size + 63) / 64, 0), Size(Size), Count(0) {}
+
+    void IndexSet::Resize(int Size)
+    {
+        Words.assign((Size + 63) / 64, 0);
+        this->Size = Size;
+        Count = 0;
+    }
+
+    int IndexSet::GetSize() const
+    {
+        return Size;
+    }
+
+    int IndexSet::GetCount() const
+    {
+        return Count;
+    }
+
+    bool IndexSet::IsEmpty() const
+    {
+        return Count == 0;
+    }
+
+    bool IndexSet::Contains(int Index) const
+    {
+        return (Words[Index >> 6] >> (Index & 63)) & 1;
+    }
+
+    void IndexSet::Add(int Index)
+    {
+        std::uint64_t bit = std::uint64_t(1) << (Index & 63);
+        auto& word = Words[Index >> 6];
+        if ((word & bit) == 0)
+        {
+            word |= bit;
+            Count++;
+        }
+    }
+
+    void IndexSet::Remove(int Index)
+    {
+        std::uint64_t bit = std::uint64_t(1) << (Index & 63);
+        auto& word = Words[Index >> 6];
+        if ((word & bit) != 0)
+        {
+            word &= ~bit;
+            Count--;
+        }
+    }
+
+    void IndexSet::Clear()
+    {
+        for (auto& word : Words)
+            word = 0;
+        Count = 0;
+    }
+
+    void IndexSet::Fill()
+    {
+        if (Size == 0)
+            return;
+        for (auto& word : Words)
+            word = ~std::uint64_t(0);
+        if ((Size & 63) != 0)
+            Words.back() = (std::uint64_t(1) << (Size & 63)) - 1;
+        Count = Size;
+    }
+
+    int IndexSet::FindNext(int Start) const
+    {
+        if (Start >= Size)
+            return -1;
+        int word_index = Start >> 6;
+        // Ignore the bits before Start
+        std::uint64_t word = Words[word_index] & (~std::uint64_t(0) << (Start & 63));
+        while (true)
+        {
+            if (word != 0)
+                return (word_index << 6) + std::countr_zero(word);
+            if (++word_index == (int)Words.size())
+                return -1;
+            word = Words[word_index];
+        }
+    }
+}
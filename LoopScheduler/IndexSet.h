@@ -0,0 +1,59 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace LoopScheduler
+{
+    /// @brief A set of indexes in range [0, size - 1], stored as a bitset.
+    ///
+    /// Only allocates memory when resized, assigning a set of the same size doesn't allocate.
+    /// Used by groups to keep their members' states in a cache-friendly way.
+    /// NOT thread-safe.
+    class IndexSet final
+    {
+    public:
+        IndexSet(int Size = 0);
+        /// @brief Changes the size and clears the set.
+        void Resize(int Size);
+        int GetSize() const;
+        /// @brief Returns the number of indexes in the set.
+        int GetCount() const;
+        bool IsEmpty() const;
+        bool Contains(int Index) const;
+        void Add(int Index);
+        void Remove(int Index);
+        /// @brief Removes all indexes.
+        void Clear();
+        /// @brief Adds all indexes in range [0, size - 1].
+        void Fill();
+        /// @brief Returns the smallest index in the set that is not less than Start, or -1 if there's none.
+        int FindNext(int Start) const;
+    private:
+        std::vector<std::uint64_t> Words;
+        int Size;
+        int Count;
+    };
+}
@@ -20,14 +20,23 @@
 
 #include "Loop.h"
 
+#include <algorithm>
+#include <chrono>
 #include <list>
 #include <map>
 #include <queue>
 #include <stdexcept>
 #include <thread>
+#include <utility>
 
+#include "CoroutineModule.h"
 #include "Group.h"
+#include "IdlingHelperPool.h"
 #include "Module.h"
+#include "ParallelForTask.h"
+#include "SmartCVWaiter.h"
+#include "Tracer.h"
+#include "WorkStealingQueue.h"
 
 namespace LoopScheduler
 {
@@ -40,7 +49,39 @@ namespace LoopScheduler
     boolean::boolean(bool value) : value(value) {}
     boolean::operator bool() { return value; }
 
-    Loop::Loop(std::shared_ptr<Group> Architecture) : Architecture(Architecture), _IsRunning(false), ShouldStop(false)
+    /// @brief Runs a reserved run from the thread's own queue or steals one from the other queues.
+    /// @return Whether something was run.
+    inline bool RunQueuedRun(
+            std::vector<std::unique_ptr<WorkStealingQueue>>& queues, int thread_index, std::atomic<int>& queued_runs_count)
+    {
+        Group::ReservedRun run;
+        if (queues[thread_index]->Pop(run))
+        {
+            queued_runs_count--;
+            run.Run();
+            return true;
+        }
+        for (int i = 1; i < queues.size(); i++)
+        {
+            if (queues[(thread_index + i) % queues.size()]->Steal(run))
+            {
+                queued_runs_count--;
+                run.Run();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    thread_local Loop::WorkerState * Loop::CurrentWorker = nullptr;
+    thread_local std::int64_t Loop::ScopeFrameIndex = -1;
+
+    Loop::Loop(std::shared_ptr<Group> Architecture, ExecutorType Executor)
+        : Architecture(Architecture), Executor(Executor), _IsRunning(false), ShouldStop(false),
+          TargetPeriod(0), CVWaiter(new SmartCVWaiter()), IdlingHelpers(new IdlingHelperPool(this)),
+          CurrentFrameIndex(-1), IsFrameStarted(false),
+          ThreadConfigurationFailuresCount(0), PinnedWorkersVersion(0),
+          SuspendedModulesCount(0), ParallelForTasksCount(0), ParkedWorkersCount(0), QueuedRunsCount(0)
     {
         if (!Architecture->SetLoop(this))
             throw std::logic_error(
@@ -56,6 +97,7 @@ namespace LoopScheduler
             guard.unlock();
             Stop();
         }
+        IdlingHelpers.reset(); // Stops the helpers before they lose the architecture
         Architecture->SetLoop(nullptr);
     }
 
@@ -70,42 +112,208 @@ namespace LoopScheduler
             guard.unlock();
             throw std::logic_error("Cannot start running the loop twice.");
         }
+        std::vector<ThreadConfiguration> configurations = ThreadConfigurations;
+        if (configurations.size() >= threads_count
+            && std::all_of(configurations.begin(), configurations.begin() + threads_count, [](const ThreadConfiguration& c) {
+                return c.ReservedGroups.size() != 0;
+            }))
+        {
+            guard.unlock();
+            throw std::logic_error("At least one of the loop's threads must not be reserved for groups.");
+        }
+        ThreadConfigurationFailuresCount = 0;
         _IsRunning = true;
         ShouldStop = false;
+        IsFrameStarted = false;
+        // An iteration that is already started (e.g. on the architecture's construction) is the first frame.
+        if (!Architecture->IsDone())
+            StartNextFrame();
+        PeriodEndTime = std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(TargetPeriod));
         guard.unlock();
 
-        auto loop = [this]
+        // Only used by WorkStealingExecutor, one queue per thread.
+        std::vector<std::unique_ptr<WorkStealingQueue>> queues;
+        if (Executor == WorkStealingExecutor)
+            for (int i = 0; i < threads_count; i++)
+                queues.push_back(std::make_unique<WorkStealingQueue>());
+
+        auto run_worker = [this, &queues, threads_count](int thread_index, bool is_constrained)
         {
+            // The constrained threads don't reserve or steal runs, the reserved runs may be ones they can't run.
+            bool use_queues = queues.size() != 0 && !is_constrained;
+            std::vector<Group::ReservedRun> reserved_runs;
+            if (use_queues)
+                reserved_runs.reserve(threads_count);
             std::unique_lock<std::mutex> guard(Mutex);
             guard.unlock();
+            // Waits in the architecture, counted to be woken up for the ParallelFor tasks and the queued runs.
+            auto park = [this, is_constrained, use_queues](bool IsWaitingForRun, double MaxWaitingTime) {
+                if (!is_constrained)
+                    ParkedWorkersCount++;
+                // The groups' waits check the queued runs after the worker is counted (see queue_reserved_runs).
+                CurrentWorker->IsParkedForQueuedRuns = use_queues;
+                if (IsWaitingForRun)
+                    Architecture->WaitForRunAvailability(0, MaxWaitingTime);
+                else
+                    Architecture->WaitForAvailability(0, MaxWaitingTime);
+                CurrentWorker->IsParkedForQueuedRuns = false;
+                if (!is_constrained)
+                    ParkedWorkersCount--;
+            };
             while (true)
             {
+                if (SuspendedModulesCount.load() != 0 && ResumeSuspendedModule())
+                    continue;
+                if (ParallelForTasksCount.load() != 0 && RunParallelForTask())
+                    continue;
+
                 if (Architecture->IsDone())
                 {
                     guard.lock();
                     if (Architecture->IsDone())
                     {
                         if (ShouldStop)
+                        {
+                            guard.unlock();
+                            // Reserved runs have to run before stopping.
+                            if (use_queues && RunQueuedRun(queues, thread_index, QueuedRunsCount))
+                                continue;
+                            // The iterations that overlap the next ones (e.g. pipelined) have to finish before stopping.
+                            if (!Architecture->IsFinished())
+                            {
+                                if (!Architecture->RunNext())
+                                    park(true, GetSuspendedModulesPollingPeriod());
+                                continue;
+                            }
+                            // Suspended runs have to finish before stopping,
+                            // they may be waiting for what's left in the architecture.
+                            if (double time = GetSuspendedModulesPollingPeriod(); time != 0)
+                            {
+                                if (!Architecture->RunNext())
+                                    park(false, time);
+                                continue;
+                            }
                             return;
+                        }
+                        if (TargetPeriod != 0)
+                        {
+                            auto now = std::chrono::steady_clock::now();
+                            if (now < PeriodEndTime)
+                            {
+                                std::chrono::duration<double> remaining_time = PeriodEndTime - now;
+                                guard.unlock();
+                                // Run what's left in the architecture meanwhile.
+                                if (use_queues && RunQueuedRun(queues, thread_index, QueuedRunsCount))
+                                    continue;
+                                if (Architecture->RunNext(remaining_time.count()))
+                                    continue;
+                                guard.lock();
+                                now = std::chrono::steady_clock::now();
+                                if (!ShouldStop && now < PeriodEndTime)
+                                {
+                                    remaining_time = PeriodEndTime - now;
+                                    if (double time = GetSuspendedModulesPollingPeriod(); time != 0)
+                                        remaining_time = std::min(remaining_time, std::chrono::duration<double>(time));
+                                    LOOPSCHEDULER_TRACE_SCOPE("Loop::WaitForPeriodEnd", "wait", this);
+#if LOOPSCHEDULER_USE_SMART_CV_WAITER
+                                    // Returns immediately when the remaining time is shorter than the predicted error,
+                                    // yielding until the period's end instead is more precise.
+                                    if (!CVWaiter->WaitFor(ConditionVariable, guard, remaining_time, [this, is_constrained] {
+                                            return ShouldStop || (ParallelForTasksCount.load() != 0 && !is_constrained);
+                                        }))
+                                    {
+                                        guard.unlock();
+                                        std::this_thread::yield();
+                                        continue;
+                                    }
+#else
+                                    ConditionVariable.wait_for(guard, remaining_time, [this, is_constrained] {
+                                        return ShouldStop || (ParallelForTasksCount.load() != 0 && !is_constrained);
+                                    });
+#endif
+                                }
+                                guard.unlock();
+                                continue;
+                            }
+                            PeriodEndTime = std::max(
+                                PeriodEndTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                    std::chrono::duration<double>(TargetPeriod)
+                                ),
+                                now
+                            );
+                        }
+                        StartNextFrame();
                         Architecture->StartNextIteration();
                     }
                     guard.unlock();
                 }
 
+                if (use_queues)
+                {
+                    if (RunQueuedRun(queues, thread_index, QueuedRunsCount))
+                        continue;
+                    // Reserve enough runs for all threads with 1 access to the architecture.
+                    // The runs are queued before the architecture wakes up the waiting threads to steal them.
+                    auto queue_reserved_runs = [this, &queues, &reserved_runs, thread_index] {
+                        for (int i = 1; i < reserved_runs.size(); i++)
+                            queues[thread_index]->Push(std::move(reserved_runs[i]));
+                        QueuedRunsCount += (int)reserved_runs.size() - 1;
+                        // The reserving group only wakes up its own waiters, the parked workers may wait in other groups.
+                        // Either a worker sees the count after it's parked, or it's counted here and woken up.
+                        if (ParkedWorkersCount.load() != 0)
+                            Architecture->NotifyAvailabilityChange();
+                    };
+                    if (Architecture->ReserveNext(reserved_runs, threads_count, queue_reserved_runs) != 0)
+                    {
+                        auto run = std::move(reserved_runs[0]);
+                        reserved_runs.clear();
+                        run.Run();
+                        continue;
+                    }
+                }
+
                 if (!Architecture->RunNext())
-                    Architecture->WaitForAvailability();
+                    // Waits without a max time (0) if there is no suspended run.
+                    park(false, GetSuspendedModulesPollingPeriod());
+            }
+        };
+
+        auto loop = [this, &run_worker, &configurations, threads_count](int thread_index)
+        {
+            WorkerState state;
+            state.Index = thread_index;
+            state.ThreadsCount = threads_count;
+            state.LoopPtr = this;
+            ThreadConfiguration previous_configuration;
+            if (thread_index < configurations.size())
+            {
+                auto& configuration = configurations[thread_index];
+                for (auto& group : configuration.ReservedGroups)
+                    state.ReservedGroups.push_back(group.get());
+                if (thread_index == 0) // The calling thread
+                    previous_configuration = ThreadConfiguration::GetCurrentThreadConfiguration();
+                if (!configuration.ApplyToCurrentThread())
+                    ThreadConfigurationFailuresCount++;
             }
+            auto previous_worker = std::exchange(CurrentWorker, &state);
+            run_worker(thread_index, state.ReservedGroups.size() != 0);
+            CurrentWorker = previous_worker;
+            if (thread_index == 0 && thread_index < configurations.size())
+                previous_configuration.ApplyToCurrentThread(
+                    configurations[0].RealtimePriority > 0 || configurations[0].Nice != 0
+                );
         };
 
         std::vector<std::thread> threads;
         for (int i = 1; i < threads_count; i++)
         {
             threads.push_back(
-                std::thread(loop)
+                std::thread(loop, i)
             );
         }
 
-        loop();
+        loop(0);
 
         for (int i = 0; i < threads.size(); i++)
             threads[i].join();
@@ -120,7 +328,11 @@ namespace LoopScheduler
     {
         std::unique_lock<std::mutex> guard(Mutex);
         if (_IsRunning)
+        {
             ShouldStop = true;
+            guard.unlock();
+            ConditionVariable.notify_all(); // For the threads waiting for a period's end
+        }
     }
 
     void Loop::StopAndWait()
@@ -129,6 +341,7 @@ namespace LoopScheduler
         if (_IsRunning)
         {
             ShouldStop = true;
+            ConditionVariable.notify_all(); // For the threads waiting for a period's end, they wake up once this waits
             ConditionVariable.wait(guard, [this] { return !_IsRunning; });
         }
     }
@@ -148,4 +361,281 @@ namespace LoopScheduler
     {
         return std::weak_ptr<Group>(Architecture);
     }
+
+    void Loop::SetTargetPeriod(double Period)
+    {
+        std::unique_lock<std::mutex> guard(Mutex);
+        TargetPeriod = Period;
+    }
+
+    double Loop::GetTargetPeriod()
+    {
+        std::unique_lock<std::mutex> guard(Mutex);
+        return TargetPeriod;
+    }
+
+    IdlingHelperPool& Loop::GetIdlingHelperPool()
+    {
+        return *IdlingHelpers;
+    }
+
+    void Loop::SetThreadConfigurations(std::vector<ThreadConfiguration> Configurations)
+    {
+        for (auto& configuration : Configurations)
+            for (auto& group : configuration.ReservedGroups)
+                if (group == nullptr || group->GetLoop() != this)
+                    throw std::logic_error("A reserved group is not in the loop's architecture.");
+        std::unique_lock<std::mutex> guard(Mutex);
+        ThreadConfigurations = std::move(Configurations);
+    }
+
+    std::vector<ThreadConfiguration> Loop::GetThreadConfigurations()
+    {
+        std::unique_lock<std::mutex> guard(Mutex);
+        return ThreadConfigurations;
+    }
+
+    int Loop::GetThreadConfigurationFailuresCount()
+    {
+        return ThreadConfigurationFailuresCount.load();
+    }
+
+    int Loop::GetCurrentWorkerIndex()
+    {
+        return CurrentWorker == nullptr ? -1 : CurrentWorker->Index;
+    }
+
+    bool Loop::IsCurrentThreadConstrained()
+    {
+        if (CurrentWorker == nullptr)
+            return false;
+        if (CurrentWorker->ReservedGroups.size() != 0)
+            return true;
+        // Only updated when the pinned modules change.
+        Loop * loop = CurrentWorker->LoopPtr;
+        if (loop->PinnedWorkersVersion.load(std::memory_order_acquire) != CurrentWorker->PinnedWorkersVersion)
+        {
+            std::unique_lock<std::mutex> lock(loop->PinnedWorkersMutex);
+            CurrentWorker->PinnedWorkersVersion = loop->PinnedWorkersVersion.load(std::memory_order_relaxed);
+            CurrentWorker->HasModulePinnedToOtherWorker = false;
+            for (auto& [index, count] : loop->PinnedModulesCounts)
+                if (count != 0 && !IsCurrentWorker(index))
+                    CurrentWorker->HasModulePinnedToOtherWorker = true;
+        }
+        return CurrentWorker->HasModulePinnedToOtherWorker;
+    }
+
+    bool Loop::HasQueuedRunsForParkedWorker()
+    {
+        return CurrentWorker != nullptr && CurrentWorker->IsParkedForQueuedRuns
+            && CurrentWorker->LoopPtr->QueuedRunsCount.load() != 0;
+    }
+
+    void Loop::AddPinnedModule(int WorkerIndex, int Count)
+    {
+        if (WorkerIndex == -1)
+            return;
+        std::unique_lock<std::mutex> lock(PinnedWorkersMutex);
+        if ((PinnedModulesCounts[WorkerIndex] += Count) == 0)
+            PinnedModulesCounts.erase(WorkerIndex);
+        PinnedWorkersVersion++;
+    }
+
+    std::int64_t Loop::GetCurrentFrameIndex()
+    {
+        return CurrentFrameIndex.load(std::memory_order_acquire);
+    }
+
+    FrameContext Loop::GetFrame(std::int64_t Index)
+    {
+        if (Index < 0)
+            return FrameContext();
+        auto& slot = Frames[Index % FRAMES_HISTORY_SIZE];
+        while (true)
+        {
+            std::uint64_t sequence = slot.Sequence.load(std::memory_order_acquire);
+            if (sequence % 2 != 0)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            FrameContext result(
+                slot.Index.load(std::memory_order_relaxed),
+                std::chrono::steady_clock::time_point(
+                    std::chrono::steady_clock::duration(slot.StartTime.load(std::memory_order_relaxed))
+                ),
+                slot.DeltaTime.load(std::memory_order_relaxed),
+                slot.PredictedBudget.load(std::memory_order_relaxed)
+            );
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.Sequence.load(std::memory_order_relaxed) != sequence)
+                continue;
+            if (result.Index != Index)
+                return FrameContext();
+            return result;
+        }
+    }
+
+    std::int64_t Loop::GetFrameIndexForCurrentThread()
+    {
+        if (ScopeFrameIndex != -1)
+            return ScopeFrameIndex;
+        return CurrentFrameIndex.load(std::memory_order_acquire);
+    }
+
+    Loop::FrameScope::FrameScope(std::int64_t FrameIndex) : PreviousFrameIndex(std::exchange(ScopeFrameIndex, FrameIndex)) {}
+
+    Loop::FrameScope::~FrameScope()
+    {
+        ScopeFrameIndex = PreviousFrameIndex;
+    }
+
+    inline void Loop::StartNextFrame()
+    {
+        auto now = std::chrono::steady_clock::now();
+        double delta_time = 0;
+        if (IsFrameStarted)
+            delta_time = std::chrono::duration<double>(now - FrameStartTime).count();
+        IsFrameStarted = true;
+        FrameStartTime = now;
+        double predicted_budget = TargetPeriod != 0 ? TargetPeriod : Architecture->PredictHigherExecutionTime();
+
+        std::int64_t index = CurrentFrameIndex.load(std::memory_order_relaxed) + 1;
+        auto& slot = Frames[index % FRAMES_HISTORY_SIZE];
+        std::uint64_t sequence = slot.Sequence.load(std::memory_order_relaxed);
+        slot.Sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.Index.store(index, std::memory_order_relaxed);
+        slot.StartTime.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+        slot.DeltaTime.store(delta_time, std::memory_order_relaxed);
+        slot.PredictedBudget.store(predicted_budget, std::memory_order_relaxed);
+        slot.Sequence.store(sequence + 2, std::memory_order_release);
+        CurrentFrameIndex.store(index, std::memory_order_release);
+    }
+
+    bool Loop::IsCurrentWorker(int WorkerIndex)
+    {
+        return CurrentWorker != nullptr && WorkerIndex >= 0 && CurrentWorker->Index == WorkerIndex % CurrentWorker->ThreadsCount;
+    }
+
+    bool Loop::CanCurrentThreadRun(Module * M)
+    {
+        auto worker = CurrentWorker;
+        if (worker == nullptr || worker->ReservedGroups.size() == 0)
+            return true;
+        auto it = worker->ModulePermissions.find(M);
+        if (it != worker->ModulePermissions.end())
+            return it->second;
+        // Permitted if any of the module's ancestors is reserved
+        bool result = false;
+        for (Group * group = M->GetParent(); group != nullptr && !result; group = group->GetParent())
+            result = std::find(worker->ReservedGroups.begin(), worker->ReservedGroups.end(), group)
+                != worker->ReservedGroups.end();
+        worker->ModulePermissions[M] = result;
+        return result;
+    }
+
+    void Loop::AddSuspendedModule(CoroutineModule * SuspendedModule)
+    {
+        std::unique_lock<std::mutex> lock(SuspendedModulesMutex);
+        SuspendedModules.push_back(SuspendedModule);
+        SuspendedModulesCount.store(SuspendedModules.size());
+    }
+
+    bool Loop::ResumeSuspendedModule()
+    {
+        std::unique_lock<std::mutex> lock(SuspendedModulesMutex);
+        for (int i = 0; i < SuspendedModules.size(); i++)
+        {
+            if (SuspendedModules[i]->IsResumable() && SuspendedModules[i]->CanRunInCurrentThread())
+            {
+                auto m = SuspendedModules[i];
+                SuspendedModules.erase(SuspendedModules.begin() + i);
+                SuspendedModulesCount.store(SuspendedModules.size());
+                lock.unlock();
+                m->ResumeSuspendedRun();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    double Loop::GetSuspendedModulesPollingPeriod()
+    {
+        if (SuspendedModulesCount.load() == 0)
+            return 0;
+        std::unique_lock<std::mutex> lock(SuspendedModulesMutex);
+        double result = 0;
+        for (auto m : SuspendedModules)
+        {
+            double time = m->GetPollingPeriod();
+            if (result == 0 || time < result)
+                result = time;
+        }
+        return result;
+    }
+
+    void Loop::AddParallelForTask(ParallelForTask * Task)
+    {
+        {
+            std::unique_lock<std::mutex> lock(ParallelForTasksMutex);
+            ParallelForTasks.push_back(Task);
+            ParallelForTasksCount.store(ParallelForTasks.size());
+        }
+        // Only the workers waiting in the architecture need it, the others check the tasks before waiting.
+        if (ParkedWorkersCount.load() != 0)
+            Architecture->NotifyAvailabilityChange();
+        {
+            // For the threads waiting for a period's end, to not miss the notification between their check and wait
+            std::unique_lock<std::mutex> guard(Mutex);
+        }
+        ConditionVariable.notify_all();
+    }
+
+    void Loop::FinishParallelForTask(ParallelForTask * Task)
+    {
+        std::unique_lock<std::mutex> lock(ParallelForTasksMutex);
+        auto it = std::find(ParallelForTasks.begin(), ParallelForTasks.end(), Task);
+        if (it != ParallelForTasks.end())
+        {
+            ParallelForTasks.erase(it);
+            ParallelForTasksCount.store(ParallelForTasks.size());
+        }
+        ParallelForTasksConditionVariable.wait(lock, [Task] { return Task->HelpersCount == 0; });
+    }
+
+    bool Loop::RunParallelForTask()
+    {
+        std::unique_lock<std::mutex> lock(ParallelForTasksMutex);
+        auto task_it = std::find_if(ParallelForTasks.begin(), ParallelForTasks.end(), [](ParallelForTask * t) {
+            return CanCurrentThreadRun(t->Owner);
+        });
+        if (task_it == ParallelForTasks.end())
+            return false;
+        auto task = *task_it;
+        task->HelpersCount++;
+        lock.unlock();
+
+        bool has_run = false;
+        {
+            FrameScope frame_scope(task->FrameIndex);
+            while (task->RunChunk())
+                has_run = true;
+        }
+
+        lock.lock();
+        // No chunk is left, the task doesn't need more threads.
+        auto it = std::find(ParallelForTasks.begin(), ParallelForTasks.end(), task);
+        if (it != ParallelForTasks.end())
+        {
+            ParallelForTasks.erase(it);
+            ParallelForTasksCount.store(ParallelForTasks.size());
+        }
+        bool should_notify = --task->HelpersCount == 0;
+        lock.unlock();
+        // The task may be destructed after unlocking, the condition variable is the loop's.
+        if (should_notify)
+            ParallelForTasksConditionVariable.notify_all();
+        return has_run;
+    }
 }
@@ -22,18 +22,44 @@
 
 #include "LoopScheduler.dec.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
+#include "FrameContext.h"
+#include "ThreadConfiguration.h"
+
 namespace LoopScheduler
 {
     /// @brief Runs a multi-threaded loop using an architecture defined by Group objects.
     class Loop final
     {
+        friend Module;
+        friend CoroutineModule;
     public:
-        Loop(std::shared_ptr<Group> Architecture);
+        /// @brief The number of the latest frames that GetFrame can return.
+        static constexpr int FRAMES_HISTORY_SIZE = 16;
+
+        /// @brief The way that the loop threads get the next things to run.
+        enum ExecutorType
+        {
+            /// @brief Each thread runs the architecture's RunNext and waits for availability when nothing is run.
+            DefaultExecutor = 0,
+            /// @brief Each thread reserves batches of runs from the architecture using Group::ReserveNext
+            ///        into its own queue, and steals from the other threads' queues when it has nothing to run,
+            ///        instead of accessing the architecture.
+            ///        Falls back to RunNext when nothing can be reserved,
+            ///        behaves like DefaultExecutor if the architecture doesn't support reservations.
+            WorkStealingExecutor = 1,
+        };
+
+        Loop(std::shared_ptr<Group> Architecture, ExecutorType Executor = DefaultExecutor);
         ~Loop();
 
         /// @brief Thread-safe method to run the loop. An exception will be thrown if called more than once without a Stop() in between.
@@ -54,12 +80,207 @@ namespace LoopScheduler
         Group * GetArchitecture();
         /// @return A weak pointer to the architecture group to use later.
         std::weak_ptr<Group> GetArchitectureWeakPtr();
+        /// @brief Thread-safe method to set the target period of the iterations, to pace the loop.
+        ///
+        /// When an iteration is done before its period ends, the next iteration waits for the period's end.
+        /// Meanwhile, the threads run what's still available in the architecture (e.g., additional runs)
+        /// using RunNext with the remaining time as the MaxEstimatedExecutionTime, and wait when nothing is run.
+        /// When an iteration takes longer than its period, the next iteration starts immediately,
+        /// and the late iterations are not caught up.
+        ///
+        /// @param Period The target period in seconds. 0 (default) to start each iteration as soon as the previous one is done.
+        void SetTargetPeriod(double Period);
+        /// @brief Thread-safe method to get the target period of the iterations in seconds.
+        double GetTargetPeriod();
+        /// @brief Returns the pool of the helper threads used by Module::StartIdling,
+        ///        to bound or observe the number of the helper threads.
+        IdlingHelperPool& GetIdlingHelperPool();
+        /// @brief Thread-safe method to set the configurations of the loop's worker threads, applied on each Run.
+        ///
+        /// The configurations are indexed by the workers' indexes (see GetCurrentWorkerIndex),
+        /// the workers without a configuration keep their default settings.
+        /// The thread that calls Run gets its previous settings back when Run returns, as far as it's permitted.
+        /// At least one of the workers must not be reserved for groups, or Run throws std::logic_error.
+        ///
+        /// Throws std::logic_error if a reserved group is not in this loop's architecture.
+        void SetThreadConfigurations(std::vector<ThreadConfiguration> Configurations);
+        /// @brief Thread-safe method to get the configurations of the loop's worker threads.
+        std::vector<ThreadConfiguration> GetThreadConfigurations();
+        /// @brief Thread-safe method to get the number of the workers whose configurations
+        ///        couldn't be fully applied in the last Run, like when SCHED_FIFO is not permitted.
+        int GetThreadConfigurationFailuresCount();
+        /// @brief Returns the index of the loop worker running in the calling thread, or -1 if it's not a loop worker.
+        ///
+        /// The thread that calls Run is the worker 0, the other workers are numbered from 1.
+        static int GetCurrentWorkerIndex();
+        /// @brief Whether the calling thread is a loop worker that may not be able to run all the modules,
+        ///        like a worker reserved for groups, or a worker of a loop with a module pinned to another worker
+        ///        (see Module::HardAffinity).
+        static bool IsCurrentThreadConstrained();
+        /// @brief Whether the calling thread is a loop worker waiting in the architecture for something to run,
+        ///        while there are reserved runs queued for it to steal (see WorkStealingExecutor).
+        ///
+        /// The groups' waits return when this is true, the runs may be queued after the worker's last check
+        /// and announced to another group than the one it waits in.
+        static bool HasQueuedRunsForParkedWorker();
+
+        /// @brief Returns the index of the loop's current iteration (frame), the latest one started,
+        ///        or -1 before the first one.
+        ///
+        /// The indexes are not reset when the loop runs again.
+        /// Thread-safe, doesn't lock.
+        std::int64_t GetCurrentFrameIndex();
+        /// @brief Returns the context of a frame, or an empty one (Index = -1)
+        ///        if it's not one of the latest FRAMES_HISTORY_SIZE frames.
+        ///
+        /// Thread-safe, doesn't lock.
+        FrameContext GetFrame(std::int64_t Index);
+        /// @brief Returns the index of the frame that the calling thread's run belongs to (see FrameScope),
+        ///        the current frame's index if it's not set.
+        std::int64_t GetFrameIndexForCurrentThread();
+        /// @brief Sets the frame that the runs in the calling thread belong to, until destructed.
+        ///
+        /// Used by the groups whose iterations overlap, so the modules of an older iteration see its frame.
+        class FrameScope final
+        {
+        public:
+            /// @param FrameIndex -1 to use the loop's current frame.
+            FrameScope(std::int64_t FrameIndex);
+            FrameScope(const FrameScope&) = delete;
+            FrameScope& operator=(const FrameScope&) = delete;
+            ~FrameScope();
+        private:
+            std::int64_t PreviousFrameIndex;
+        };
     private:
         std::shared_ptr<Group> Architecture;
+        const ExecutorType Executor;
         std::mutex Mutex;
         std::condition_variable ConditionVariable;
         /// @brief Only set in Run()
         bool _IsRunning;
         bool ShouldStop;
+
+        double TargetPeriod;
+        /// @brief The time that the current iteration's period ends. Only used when TargetPeriod is not 0.
+        std::chrono::steady_clock::time_point PeriodEndTime;
+        /// @brief Used to wait for the periods' ends.
+        std::shared_ptr<SmartCVWaiter> CVWaiter;
+        std::unique_ptr<IdlingHelperPool> IdlingHelpers;
+
+        /// @brief A frame's context, written by 1 thread while Mutex is locked and read without locking.
+        ///
+        /// Sequence is odd while writing, the readers retry when it's odd or changes while reading.
+        class FrameSlot
+        {
+        public:
+            std::atomic<std::uint64_t> Sequence = 0;
+            std::atomic<std::int64_t> Index = -1;
+            std::atomic<std::chrono::steady_clock::rep> StartTime = 0;
+            std::atomic<double> DeltaTime = 0;
+            std::atomic<double> PredictedBudget = 0;
+        };
+        /// @brief The latest frames, indexed by their indexes modulo FRAMES_HISTORY_SIZE.
+        std::array<FrameSlot, FRAMES_HISTORY_SIZE> Frames;
+        std::atomic<std::int64_t> CurrentFrameIndex;
+        /// @brief Whether a frame is started in the current Run. Guarded by Mutex.
+        bool IsFrameStarted;
+        /// @brief The current frame's start time. Guarded by Mutex.
+        std::chrono::steady_clock::time_point FrameStartTime;
+        /// @brief The frame set by FrameScope, -1 if none.
+        static thread_local std::int64_t ScopeFrameIndex;
+
+        /// @brief Publishes the next frame's context, called right before the architecture's next iteration.
+        ///
+        /// NO MUTEX LOCK
+        inline void StartNextFrame();
+
+        std::vector<ThreadConfiguration> ThreadConfigurations;
+        std::atomic<int> ThreadConfigurationFailuresCount;
+
+        /// @brief The state of a worker thread, only accessed in that thread.
+        class WorkerState
+        {
+        public:
+            int Index = -1;
+            int ThreadsCount = 1;
+            /// @brief Empty if the worker can run all the modules.
+            std::vector<Group*> ReservedGroups;
+            /// @brief Whether the worker can run each module, filled on the first check of the module.
+            std::unordered_map<Module*, bool> ModulePermissions;
+            Loop * LoopPtr = nullptr;
+            /// @brief The loop's PinnedWorkersVersion that HasModulePinnedToOtherWorker was updated at.
+            int PinnedWorkersVersion = -1;
+            bool HasModulePinnedToOtherWorker = false;
+            /// @brief Whether the worker takes the queued runs and is waiting in the architecture.
+            bool IsParkedForQueuedRuns = false;
+        };
+        /// @brief The state of the worker running in the thread, nullptr if it's not a loop worker.
+        static thread_local WorkerState * CurrentWorker;
+
+        /// @brief The numbers of the loop's modules with Module::HardAffinity pinned to each worker index,
+        ///        the indexes are not wrapped around the workers count. Guarded by PinnedWorkersMutex.
+        std::unordered_map<int, int> PinnedModulesCounts;
+        std::mutex PinnedWorkersMutex;
+        /// @brief Incremented with PinnedWorkersMutex locked when PinnedModulesCounts changes.
+        std::atomic<int> PinnedWorkersVersion;
+        /// @brief Used by Module. Counts a module pinned to the worker (-1 for none), or uncounts it if Count is -1.
+        void AddPinnedModule(int WorkerIndex, int Count = 1);
+
+        /// @brief Used by Module. Checks whether the calling thread's reservations permit running the module.
+        static bool CanCurrentThreadRun(Module*);
+        /// @brief Used by Module. Checks whether the calling thread is the worker,
+        ///        wrapping the index around the workers count.
+        static bool IsCurrentWorker(int WorkerIndex);
+
+        /// @brief The modules with suspended runs, resumed by the loop's threads when they're ready.
+        std::vector<CoroutineModule*> SuspendedModules;
+        std::mutex SuspendedModulesMutex;
+        /// @brief The size of SuspendedModules, read without locking.
+        std::atomic<int> SuspendedModulesCount;
+
+        /// @brief Used by CoroutineModule to add a module with a suspended run.
+        ///
+        /// LOCKS MUTEX
+        void AddSuspendedModule(CoroutineModule*);
+        /// @brief Resumes a suspended module run that's ready.
+        /// @return Whether a run was resumed.
+        ///
+        /// LOCKS MUTEX
+        bool ResumeSuspendedModule();
+        /// @brief Returns the time in seconds to check the suspended modules again, 0 if there is none.
+        ///
+        /// LOCKS MUTEX
+        double GetSuspendedModulesPollingPeriod();
+
+        /// @brief The tasks of the running Module::ParallelFor calls that may have chunks left,
+        ///        run by the loop's threads before the architecture.
+        std::vector<ParallelForTask*> ParallelForTasks;
+        std::mutex ParallelForTasksMutex;
+        /// @brief Notified when a thread stops running a task's chunks.
+        std::condition_variable ParallelForTasksConditionVariable;
+        /// @brief The size of ParallelForTasks, read without locking.
+        std::atomic<int> ParallelForTasksCount;
+        /// @brief The number of the unconstrained workers waiting in the architecture,
+        ///        the architecture is only notified of a ParallelFor task when there is one.
+        std::atomic<int> ParkedWorkersCount;
+        /// @brief The number of the reserved runs in the workers' queues, only used by WorkStealingExecutor.
+        std::atomic<int> QueuedRunsCount;
+
+        /// @brief Used by Module::ParallelFor to make the task's chunks available to the loop's threads.
+        ///        Wakes up the loop's waiting workers.
+        ///
+        /// LOCKS MUTEX
+        void AddParallelForTask(ParallelForTask*);
+        /// @brief Used by Module::ParallelFor after running the chunks,
+        ///        removes the task and waits for the other threads to finish its chunks.
+        ///
+        /// LOCKS MUTEX
+        void FinishParallelForTask(ParallelForTask*);
+        /// @brief Runs the chunks of a ParallelFor task that the calling thread can run.
+        /// @return Whether a chunk was run.
+        ///
+        /// LOCKS MUTEX
+        bool RunParallelForTask();
     };
 }
@@ -27,18 +27,45 @@
     #define LOOPSCHEDULER_USE_SMART_CV_WAITER 1
 #endif
 
+#ifndef LOOPSCHEDULER_ENABLE_TRACING
+    #define LOOPSCHEDULER_ENABLE_TRACING 0
+#endif
+
 namespace LoopScheduler
 {
     /// @brief Used to indicate the smallest duration.
     constexpr double MNIMAL_TIME = 0.000001;
     class Loop;
+    struct FrameContext;
+    template <typename T, int BuffersCount> class FrameBuffer;
     class Group;
     class ModuleHoldingGroup;
     class SequentialGroup;
     class ParallelGroup;
+    class DependencyGroup;
+    class PriorityGroup;
+    class FixedTimestepGroup;
     class ParallelGroupMember;
+    class PriorityGroupMember;
+    class RunPeriod;
     class Module;
+    class CoroutineModule;
+    class IdlingHelperPool;
+    class ParallelForTask;
+    class ChannelBase;
+    template <typename T> class SPSCChannel;
+    template <typename T> class MPMCChannel;
+    class ThreadConfiguration;
     class TimeSpanPredictor;
     class BiasedEMATimeSpanPredictor;
+    class QuantileTimeSpanPredictor;
     class SmartCVWaiter;
+    class ExecutionStatistics;
+    class Tracer;
+    class SchedulingPolicy;
+    class LongestFirstSchedulingPolicy;
+    class IndexSet;
+    class RunPeriodTracker;
+    class TargetedNotifier;
+    class WorkStealingQueue;
 }
@@ -28,13 +28,40 @@
     #define LOOPSCHEDULER_USE_SMART_CV_WAITER 1
 #endif
 
+#ifndef LOOPSCHEDULER_ENABLE_TRACING
+    #define LOOPSCHEDULER_ENABLE_TRACING 0
+#endif
+
 #include "Loop.h"
+#include "FrameContext.h"
+#include "FrameBuffer.h"
 #include "Group.h"
 #include "ModuleHoldingGroup.h"
 #include "SequentialGroup.h"
 #include "ParallelGroup.h"
+#include "DependencyGroup.h"
+#include "PriorityGroup.h"
+#include "FixedTimestepGroup.h"
 #include "ParallelGroupMember.h"
+#include "PriorityGroupMember.h"
+#include "RunPeriod.h"
 #include "Module.h"
+#include "CoroutineModule.h"
+#include "IdlingHelperPool.h"
+#include "ParallelForTask.h"
+#include "ChannelBase.h"
+#include "SPSCChannel.h"
+#include "MPMCChannel.h"
+#include "ThreadConfiguration.h"
 #include "TimeSpanPredictor.h"
 #include "BiasedEMATimeSpanPredictor.h"
+#include "QuantileTimeSpanPredictor.h"
 #include "SmartCVWaiter.h"
+#include "ExecutionStatistics.h"
+#include "Tracer.h"
+#include "SchedulingPolicy.h"
+#include "LongestFirstSchedulingPolicy.h"
+#include "WorkStealingQueue.h"
+#include "IndexSet.h"
+#include "RunPeriodTracker.h"
+#include "TargetedNotifier.h"
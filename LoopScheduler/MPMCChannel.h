@@ -0,0 +1,182 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+#include "ChannelBase.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace LoopScheduler
+{
+    /// @brief A bounded lock-free channel with any number of producer and consumer threads,
+    ///        like modules that can run in parallel, or several modules handing data to one.
+    ///
+    /// Each item is claimed with a compare-exchange on its cell's sequence number (Vyukov's bounded queue),
+    /// and a batch publishes its count and notifies the consumers once.
+    /// Can be a module's input channel (see Module::AddInputChannel).
+    ///
+    /// @tparam T The type of the items, has to be default constructible and move assignable.
+    template <typename T>
+    class MPMCChannel final : public ChannelBase
+    {
+    public:
+        /// @param Capacity The maximum number of the items, rounded up to a power of 2. Throws std::logic_error if 0.
+        MPMCChannel(std::size_t Capacity) : EnqueuePosition(0), DequeuePosition(0)
+        {
+            if (Capacity == 0)
+                throw std::logic_error("The channel's capacity must be at least 1.");
+            std::size_t size = 1;
+            while (size < Capacity)
+                size *= 2;
+            Cells.reset(new Cell[size]);
+            for (std::size_t i = 0; i < size; i++)
+                Cells[i].Sequence.store(i, std::memory_order_relaxed);
+            Mask = size - 1;
+        }
+        /// @brief Thread-safe
+        std::size_t GetCapacity()
+        {
+            return Mask + 1;
+        }
+        /// @brief Thread-safe method to push an item.
+        /// @return Whether it was pushed, false if the channel is full.
+        bool TryPush(T Item)
+        {
+            if (!Enqueue(Item))
+                return false;
+            ReportPush(1);
+            return true;
+        }
+        /// @brief Thread-safe method to push the items in [First, Last) until the channel is full.
+        ///        The items of concurrent batches may interleave.
+        /// @return The number of the pushed items, from First.
+        template <typename InputIterator>
+        std::size_t PushBatch(InputIterator First, InputIterator Last)
+        {
+            std::size_t count = 0;
+            for (; First != Last; ++First, count++)
+            {
+                T item = *First;
+                if (!Enqueue(item))
+                    break;
+            }
+            if (count != 0)
+                ReportPush(count);
+            return count;
+        }
+        /// @brief Thread-safe method to pop an item.
+        /// @return Whether an item was popped, false if the channel is empty.
+        bool TryPop(T& Output)
+        {
+            if (!Dequeue(Output))
+                return false;
+            ReportPop(1);
+            return true;
+        }
+        /// @brief Thread-safe method to pop up to MaxCount items to Output.
+        /// @return The number of the popped items.
+        template <typename OutputIterator>
+        std::size_t PopBatch(OutputIterator Output, std::size_t MaxCount)
+        {
+            std::size_t count = 0;
+            T item;
+            for (; count < MaxCount && Dequeue(item); count++)
+                *Output++ = std::move(item);
+            if (count != 0)
+                ReportPop(count);
+            return count;
+        }
+    private:
+        class Cell
+        {
+        public:
+            /// @brief The position that the cell can be pushed at, or the position + 1 after it's pushed.
+            std::atomic<std::uint64_t> Sequence;
+            T Item;
+        };
+        std::unique_ptr<Cell[]> Cells;
+        std::size_t Mask;
+
+        alignas(64) std::atomic<std::uint64_t> EnqueuePosition;
+        alignas(64) std::atomic<std::uint64_t> DequeuePosition;
+
+        /// @brief Moves the item to the next cell if it's free, without publishing the count.
+        bool Enqueue(T& Item)
+        {
+            std::uint64_t position = EnqueuePosition.load(std::memory_order_relaxed);
+            while (true)
+            {
+                Cell& cell = Cells[position & Mask];
+                std::int64_t difference = (std::int64_t)cell.Sequence.load(std::memory_order_acquire) - (std::int64_t)position;
+                if (difference == 0)
+                {
+                    if (EnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        cell.Item = std::move(Item);
+                        cell.Sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0) // Not popped yet, full
+                {
+                    return false;
+                }
+                else // Claimed by another producer
+                {
+                    position = EnqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+        /// @brief Moves the next cell's item to Output if it's pushed, without publishing the count.
+        bool Dequeue(T& Output)
+        {
+            std::uint64_t position = DequeuePosition.load(std::memory_order_relaxed);
+            while (true)
+            {
+                Cell& cell = Cells[position & Mask];
+                std::int64_t difference
+                    = (std::int64_t)cell.Sequence.load(std::memory_order_acquire) - (std::int64_t)(position + 1);
+                if (difference == 0)
+                {
+                    if (DequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        Output = std::move(cell.Item);
+                        cell.Sequence.store(position + Mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0) // Not pushed yet, empty
+                {
+                    return false;
+                }
+                else // Claimed by another consumer
+                {
+                    position = DequeuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+    };
+}
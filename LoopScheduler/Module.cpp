@@ -22,12 +22,18 @@
 
 #include <algorithm>
 #include <chrono>
+#include <stdexcept>
 #include <utility>
 
 #include "BiasedEMATimeSpanPredictor.h"
+#include "ChannelBase.h"
+#include "ExecutionStatistics.h"
+#include "IdlingHelperPool.h"
 #include "Loop.h"
 #include "Group.h"
+#include "ParallelForTask.h"
 #include "SmartCVWaiter.h"
+#include "Tracer.h"
 
 namespace LoopScheduler
 {
@@ -42,7 +48,8 @@ namespace LoopScheduler
                 ) : (
                     (UseCustomCanRun ? CanRunPolicyType::CannotRunInParallelCustom : CanRunPolicyType::CannotRunInParallel)
             )),
-            Parent(nullptr), LoopPtr(nullptr), _IsAvailable(true)
+            Parent(nullptr), LoopPtr(nullptr), _IsAvailable(true), AvailabilityWaitersCount(0), Statistics(nullptr),
+            FinishedRunsCount(0), Affinity(NoAffinity), AffinityWorkerIndex(-1), LastWorkerIndex(-1)
     {
         if (HigherExecutionTimePredictor == nullptr)
             HigherExecutionTimePredictor = std::unique_ptr<BiasedEMATimeSpanPredictor>(
@@ -65,43 +72,86 @@ namespace LoopScheduler
 
         this->HigherExecutionTimePredictor = std::move(HigherExecutionTimePredictor);
         this->LowerExecutionTimePredictor = std::move(LowerExecutionTimePredictor);
+        HigherPrediction.store(this->HigherExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+        LowerPrediction.store(this->LowerExecutionTimePredictor->Predict(), std::memory_order_relaxed);
         this->CVWaiter = CVWaiter;
     }
 
+    Module::~Module()
+    {
+        SetAffinity(NoAffinity);
+        for (auto& channel : InputChannels)
+            channel->RemoveConsumer(this);
+    }
+
+    /// @brief Sets b to true and notifies c only if there are waiters.
+    ///
+    /// The waiters increment WaitersCount before checking b under m,
+    /// so either they see b as true or the waiters count is seen here.
+    inline void SetToTrueAndNotify(std::atomic<bool>& b, std::atomic<int>& WaitersCount, std::mutex& m, std::condition_variable& c)
+    {
+        b.store(true);
+        if (WaitersCount.load() != 0)
+        {
+            // Not to notify between a waiter's predicate check and its wait
+            std::unique_lock<std::mutex> lock(m);
+            lock.unlock();
+            c.notify_all();
+        }
+    }
+
     class SetToTrueGuard
     {
     private:
-        bool& b;
-        std::shared_mutex& m;
+        std::atomic<bool>& b;
+        std::atomic<int>& w;
+        std::mutex& m;
         std::condition_variable& c;
     public:
-        SetToTrueGuard(bool& b, std::shared_mutex& m, std::condition_variable& c) : b(b), m(m), c(c) {}
+        SetToTrueGuard(std::atomic<bool>& b, std::atomic<int>& w, std::mutex& m, std::condition_variable& c) : b(b), w(w), m(m), c(c) {}
         ~SetToTrueGuard()
         {
-            std::unique_lock<std::shared_mutex> lock(m);
-            b = true;
-            lock.unlock();
-            c.notify_all();
+            SetToTrueAndNotify(b, w, m, c);
         }
     };
 
+    Module::RunningToken::RunningToken() : Creator(nullptr), _CanRun(false) {}
     Module::RunningToken::RunningToken(Module * Creator) : Creator(Creator)
     {
-        switch (Creator->CanRunPolicy)
+        if (!Creator->CanRunInCurrentThread() || !Creator->HasInput())
         {
-            case CanRunPolicyType::CannotRunInParallel:
+            _CanRun = false;
+            return;
+        }
+        if (Creator->Affinity.load(std::memory_order_relaxed) == HardAffinity)
+        {
+            // The first worker that runs the module claims it.
+            int index = Creator->AffinityWorkerIndex.load();
+            if (index == -1)
             {
-                std::unique_lock<std::shared_mutex> lock(Creator->SharedMutex);
-                if (Creator->_IsAvailable)
+                // Locked not to be counted in the loop after SetAffinity or SetLoop has changed it.
+                std::shared_lock<std::shared_mutex> lock(Creator->SharedMutex);
+                if (Creator->Affinity.load() == HardAffinity
+                    && Creator->AffinityWorkerIndex.compare_exchange_strong(index, Loop::GetCurrentWorkerIndex()))
                 {
-                    Creator->_IsAvailable = false;
-                    _CanRun = true;
-                }
-                else
-                {
-                    _CanRun = false;
+                    index = Loop::GetCurrentWorkerIndex();
+                    if (Creator->LoopPtr != nullptr)
+                        Creator->LoopPtr->AddPinnedModule(index);
                 }
             }
+            if (!Loop::IsCurrentWorker(index))
+            {
+                _CanRun = false;
+                return;
+            }
+        }
+        switch (Creator->CanRunPolicy)
+        {
+            case CanRunPolicyType::CannotRunInParallel:
+            {
+                bool expected = true;
+                _CanRun = Creator->_IsAvailable.compare_exchange_strong(expected, false);
+            }
             break;
             case CanRunPolicyType::CanRunInParallel:
             {
@@ -130,19 +180,40 @@ namespace LoopScheduler
             }
             break;
         }
+        if (_CanRun && (
+                Creator->CanRunPolicy == CanRunPolicyType::CannotRunInParallel
+                || Creator->CanRunPolicy == CanRunPolicyType::CannotRunInParallelCustom)
+            && Creator->Statistics.load(std::memory_order_acquire) != nullptr)
+        {
+            AcquisitionTime = std::chrono::steady_clock::now();
+        }
+        if (_CanRun && Creator->Affinity.load(std::memory_order_relaxed) == SoftAffinity)
+        {
+            if (int index = Loop::GetCurrentWorkerIndex(); index != -1)
+                Creator->LastWorkerIndex.store(index, std::memory_order_relaxed);
+        }
     }
     Module::RunningToken::RunningToken(RunningToken&& op)
     {
         Creator = std::exchange(op.Creator, nullptr);
         _CanRun = std::exchange(op._CanRun, false);
+        AcquisitionTime = std::exchange(op.AcquisitionTime, std::chrono::steady_clock::time_point());
     }
     Module::RunningToken& Module::RunningToken::operator=(RunningToken&& op)
     {
+        if (this == &op)
+            return *this;
+        Release();
         Creator = std::exchange(op.Creator, nullptr);
         _CanRun = std::exchange(op._CanRun, false);
+        AcquisitionTime = std::exchange(op.AcquisitionTime, std::chrono::steady_clock::time_point());
         return *this;
     }
     Module::RunningToken::~RunningToken()
+    {
+        Release();
+    }
+    inline void Module::RunningToken::Release()
     {
         if (Creator == nullptr)
             return;
@@ -150,12 +221,21 @@ namespace LoopScheduler
                 Creator->CanRunPolicy == CanRunPolicyType::CannotRunInParallel
                 || Creator->CanRunPolicy == CanRunPolicyType::CannotRunInParallelCustom))
         {
-            std::unique_lock<std::shared_mutex> lock(Creator->SharedMutex);
-            Creator->_IsAvailable = true;
-            lock.unlock();
-            Creator->AvailabilityConditionVariable.notify_all();
+            ReportLockHolding();
+            SetToTrueAndNotify(
+                Creator->_IsAvailable, Creator->AvailabilityWaitersCount,
+                Creator->AvailabilityConditionMutex, Creator->AvailabilityConditionVariable
+            );
         }
     }
+    inline void Module::RunningToken::ReportLockHolding()
+    {
+        if (AcquisitionTime == std::chrono::steady_clock::time_point())
+            return;
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - AcquisitionTime;
+        Creator->Statistics.load(std::memory_order_acquire)->ReportLockHolding(duration.count());
+        AcquisitionTime = std::chrono::steady_clock::time_point();
+    }
     bool Module::RunningToken::CanRun()
     {
         if (Creator == nullptr)
@@ -171,10 +251,15 @@ namespace LoopScheduler
             _CanRun = false;
             // Guarantees to set _IsAvailable to true at the end
             // Doesn't matter if can run in parallel
-            SetToTrueGuard g(Creator->_IsAvailable, Creator->SharedMutex, Creator->AvailabilityConditionVariable);
+            SetToTrueGuard g(
+                Creator->_IsAvailable, Creator->AvailabilityWaitersCount,
+                Creator->AvailabilityConditionMutex, Creator->AvailabilityConditionVariable
+            );
             auto start = std::chrono::steady_clock::now();
             try
             {
+                LOOPSCHEDULER_TRACE_SCOPE("Module::Run", "run", Creator);
+                Loop::FrameScope frame_scope(Creator->GetFrameIndex());
                 Creator->OnRun();
             }
             catch (const std::exception& e)
@@ -194,13 +279,58 @@ namespace LoopScheduler
                 catch (...) {}
             }
             std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
-            double time = duration.count();
-            std::unique_lock<std::shared_mutex> lock(Creator->SharedMutex);
-            Creator->HigherExecutionTimePredictor->ReportObservation(time);
-            Creator->LowerExecutionTimePredictor->ReportObservation(time);
-            lock.unlock();
+            Creator->ReportRunTime(duration.count());
+            ReportLockHolding();
         }
     }
+    bool Module::RunningToken::Run(Group * Owner, int MemberIndex)
+    {
+        if (Creator == nullptr
+            || Creator->CanRunPolicy == CanRunPolicyType::CanRunInParallel
+            || Creator->CanRunPolicy == CanRunPolicyType::CanRunInParallelCustom)
+        {
+            Run();
+            return true;
+        }
+        if (!_CanRun)
+            return true;
+        _CanRun = false;
+        // Set before running, the run may be finished in another thread before OnSuspendableRun returns.
+        auto& run = Creator->SuspendableRun;
+        run.Owner = Owner;
+        run.MemberIndex = MemberIndex;
+        run.AcquisitionTime = std::exchange(AcquisitionTime, std::chrono::steady_clock::time_point());
+        run.StartTime = std::chrono::steady_clock::now();
+        bool is_finished = true;
+        try
+        {
+            LOOPSCHEDULER_TRACE_SCOPE("Module::Run", "run", Creator);
+            Loop::FrameScope frame_scope(Creator->GetFrameIndex());
+            is_finished = Creator->OnSuspendableRun();
+        }
+        catch (const std::exception& e)
+        {
+            try
+            {
+                Creator->HandleException(e);
+            }
+            catch (...) {}
+        }
+        catch (...)
+        {
+            try
+            {
+                Creator->HandleException(std::current_exception());
+            }
+            catch (...) {}
+        }
+        if (!is_finished)
+            return false;
+        // Finished without suspending, the group handles it when this returns.
+        run.Owner = nullptr;
+        Creator->FinishSuspendedRun();
+        return true;
+    }
 
     Module::RunningToken Module::GetRunningToken()
     {
@@ -209,8 +339,81 @@ namespace LoopScheduler
 
     bool Module::IsAvailable()
     {
-        std::shared_lock<std::shared_mutex> lock(SharedMutex);
-        return _IsAvailable;
+        return _IsAvailable.load() && HasInput() && CanRunInCurrentThread();
+    }
+
+    bool Module::CanRunInCurrentThread()
+    {
+        if (Affinity.load(std::memory_order_relaxed) == HardAffinity)
+        {
+            int index = AffinityWorkerIndex.load(std::memory_order_relaxed);
+            if (index != -1)
+                return Loop::IsCurrentWorker(index);
+            return Loop::GetCurrentWorkerIndex() != -1 && Loop::CanCurrentThreadRun(this);
+        }
+        return Loop::CanCurrentThreadRun(this);
+    }
+
+    void Module::SetAffinity(AffinityType Affinity, int WorkerIndex)
+    {
+        std::unique_lock<std::shared_mutex> lock(SharedMutex);
+        int previous_index = AffinityWorkerIndex.exchange(Affinity == HardAffinity ? WorkerIndex : -1);
+        LastWorkerIndex.store(Affinity == SoftAffinity ? WorkerIndex : -1);
+        this->Affinity.store(Affinity);
+        // The index is -1 when it's not HardAffinity.
+        if (LoopPtr != nullptr)
+        {
+            LoopPtr->AddPinnedModule(previous_index, -1);
+            LoopPtr->AddPinnedModule(AffinityWorkerIndex.load());
+        }
+    }
+
+    Module::AffinityType Module::GetAffinity()
+    {
+        return Affinity.load();
+    }
+
+    int Module::GetLastWorkerIndex()
+    {
+        return LastWorkerIndex.load(std::memory_order_relaxed);
+    }
+
+    bool Module::PrefersAnotherThread()
+    {
+        if (Affinity.load(std::memory_order_relaxed) != SoftAffinity)
+            return false;
+        int index = LastWorkerIndex.load(std::memory_order_relaxed);
+        return index != -1 && Loop::GetCurrentWorkerIndex() != -1 && !Loop::IsCurrentWorker(index);
+    }
+
+    void Module::AddInputChannel(std::shared_ptr<ChannelBase> Channel)
+    {
+        Channel->AddConsumer(this);
+        InputChannels.push_back(std::move(Channel));
+    }
+
+    inline bool Module::HasInput()
+    {
+        if (InputChannels.size() == 0)
+            return true;
+        for (auto& channel : InputChannels)
+            if (!channel->IsEmpty())
+                return true;
+        return false;
+    }
+
+    void Module::NotifyInputAvailability()
+    {
+        if (AvailabilityWaitersCount.load() != 0)
+        {
+            // Not to notify between a waiter's predicate check and its wait
+            std::unique_lock<std::mutex> lock(AvailabilityConditionMutex);
+            lock.unlock();
+            AvailabilityConditionVariable.notify_all();
+        }
+        // The waiters of the groups that contain the module check its availability too.
+        for (Group * group = GetParent(); group != nullptr; group = group->GetParent())
+            group->NotifyMemberInputAvailability();
     }
 
     void Module::WaitForAvailability(double MaxWaitingTime)
@@ -219,20 +422,36 @@ namespace LoopScheduler
         if (MaxWaitingTime != 0)
             start = std::chrono::steady_clock::now();
 
-        std::shared_lock<std::shared_mutex> lock(SharedMutex);
-        if (_IsAvailable)
+        if (_IsAvailable.load() && HasInput())
             return;
-        lock.unlock();
+
+        auto statistics = Statistics.load(std::memory_order_acquire);
+        std::chrono::time_point<std::chrono::steady_clock> waiting_start;
+        if (statistics != nullptr)
+            waiting_start = std::chrono::steady_clock::now();
 
         const auto predicate = [this] {
-            std::shared_lock<std::shared_mutex> lock(SharedMutex);
-            return _IsAvailable;
+            return _IsAvailable.load() && HasInput();
         };
 
+        class WaiterCountGuard
+        {
+        private:
+            std::atomic<int>& n;
+        public:
+            WaiterCountGuard(std::atomic<int>& n) : n(n) { n++; }
+            ~WaiterCountGuard() { n--; }
+        } waiter_count_guard(AvailabilityWaitersCount);
+
+        LOOPSCHEDULER_TRACE_SCOPE("Module::WaitForAvailability", "wait", this);
         std::unique_lock<std::mutex> cv_lock(AvailabilityConditionMutex);
         if (MaxWaitingTime == 0)
         {
+#if LOOPSCHEDULER_USE_SMART_CV_WAITER
+            CVWaiter->Wait(AvailabilityConditionVariable, cv_lock, predicate);
+#else
             AvailabilityConditionVariable.wait(cv_lock, predicate);
+#endif
         }
         else if (MaxWaitingTime > 0)
         {
@@ -244,18 +463,22 @@ namespace LoopScheduler
             AvailabilityConditionVariable.wait_for(cv_lock, time, predicate);
 #endif
         }
+
+        if (statistics != nullptr)
+        {
+            std::chrono::duration<double> duration = std::chrono::steady_clock::now() - waiting_start;
+            statistics->ReportWaiting(duration.count());
+        }
     }
 
     double Module::PredictHigherExecutionTime()
     {
-        std::shared_lock<std::shared_mutex> lock(SharedMutex);
-        return HigherExecutionTimePredictor->Predict();
+        return HigherPrediction.load(std::memory_order_relaxed);
     }
 
     double Module::PredictLowerExecutionTime()
     {
-        std::shared_lock<std::shared_mutex> lock(SharedMutex);
-        return LowerExecutionTimePredictor->Predict();
+        return LowerPrediction.load(std::memory_order_relaxed);
     }
 
     bool Module::SetParent(Group * Parent)
@@ -272,7 +495,13 @@ namespace LoopScheduler
         std::unique_lock<std::shared_mutex> lock(SharedMutex);
         if (this->LoopPtr != nullptr && LoopPtr != nullptr)
             return false;
+        // Moves the pinned worker's count to the new loop (see Loop::IsCurrentThreadConstrained).
+        int index = AffinityWorkerIndex.load();
+        if (this->LoopPtr != nullptr)
+            this->LoopPtr->AddPinnedModule(index, -1);
         this->LoopPtr = LoopPtr;
+        if (LoopPtr != nullptr)
+            LoopPtr->AddPinnedModule(index);
         return true;
     }
 
@@ -288,54 +517,105 @@ namespace LoopScheduler
         return LoopPtr;
     }
 
+    void Module::EnableStatistics()
+    {
+        std::unique_lock<std::shared_mutex> lock(SharedMutex);
+        if (StatisticsPtr != nullptr)
+            return;
+        StatisticsPtr = std::unique_ptr<ExecutionStatistics>(new ExecutionStatistics());
+        Statistics.store(StatisticsPtr.get(), std::memory_order_release);
+    }
+
+    ExecutionStatistics * Module::GetStatistics()
+    {
+        return Statistics.load(std::memory_order_acquire);
+    }
+
+    int Module::GetFinishedRunsCount()
+    {
+        return FinishedRunsCount.load(std::memory_order_acquire);
+    }
+
+    inline void Module::ReportRunTime(double Time)
+    {
+        std::unique_lock<std::shared_mutex> lock(SharedMutex);
+        HigherExecutionTimePredictor->ReportObservation(Time);
+        LowerExecutionTimePredictor->ReportObservation(Time);
+        HigherPrediction.store(HigherExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+        LowerPrediction.store(LowerExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+        lock.unlock();
+        if (auto statistics = Statistics.load(std::memory_order_acquire))
+            statistics->ReportRun(Time);
+        FinishedRunsCount.fetch_add(1, std::memory_order_release);
+    }
+
+    bool Module::OnSuspendableRun()
+    {
+        OnRun();
+        return true;
+    }
+
+    void Module::FinishSuspendedRun()
+    {
+        auto now = std::chrono::steady_clock::now();
+        // The suspended time is included, the run occupies its group meanwhile.
+        std::chrono::duration<double> duration = now - SuspendableRun.StartTime;
+        ReportRunTime(duration.count());
+        if (SuspendableRun.AcquisitionTime != std::chrono::steady_clock::time_point())
+        {
+            duration = now - SuspendableRun.AcquisitionTime;
+            Statistics.load(std::memory_order_acquire)->ReportLockHolding(duration.count());
+        }
+        auto owner = std::exchange(SuspendableRun.Owner, nullptr);
+        int member_index = SuspendableRun.MemberIndex;
+        SetToTrueAndNotify(_IsAvailable, AvailabilityWaitersCount, AvailabilityConditionMutex, AvailabilityConditionVariable);
+        if (owner != nullptr)
+            owner->FinishSuspendedRun(member_index);
+    }
+
     bool Module::CanRun() { return true; }
     void Module::HandleException(const std::exception& e) {}
     void Module::HandleException(std::exception_ptr e_ptr) {}
 
-    Module::IdlingToken::IdlingToken() : MutexPtr(new std::mutex), ShouldStopPtr(new bool(false)), ThreadPtr(nullptr)
+    Module::IdlingToken::IdlingToken() : Pool(nullptr), HelperIndex(-1)
     {
     }
     Module::IdlingToken::IdlingToken(IdlingToken&& op)
     {
-        MutexPtr = std::exchange(op.MutexPtr, nullptr);
-        ShouldStopPtr = std::exchange(op.ShouldStopPtr, nullptr);
-        ThreadPtr = std::exchange(op.ThreadPtr, nullptr);
+        Pool = std::exchange(op.Pool, nullptr);
+        HelperIndex = std::exchange(op.HelperIndex, -1);
     }
     Module::IdlingToken& Module::IdlingToken::operator=(IdlingToken&& op)
     {
-        MutexPtr = std::exchange(op.MutexPtr, nullptr);
-        ShouldStopPtr = std::exchange(op.ShouldStopPtr, nullptr);
-        ThreadPtr = std::exchange(op.ThreadPtr, nullptr);
+        if (this == &op)
+            return *this;
+        Stop();
+        Pool = std::exchange(op.Pool, nullptr);
+        HelperIndex = std::exchange(op.HelperIndex, -1);
         return *this;
     }
     Module::IdlingToken::~IdlingToken()
     {
-        if (MutexPtr == nullptr) // Has moved
-            return;
-        std::unique_lock<std::mutex> lock(*MutexPtr);
-        (*ShouldStopPtr) = true;
-        lock.unlock();
-        if (ThreadPtr->joinable())
-            ThreadPtr->join();
-        delete MutexPtr;
-        delete ShouldStopPtr;
-        delete ThreadPtr;
+        Stop();
     }
     void Module::IdlingToken::Stop()
     {
-        if (MutexPtr == nullptr) // Has moved
+        if (HelperIndex == -1) // Has moved, stopped or didn't idle
             return;
-        std::unique_lock<std::mutex> lock(*MutexPtr);
-        (*ShouldStopPtr) = true;
-        lock.unlock();
-        if (ThreadPtr->joinable())
-            ThreadPtr->join();
+        Pool->Stop(std::exchange(HelperIndex, -1));
+    }
+    bool Module::IdlingToken::IsIdling()
+    {
+        return HelperIndex != -1;
     }
 
     void Module::Idle(double MinWaitingTime)
     {
+        LOOPSCHEDULER_TRACE_SCOPE("Module::Idle", "idle", this);
         auto start = std::chrono::steady_clock::now();
         double remaining_time = MinWaitingTime;
+        // The runs meanwhile belong to the loop's current frame.
+        Loop::FrameScope frame_scope(-1);
         while (remaining_time > 0)
         {
             auto architecture = LoopPtr->GetArchitecture();
@@ -350,45 +630,38 @@ namespace LoopScheduler
     Module::IdlingToken Module::StartIdling(double MaxWaitingTimeAfterStop, double TotalMaxWaitingTime)
     {
         IdlingToken token;
-        auto MutexPtr = token.MutexPtr;
-        auto ShouldStopPtr = token.ShouldStopPtr;
-        token.ThreadPtr = new std::thread([this, MutexPtr, ShouldStopPtr, MaxWaitingTimeAfterStop, TotalMaxWaitingTime] {
-            if (TotalMaxWaitingTime == 0)
-            {
-                if (MaxWaitingTimeAfterStop <= MNIMAL_TIME)
-                    return; // Prevent unnecessary waiting or potential freezing
-                while (true)
-                {
-                    auto architecture = LoopPtr->GetArchitecture();
-                    if (!architecture->RunNext(MaxWaitingTimeAfterStop))
-                        architecture->WaitForAvailability(MaxWaitingTimeAfterStop, MaxWaitingTimeAfterStop * 0.25);
-                    std::unique_lock<std::mutex> lock(*MutexPtr);
-                    if (*ShouldStopPtr)
-                        return;
-                }
-            }
-            else
-            {
-                auto start = std::chrono::steady_clock::now();
-                double remaining_time = TotalMaxWaitingTime;
-                while (remaining_time > 0)
-                {
-                    double time = std::min(remaining_time, MaxWaitingTimeAfterStop);
-                    if (time <= MNIMAL_TIME)
-                        return; // Prevent unnecessary waiting or potential freezing
-                    auto architecture = LoopPtr->GetArchitecture();
-                    if (!architecture->RunNext(time))
-                        architecture->WaitForAvailability(time, time * 0.25);
-                    std::unique_lock<std::mutex> lock(*MutexPtr);
-                    if (*ShouldStopPtr)
-                        return;
-                    lock.unlock();
-                    remaining_time = TotalMaxWaitingTime - (
-                            (std::chrono::duration<double>)(std::chrono::steady_clock::now() - start)
-                        ).count();
-                }
-            }
-        });
+        token.Pool = &LoopPtr->GetIdlingHelperPool();
+        token.HelperIndex = token.Pool->Start(MaxWaitingTimeAfterStop, TotalMaxWaitingTime);
         return token;
     }
+
+    void Module::ParallelFor(int Begin, int End, int GrainSize, const std::function<void(int, int)>& Function)
+    {
+        if (GrainSize < 1)
+            throw std::logic_error("The grain size must be at least 1.");
+        if (End <= Begin)
+            return;
+        if (LoopPtr == nullptr || End - Begin <= GrainSize)
+        {
+            Function(Begin, End);
+            return;
+        }
+        ParallelForTask task(this, Begin, End, GrainSize, Function, LoopPtr->GetFrameIndexForCurrentThread());
+        LoopPtr->AddParallelForTask(&task);
+        while (task.RunChunk());
+        LoopPtr->FinishParallelForTask(&task);
+        task.RethrowException();
+    }
+
+    FrameContext Module::GetFrame()
+    {
+        if (LoopPtr == nullptr)
+            return FrameContext();
+        return LoopPtr->GetFrame(LoopPtr->GetFrameIndexForCurrentThread());
+    }
+
+    inline std::int64_t Module::GetFrameIndex()
+    {
+        return LoopPtr == nullptr ? -1 : LoopPtr->GetFrameIndexForCurrentThread();
+    }
 }
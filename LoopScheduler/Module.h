@@ -22,12 +22,18 @@
 
 #include "LoopScheduler.dec.h"
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <exception>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
-#include <thread>
+#include <vector>
+
+#include "FrameContext.h"
 
 namespace LoopScheduler
 {
@@ -39,6 +45,7 @@ namespace LoopScheduler
     ///   MyModule::MyModule(...) : Module(...) { ... }
     class Module
     {
+        friend ChannelBase;
     public:
         /// @brief To change the default settings in the derived class.
         ///
@@ -59,13 +66,33 @@ namespace LoopScheduler
             bool UseCustomCanRun = false,
             std::shared_ptr<SmartCVWaiter> CVWaiter = nullptr
         );
-        virtual ~Module() = default;
+        virtual ~Module();
+
+        /// @brief The way that the module is bound to the loop's workers (see Loop::GetCurrentWorkerIndex).
+        enum AffinityType
+        {
+            /// @brief Any worker can run the module.
+            NoAffinity = 0,
+            /// @brief The worker that last started running the module is preferred, for its warm caches.
+            ///        The other workers only run the module when they have nothing else to run in the group.
+            ///
+            /// Supported by ParallelGroup (except the work-stealing reservations) and DependencyGroup,
+            /// PriorityGroup keeps running the members in its dispatching order.
+            SoftAffinity = 1,
+            /// @brief Only one worker can run the module, like the one that owns a graphics context.
+            ///        The module doesn't run outside the loop's workers, e.g. in the idling helpers.
+            ///
+            /// The worker runs the module even if it's reserved for groups that don't contain it.
+            HardAffinity = 2,
+        };
 
         /// @brief Not thread-safe, use in a single thread.
         class RunningToken final
         {
             friend Module;
         public:
+            /// @brief Creates an empty token that cannot run.
+            RunningToken();
             RunningToken(RunningToken&) = delete;
             RunningToken(RunningToken&&);
             RunningToken& operator=(RunningToken&) = delete;
@@ -82,11 +109,30 @@ namespace LoopScheduler
             ///
             /// Not thread-safe.
             void Run();
+            /// @brief Like Run(), but lets a module that supports it (like CoroutineModule) suspend the run
+            ///        and return before the run is finished, to free the thread.
+            ///
+            /// Only the modules that cannot run in parallel can suspend their runs.
+            ///
+            /// Not thread-safe.
+            ///
+            /// @param Owner The group running the module.
+            /// @param MemberIndex An index defined by the group, passed back to Owner->FinishSuspendedRun.
+            /// @return Whether the run is finished.
+            ///         If not, Owner->FinishSuspendedRun(MemberIndex) is called once the run is finished,
+            ///         possibly in another thread. Meanwhile, the run should be treated as running.
+            bool Run(Group * Owner, int MemberIndex);
         private:
             /// @param Creator Should not be nullptr.
             RunningToken(Module * Creator);
+            /// @brief Releases the reservation if not used.
+            inline void Release();
             Module * Creator;
             bool _CanRun;
+            /// @brief Only set when the module cannot run in parallel and the statistics are enabled.
+            std::chrono::steady_clock::time_point AcquisitionTime;
+            /// @brief Reports the time since acquisition if it's set.
+            inline void ReportLockHolding();
         };
         friend RunningToken;
 
@@ -94,20 +140,52 @@ namespace LoopScheduler
         ///        Gets a running token to check whether it's possible to run and then run,
         ///        while reserving that run until the token is destructed or used.
         RunningToken GetRunningToken();
-        /// @brief Checks whether it's permitted to run the module.
+        /// @brief Checks whether it's permitted to run the module in the calling thread.
         ///        May give false positive (return true when cannot run) if a custom CanRun code is used.
         bool IsAvailable();
+        /// @brief Checks whether the calling thread is permitted to run the module,
+        ///        false in the loop workers that are reserved for groups that don't contain the module
+        ///        (see ThreadConfiguration::ReservedGroups), or in the other threads than the one of a HardAffinity.
+        ///
+        /// Thread-safe
+        bool CanRunInCurrentThread();
+        /// @brief Thread-safe method to set the module's affinity to the loop's workers.
+        ///
+        /// @param WorkerIndex The index of the worker to run the module.
+        ///                    -1 (default) for the first worker that runs the module.
+        ///                    Wraps around when the loop has fewer workers.
+        void SetAffinity(AffinityType Affinity, int WorkerIndex = -1);
+        /// @brief Thread-safe
+        AffinityType GetAffinity();
+        /// @brief Returns the index of the worker that last started running the module, -1 if it's unknown.
+        ///
+        /// Thread-safe
+        int GetLastWorkerIndex();
+        /// @brief Whether the module has a soft affinity to another worker than the calling thread.
+        ///
+        /// Used by the groups to prefer the other modules in this thread. Thread-safe
+        bool PrefersAnotherThread();
+        /// @brief Makes the module only runnable when one of its input channels is not empty,
+        ///        like a custom CanRun that checks the channels, but without polling:
+        ///        a push to an empty input channel notifies the threads waiting for the module.
+        ///
+        /// The channel is popped by the module's runs, e.g. with PopBatch.
+        /// Like a custom CanRun returning false, the module's group can't be done on an iteration
+        /// until the module runs, e.g. a SequentialGroup waits for the input.
+        ///
+        /// Not thread-safe, call before the module runs in a loop.
+        void AddInputChannel(std::shared_ptr<ChannelBase> Channel);
         /// @brief Waits until it's permitted to run the module.
         ///        May give false positive (return when cannot run).
         /// @param MaxWaitingTime Maximum time to wait in seconds. No max time if 0 (default).
         void WaitForAvailability(double MaxWaitingTime = 0);
         /// @brief Returns the higher predicted timespan in seconds.
         ///
-        /// Thread-safe
+        /// Thread-safe, doesn't lock. Reads the prediction published after the last run.
         double PredictHigherExecutionTime();
         /// @brief Returns the lower predicted timespan in seconds.
         ///
-        /// Thread-safe
+        /// Thread-safe, doesn't lock. Reads the prediction published after the last run.
         double PredictLowerExecutionTime();
 
         /// @brief Should only be called by the Group that has this module as a member.
@@ -118,9 +196,34 @@ namespace LoopScheduler
         bool SetLoop(Loop * LoopPtr);
         Group * GetParent();
         Loop * GetLoop();
+
+        /// @brief Starts recording the execution statistics. Can't be disabled after being enabled.
+        ///
+        /// The lock holding time is the time the module is held by a running token, including the run.
+        ///
+        /// Thread-safe
+        void EnableStatistics();
+        /// @brief Returns the statistics, or nullptr if not enabled.
+        ///        The object is valid as long as the module is.
+        ///
+        /// Thread-safe
+        ExecutionStatistics * GetStatistics();
+        /// @brief Returns the number of the finished runs.
+        ///
+        /// Thread-safe
+        int GetFinishedRunsCount();
     protected:
         virtual void OnRun() = 0;
         virtual bool CanRun();
+        /// @brief Called instead of OnRun when the group supports suspended runs (see RunningToken::Run(Group*, int)).
+        ///        Only called for the modules that cannot run in parallel.
+        ///
+        /// The default implementation calls OnRun and returns true.
+        ///
+        /// @return Whether the run is finished. If not, FinishSuspendedRun has to be called once the run is finished.
+        virtual bool OnSuspendableRun();
+        /// @brief Finishes the run that OnSuspendableRun has suspended. Can be called in any thread.
+        void FinishSuspendedRun();
         /// @brief To handle an exception that is derived from std::exception
         virtual void HandleException(const std::exception& e);
         /// @brief To handle an unknown exception
@@ -138,12 +241,14 @@ namespace LoopScheduler
             /// @brief Stops idling. Only works once.
             ///        It's automatically done if the object is destructed.
             void Stop();
+            /// @brief Whether a helper was available to idle.
+            ///        Is false if the loop's idling helpers are all busy and the max helpers count is reached.
+            bool IsIdling();
         private:
             IdlingToken();
-            std::mutex * MutexPtr;
-            bool * ShouldStopPtr;
-            /// @brief Should not be nullptr by the time any member function is called.
-            std::thread * ThreadPtr;
+            IdlingHelperPool * Pool;
+            /// @brief -1 if no helper is used.
+            int HelperIndex;
         };
 
         /// @brief To yield for other modules to possibly run meanwhile.
@@ -152,6 +257,8 @@ namespace LoopScheduler
         void Idle(double MinWaitingTime);
         /// @brief To yield for other modules to possibly run meanwhile, in another thread.
         ///
+        /// The thread is a helper from the loop's IdlingHelperPool.
+        /// When all the helpers are busy and the max helpers count is reached, nothing is run (see IdlingToken::IsIdling).
         /// Do not call this a second time before stopping or destructing the first one's token.
         /// Do not call Idle after calling this, and before stopping or destructing the token.
         ///
@@ -160,6 +267,27 @@ namespace LoopScheduler
         ///                            If 0 (default), it will wait until the returned token's Stop() is called,
         ///                            or until the token is destructed.
         IdlingToken StartIdling(double MaxWaitingTimeAfterStop, double TotalMaxWaitingTime = 0);
+        /// @brief Splits a range of indexes into chunks that run in parallel by the loop's threads,
+        ///        the ones that are not running anything else.
+        ///
+        /// The calling thread runs the chunks too, and returns when all of them are done.
+        /// This run's measured time includes the whole call, so the module's predictions reflect the parallel execution.
+        /// The chunks must not wait for each other.
+        /// When the function throws, the remaining chunks are cancelled,
+        /// and the first exception is rethrown after the running chunks are done.
+        /// When the module is not in a loop, all the chunks run in the calling thread.
+        ///
+        /// @param Begin The first index.
+        /// @param End The index after the last one.
+        /// @param GrainSize The number of the indexes in a chunk, at least 1. Throws std::logic_error otherwise.
+        /// @param Function Called with the begin and the end of each chunk, like Function(ChunkBegin, ChunkEnd).
+        void ParallelFor(int Begin, int End, int GrainSize, const std::function<void(int, int)>& Function);
+        /// @brief Returns the context of the frame (loop iteration) that the run belongs to,
+        ///        an empty one (Index = -1) when the module is not in a loop or the loop hasn't started.
+        ///
+        /// The frame is the loop's current one when the run started, or an older one when the iterations overlap
+        /// (see SequentialGroup's PipelineDepth). Use it with FrameBuffer to exchange per-frame data without locking.
+        FrameContext GetFrame();
     private:
         enum CanRunPolicyType
         {
@@ -183,12 +311,64 @@ namespace LoopScheduler
 
         std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor;
         std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor;
+        /// @brief The predictors' predictions, published on each observation to be read without locking.
+        std::atomic<double> HigherPrediction;
+        std::atomic<double> LowerPrediction;
         std::shared_ptr<SmartCVWaiter> CVWaiter;
 
-        /// @brief Always true if CanRunInParallel
-        bool _IsAvailable;
+        /// @brief Always true if CanRunInParallel.
+        ///
+        /// Acquired with a compare-exchange when not using a custom CanRun,
+        /// otherwise only set to false while SharedMutex is locked.
+        std::atomic<bool> _IsAvailable;
+        /// @brief The number of threads in WaitForAvailability, to only notify when needed.
+        std::atomic<int> AvailabilityWaitersCount;
         std::mutex AvailabilityConditionMutex;
         /// @brief Notified when _IsAvailable is set to true.
         std::condition_variable AvailabilityConditionVariable;
+
+        std::unique_ptr<ExecutionStatistics> StatisticsPtr;
+        /// @brief Set once by EnableStatistics, read without locking.
+        std::atomic<ExecutionStatistics*> Statistics;
+
+        std::atomic<int> FinishedRunsCount;
+
+        std::atomic<AffinityType> Affinity;
+        /// @brief The worker of HardAffinity, -1 until the first worker that runs the module claims it.
+        std::atomic<int> AffinityWorkerIndex;
+        /// @brief The preferred worker of SoftAffinity.
+        std::atomic<int> LastWorkerIndex;
+
+        /// @brief The information of the suspendable run.
+        ///        There can only be 1 suspended run, as only the modules that cannot run in parallel can suspend.
+        class SuspendableRunInfo
+        {
+        public:
+            Group * Owner = nullptr;
+            int MemberIndex = -1;
+            std::chrono::steady_clock::time_point StartTime;
+            /// @brief Only set when the statistics are enabled.
+            std::chrono::steady_clock::time_point AcquisitionTime;
+        };
+        /// @brief Set before OnSuspendableRun is called, used to finish the run in any thread.
+        SuspendableRunInfo SuspendableRun;
+
+        /// @brief Only modified before running, read without locking.
+        std::vector<std::shared_ptr<ChannelBase>> InputChannels;
+        /// @brief Whether the module has no input channels or one of them is not empty.
+        inline bool HasInput();
+        /// @brief Used by ChannelBase when an input channel is not empty anymore,
+        ///        wakes up the threads waiting for the module.
+        ///
+        /// LOCKS MUTEX
+        void NotifyInputAvailability();
+
+        /// @brief Returns the frame that a run starting in the calling thread belongs to, -1 if not in a loop.
+        inline std::int64_t GetFrameIndex();
+
+        /// @brief Reports the run's time to the predictors and statistics.
+        ///
+        /// LOCKS MUTEX
+        inline void ReportRunTime(double Time);
     };
 }
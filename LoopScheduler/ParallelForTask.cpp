@@ -0,0 +1,69 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "ParallelForTask.h"
+
+#include <algorithm>
+
+#include "Tracer.h"
+
+namespace LoopScheduler
+{
+    ParallelForTask::ParallelForTask(
+            Module * Owner, int Begin, int End, int GrainSize, const std::function<void(int, int)>& Function,
+            std::int64_t FrameIndex
+        ) : Owner(Owner), NextIndex(Begin), End(End), GrainSize(GrainSize), Function(Function), FrameIndex(FrameIndex),
+            HelpersCount(0)
+    {}
+
+    bool ParallelForTask::RunChunk()
+    {
+        // Checked first to keep NextIndex from overflowing by the failed claims.
+        if (NextIndex.load(std::memory_order_relaxed) >= End)
+            return false;
+        int begin = NextIndex.fetch_add(GrainSize, std::memory_order_relaxed);
+        if (begin >= End)
+            return false;
+        LOOPSCHEDULER_TRACE_SCOPE("Module::ParallelFor", "run", Owner);
+        try
+        {
+            Function(begin, std::min(End - begin, GrainSize) + begin);
+        }
+        catch (...)
+        {
+            std::unique_lock<std::mutex> lock(ExceptionMutex);
+            if (Exception == nullptr)
+                Exception = std::current_exception();
+            NextIndex.store(End, std::memory_order_relaxed); // Cancels the remaining chunks
+        }
+        return true;
+    }
+
+    bool ParallelForTask::HasChunks()
+    {
+        return NextIndex.load(std::memory_order_relaxed) < End;
+    }
+
+    void ParallelForTask::RethrowException()
+    {
+        std::unique_lock<std::mutex> lock(ExceptionMutex);
+        if (Exception != nullptr)
+            std::rethrow_exception(Exception);
+    }
+}
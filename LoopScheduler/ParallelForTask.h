@@ -0,0 +1,72 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+
+namespace LoopScheduler
+{
+    /// @brief The shared state of a Module::ParallelFor call, splitting a range of indexes into chunks
+    ///        that the calling thread and the loop's threads claim and run.
+    ///
+    /// Lives in the calling thread's stack, the loop keeps it from being destructed while other threads run it.
+    class ParallelForTask final
+    {
+        friend Loop;
+    public:
+        /// @param Owner The module calling ParallelFor, used for tracing.
+        /// @param FrameIndex The frame of the calling run, set for the loop's threads running the chunks (see Loop::FrameScope).
+        ParallelForTask(
+            Module * Owner, int Begin, int End, int GrainSize, const std::function<void(int, int)>& Function,
+            std::int64_t FrameIndex = -1
+        );
+        ParallelForTask(const ParallelForTask&) = delete;
+        ParallelForTask& operator=(const ParallelForTask&) = delete;
+        /// @brief Claims and runs the next chunk.
+        /// @return Whether a chunk was run, false when there's no chunk left.
+        ///
+        /// Thread-safe
+        bool RunChunk();
+        /// @brief Thread-safe
+        bool HasChunks();
+        /// @brief Rethrows the first exception thrown by the function, if any.
+        ///        Call after all the chunks are done.
+        void RethrowException();
+    private:
+        Module * Owner;
+        std::atomic<int> NextIndex;
+        const int End;
+        const int GrainSize;
+        const std::function<void(int, int)>& Function;
+        const std::int64_t FrameIndex;
+
+        std::mutex ExceptionMutex;
+        std::exception_ptr Exception;
+
+        /// @brief The number of the loop's threads running the chunks. Guarded by the loop's ParallelForTasksMutex.
+        int HelpersCount;
+    };
+}
@@ -21,11 +21,16 @@
 #include "ParallelGroup.h"
 
 #include <algorithm>
+#include <numeric>
 #include <utility>
 
 #include "Module.h"
 #include "BiasedEMATimeSpanPredictor.h"
+#include "ExecutionStatistics.h"
+#include "Loop.h"
+#include "SchedulingPolicy.h"
 #include "SmartCVWaiter.h"
+#include "Tracer.h"
 
 namespace LoopScheduler
 {
@@ -34,10 +39,23 @@ namespace LoopScheduler
             bool ExtendIterationForAdditionalGroupRuns,
             std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor,
             std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor,
-            std::shared_ptr<SmartCVWaiter> CVWaiter
-        ) : Members(Members), ExtendIterationForAdditionalGroupRuns(ExtendIterationForAdditionalGroupRuns),
-            RunningThreadsCount(0), NotifyingCounter(0), RunNextCount(0), MeasuringTimespan(false)
+            std::shared_ptr<SmartCVWaiter> CVWaiter,
+            std::shared_ptr<SchedulingPolicy> Policy
+        ) : Members(Members), MainSet(Members.size()), SecondarySet(Members.size()),
+            SecondaryCreditSet(Members.size()), SecondaryCredits(Members.size(), 0), SecondaryCursor(0),
+            ExtendIterationForAdditionalGroupRuns(ExtendIterationForAdditionalGroupRuns),
+            RunningThreadsCount(0), BudgetPacking(false), NotifyingCounter(0), MeasuringTimespan(false), Policy(Policy),
+            RunInfos(Members.size()), RunningSet(Members.size())
     {
+        std::vector<RunPeriod> periods;
+        std::vector<double> predicted_times;
+        for (auto& member : Members)
+        {
+            periods.push_back(member.Period);
+            predicted_times.push_back(std::visit([](auto& m) { return m->PredictHigherExecutionTime(); }, member.Member));
+        }
+        RunPeriods = RunPeriodTracker(std::move(periods), predicted_times);
+
         std::vector<std::shared_ptr<Group>> member_groups;
         std::vector<std::shared_ptr<Module>> member_modules;
         for (auto& member : Members)
@@ -48,6 +66,21 @@ namespace LoopScheduler
 
         IntroduceMembers(std::move(member_groups), std::move(member_modules));
 
+        SharedModuleIndexes.resize(Members.size());
+        for (int i = 0; i < Members.size(); i++)
+        {
+            if (!std::holds_alternative<std::shared_ptr<Module>>(Members[i].Member))
+                continue;
+            auto& m = std::get<std::shared_ptr<Module>>(Members[i].Member);
+            std::vector<int> indexes;
+            for (int j = 0; j < Members.size(); j++)
+                if (std::holds_alternative<std::shared_ptr<Module>>(Members[j].Member)
+                    && std::get<std::shared_ptr<Module>>(Members[j].Member) == m)
+                    indexes.push_back(j);
+            if (indexes.size() > 1)
+                SharedModuleIndexes[i] = std::move(indexes);
+        }
+
         if (HigherExecutionTimePredictor == nullptr)
             HigherExecutionTimePredictor = std::unique_ptr<BiasedEMATimeSpanPredictor>(
                 new BiasedEMATimeSpanPredictor(
@@ -69,8 +102,17 @@ namespace LoopScheduler
 
         this->HigherExecutionTimePredictor = std::move(HigherExecutionTimePredictor);
         this->LowerExecutionTimePredictor = std::move(LowerExecutionTimePredictor);
+        HigherPrediction.store(this->HigherExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+        LowerPrediction.store(this->LowerExecutionTimePredictor->Predict(), std::memory_order_relaxed);
         this->CVWaiter = CVWaiter;
 
+        if (Policy != nullptr)
+        {
+            PriorityOrder.resize(Members.size());
+            std::iota(PriorityOrder.begin(), PriorityOrder.end(), 0);
+            Priorities.resize(Members.size());
+        }
+
         StartNextIterationForThisGroup();
         for (auto& member : Members)
             if (std::holds_alternative<std::shared_ptr<Group>>(member.Member))
@@ -86,12 +128,13 @@ namespace LoopScheduler
     private:
         int& num1;
         int& num2;
-        int& counter;
+        std::atomic<int>& counter;
         std::unique_lock<std::shared_mutex>& lock;
         std::mutex& counter_cv_mutex;
+        bool is_dismissed = false;
     public:
         DoubleIncrementGuardLockingAndCountingOnDecrement(
-            int& num1, int& num2, int& counter,
+            int& num1, int& num2, std::atomic<int>& counter,
             std::unique_lock<std::shared_mutex>& lock,
             std::mutex& counter_cv_mutex) : num1(num1), num2(num2),
                                             counter(counter),
@@ -101,8 +144,18 @@ namespace LoopScheduler
             num1++;
             num2++;
         }
+        /// @brief Keeps the numbers incremented, to be decremented later. The lock is still locked on destruction.
+        void Dismiss()
+        {
+            is_dismissed = true;
+        }
         ~DoubleIncrementGuardLockingAndCountingOnDecrement()
         {
+            if (is_dismissed)
+            {
+                lock.lock();
+                return;
+            }
             // Lock before MembersSharedMutex lock for modifications before notify_all()
             std::unique_lock<std::mutex> cv_lock(counter_cv_mutex);
             lock.lock();
@@ -116,72 +169,55 @@ namespace LoopScheduler
     bool ParallelGroup::RunNext(double MaxEstimatedExecutionTime)
     {
         std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
-        int this_run_next_count = ++RunNextCount;
+        StartMeasuringLockHolding();
 
         TimespanMeasurementStart();
 
-        for (std::list<int>::iterator i = MainQueue.begin(); i != MainQueue.end();)
-        {
-            auto& member = Members[*i];
+        if (BudgetPacking && MaxEstimatedExecutionTime != 0 && RunBestFits(lock, MaxEstimatedExecutionTime))
+            return true;
+
+        // The modules that prefer other threads (Module::SoftAffinity) only run on a second pass,
+        // when nothing else can run.
+        bool is_first_pass = true;
+        bool has_deferred = false;
+        auto should_defer = [&is_first_pass, &has_deferred](Module& m) {
+            if (is_first_pass && m.PrefersAnotherThread())
+            {
+                has_deferred = true;
+                return true;
+            }
+            return false;
+        };
+        // The indexes are not invalidated when the lock is unlocked to run a group,
+        // the sets may change meanwhile, but looking for the next index is still valid.
+        auto run_first = [this, &lock, MaxEstimatedExecutionTime, &should_defer](int i) {
+            auto& member = Members[i];
             if (std::holds_alternative<std::shared_ptr<Module>>(member.Member))
             {
                 auto& m = std::get<std::shared_ptr<Module>>(member.Member);
                 if (MaxEstimatedExecutionTime != 0 && m->PredictHigherExecutionTime() > MaxEstimatedExecutionTime)
-                {
-                    ++i;
-                    continue;
-                }
-                if (RunModule(m, lock, MainQueue, SecondaryQueue, i, member.RunSharesAfterFirstRun))
-                {
-                    // Done in RunModule before running:
-                    //MainQueue.erase(i);
-                    //if (member.CanRunMoreThanOncePerCycle)
-                        //SecondaryQueue.push_back(*i);
-                    return true;
-                }
-            }
-            else
-            {
-                auto& g = std::get<std::shared_ptr<Group>>(member.Member);
-                if (g->IsDone())
-                {
-                    for (int j = 0; j < member.RunSharesAfterFirstRun; j++)
-                        SecondaryQueue.push_back(*i);
-                    MainQueue.erase(i++);
-                    TimespanMeasurementStop();
-                    continue; // Incremented already
-                }
-                else if (g->IsRunAvailable(MaxEstimatedExecutionTime))
-                {
-                    if (RunGroup(g, lock, MaxEstimatedExecutionTime))
-                    {
-                        return true;
-                    }
-                    // The list might be changed by other RunNext calls.
-                    if (this_run_next_count != RunNextCount)
-                        return false;
-                }
+                    return false;
+                if (should_defer(*m))
+                    return false;
+                return RunModule(i, lock, true);
             }
-            ++i;
-        }
-        for (std::list<int>::iterator i = SecondaryQueue.begin(); i != SecondaryQueue.end();)
-        {
-            auto& member = Members[*i];
+            auto& g = std::get<std::shared_ptr<Group>>(member.Member);
+            if (g->IsDone())
+                MarkRunStart(i, true);
+            else if (g->IsRunAvailable(MaxEstimatedExecutionTime))
+                return RunGroup(i, lock, MaxEstimatedExecutionTime);
+            return false;
+        };
+        auto run_additional = [this, &lock, MaxEstimatedExecutionTime, &should_defer](int i) {
+            auto& member = Members[i];
             if (std::holds_alternative<std::shared_ptr<Module>>(member.Member))
             {
                 auto& m = std::get<std::shared_ptr<Module>>(member.Member);
                 if (MaxEstimatedExecutionTime != 0 && m->PredictHigherExecutionTime() > MaxEstimatedExecutionTime)
-                {
-                    ++i;
-                    continue;
-                }
-                if (RunModule(m, lock, SecondaryQueue, SecondaryQueue, i, 1))
-                {
-                    // Done in RunModule before running:
-                    //SecondaryQueue.erase(i);
-                    //SecondaryQueue.push_back(*i);
-                    return true;
-                }
+                    return false;
+                if (should_defer(*m))
+                    return false;
+                return RunModule(i, lock, false);
             }
             else
             {
@@ -192,108 +228,375 @@ namespace LoopScheduler
                         && g->PredictHigherExecutionTime() <= MaxEstimatedExecutionTime
                     )
                 {
-                    MainQueue.push_back(*i);
-                    int temp = *i;
-                    //SecondaryQueue.erase(i++);
-                    for (std::list<int>::iterator j = SecondaryQueue.begin(); j != SecondaryQueue.end();)
-                    {
-                        if (temp == *j)
-                            SecondaryQueue.erase(j++);
-                        else
-                            j++;
-                    }
+                    MainSet.Add(i);
+                    SecondarySet.Remove(i);
+                    SecondaryCreditSet.Remove(i);
+                    SecondaryCredits[i] = 0;
                     g->StartNextIteration();
-                    if (RunGroup(g, lock, MaxEstimatedExecutionTime))
-                    {
-                        return true;
-                    }
-                    // The list is modified.
-                    return false;
+                    return RunGroup(i, lock, MaxEstimatedExecutionTime);
                 }
                 else if (g->IsRunAvailable(MaxEstimatedExecutionTime))
                 {
-                    SecondaryQueue.push_back(*i);
-                    SecondaryQueue.erase(i++);
-                    if (RunGroup(g, lock, MaxEstimatedExecutionTime))
-                    {
-                        return true;
-                    }
-                    // The list might be changed by other RunNext calls.
-                    if (this_run_next_count != RunNextCount)
-                        return false;
-                    continue; // Incremented already
+                    MarkRunStart(i, false);
+                    return RunGroup(i, lock, MaxEstimatedExecutionTime);
                 }
             }
-            ++i;
+            return false;
+        };
+        bool has_run = false;
+        while (true)
+        {
+            if (ForEachMain(run_first))
+                return true;
+            if (ForEachCyclic(SecondaryCreditSet, SecondaryCursor, run_additional))
+                return true;
+            // The members without remaining shares in this round can run when the others can't.
+            has_run = ForEachCyclic(SecondarySet, SecondaryCursor, [this, &run_additional](int i) {
+                return !SecondaryCreditSet.Contains(i) && run_additional(i);
+            });
+            if (has_run || !has_deferred || !is_first_pass)
+                break;
+            is_first_pass = false;
         }
-        return false;
+        StopMeasuringLockHolding(); // When nothing is run
+        if (!has_run && MainSet.IsEmpty()) // IsDone()
+        {
+            lock.unlock();
+            return RunUnfinishedMemberGroup(MaxEstimatedExecutionTime);
+        }
+        return has_run;
     }
-    inline bool ParallelGroup::RunModule(std::shared_ptr<Module>& m,
-                                         std::unique_lock<std::shared_mutex>& lock,
-                                         std::list<int>& from_list,
-                                         std::list<int>& to_list,
-                                         std::list<int>::iterator& item_to_move,
-                                         int move_to_to_list_count)
+    inline bool ParallelGroup::RunModule(int Index, std::unique_lock<std::shared_mutex>& lock, bool IsFirstRun)
     {
+        auto& m = std::get<std::shared_ptr<Module>>(Members[Index].Member);
         auto token = m->GetRunningToken();
         if (token.CanRun())
         {
-            for (int j = 0; j < move_to_to_list_count; j++)
-                to_list.push_back(*item_to_move);
-            from_list.erase(item_to_move);
-            TimespanMeasurementStop();
-            auto& runinfo = ModulesRunCountsAndPredictedStopTimes[m];
+            MarkRunStart(Index, IsFirstRun);
+            auto& runinfo = RunInfos[Index];
+            RunningSet.Add(Index);
+            bool is_finished;
             {
                 DoubleIncrementGuardLockingAndCountingOnDecrement increment_guard(
-                    runinfo.RunCount.value, RunningThreadsCount, NotifyingCounter, lock,
+                    runinfo.RunCount, RunningThreadsCount, NotifyingCounter, lock,
                     NextEventConditionMutex
                 );
                 runinfo.StartTime = std::chrono::steady_clock::now();
                 runinfo.HigherPredictedTimeSpan = m->PredictHigherExecutionTime();
                 runinfo.LowerPredictedTimeSpan = m->PredictLowerExecutionTime();
+                StopMeasuringLockHolding();
                 lock.unlock();
-                token.Run();
+                is_finished = token.Run(this, Index);
+                if (!is_finished)
+                    increment_guard.Dismiss(); // Released by FinishSuspendedRun
             } // lock locked by DoubleIncrementGuardLockingAndCountingOnDecrement's destructor
-            // runinfo hasn't been erased as lock isn't unlocked after the decrement
-            // made by DoubleIncrementGuardLockingAndCountingOnDecrement's destructor.
-            // If this condition is true, this is the last synchronized access to runinfo,
-            // therefore, we can safely erase it.
-            if (runinfo.RunCount.value == 0)
-                ModulesRunCountsAndPredictedStopTimes.erase(m);
+            if (!is_finished)
+                return true;
+            if (runinfo.RunCount == 0)
+                RunningSet.Remove(Index);
+            int wake_ups_count = GetWakeUpsCountAfterModuleRun(Index);
             lock.unlock();
-            NextEventConditionVariable.notify_all();
+            TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
             lock.lock();
             return true;
         }
         return false;
     }
-    inline bool ParallelGroup::RunGroup(std::shared_ptr<Group>& g, std::unique_lock<std::shared_mutex>& lock, double MaxEstimatedExecutionTime)
+    inline bool ParallelGroup::RunGroup(int Index, std::unique_lock<std::shared_mutex>& lock, double MaxEstimatedExecutionTime)
     {
-        auto& runcounts = GroupsRunCounts[g];
+        auto& g = std::get<std::shared_ptr<Group>>(Members[Index].Member);
+        auto& runinfo = RunInfos[Index];
+        RunningSet.Add(Index);
         bool success;
         {
             DoubleIncrementGuardLockingAndCountingOnDecrement increment_guard(
-                runcounts.value, RunningThreadsCount, NotifyingCounter, lock,
+                runinfo.RunCount, RunningThreadsCount, NotifyingCounter, lock,
                 NextEventConditionMutex
             );
+            StopMeasuringLockHolding();
             lock.unlock();
+#if LOOPSCHEDULER_ENABLE_TRACING
+            Tracer::Scope trace_scope("ParallelGroup::RunGroup", "run", g.get());
+#endif
             success = g->RunNext(MaxEstimatedExecutionTime);
+#if LOOPSCHEDULER_ENABLE_TRACING
+            if (!success)
+                trace_scope.Discard();
+#endif
         } // lock locked by DoubleIncrementGuardLockingAndCountingOnDecrement's destructor
-        // runcounts hasn't been erased as lock isn't unlocked after the decrement
-        // made by DoubleIncrementGuardLockingAndCountingOnDecrement's destructor.
-        // If this condition is true, this is the last synchronized access to runcounts,
-        // therefore, we can safely erase it.
-        if (runcounts.value == 0)
-            GroupsRunCounts.erase(g);
+        if (runinfo.RunCount == 0)
+            RunningSet.Remove(Index);
+        // The number of the runs available in the group is unknown.
+        int wake_ups_count = Waiters.GetWakeUpsCount(TargetedNotifier::ALL, MainSet.IsEmpty(), RunningThreadsCount == 0);
         lock.unlock();
-        NextEventConditionVariable.notify_all();
+        TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
         lock.lock();
         return success;
     }
 
+    inline bool ParallelGroup::RunBestFits(std::unique_lock<std::shared_mutex>& lock, double MaxEstimatedExecutionTime)
+    {
+        auto start = std::chrono::steady_clock::now();
+        double remaining_time = MaxEstimatedExecutionTime;
+        bool has_run = false;
+        // The modules that are available but can't run now, are skipped to pack the next best fits instead.
+        std::vector<int> skipped_indexes;
+        while (remaining_time > 0)
+        {
+            bool is_first_run = true;
+            int i = FindBestFit(MainSet, remaining_time, skipped_indexes);
+            if (i == -1)
+            {
+                is_first_run = false;
+                i = FindBestFit(SecondaryCreditSet, remaining_time, skipped_indexes);
+            }
+            if (i == -1)
+                i = FindBestFit(SecondarySet, remaining_time, skipped_indexes);
+            if (i == -1)
+                break;
+            if (!RunModule(i, lock, is_first_run))
+            {
+                skipped_indexes.push_back(i);
+                continue;
+            }
+            has_run = true;
+            std::chrono::duration<double> passed_time = std::chrono::steady_clock::now() - start;
+            remaining_time = MaxEstimatedExecutionTime - passed_time.count();
+        }
+        return has_run;
+    }
+    inline int ParallelGroup::FindBestFit(IndexSet& Set, double MaxEstimatedExecutionTime, const std::vector<int>& SkippedIndexes)
+    {
+        int result = -1;
+        double result_time = -1;
+        for (int i = Set.FindNext(0); i != -1; i = Set.FindNext(i + 1))
+        {
+            if (!std::holds_alternative<std::shared_ptr<Module>>(Members[i].Member)
+                || std::find(SkippedIndexes.begin(), SkippedIndexes.end(), i) != SkippedIndexes.end())
+                continue;
+            auto& m = std::get<std::shared_ptr<Module>>(Members[i].Member);
+            double time = m->PredictHigherExecutionTime();
+            if (time <= MaxEstimatedExecutionTime && time > result_time && m->IsAvailable())
+            {
+                result = i;
+                result_time = time;
+            }
+        }
+        return result;
+    }
+
+    void ParallelGroup::SetBudgetPacking(bool Enabled)
+    {
+        std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        BudgetPacking = Enabled;
+    }
+    bool ParallelGroup::GetBudgetPacking()
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        return BudgetPacking;
+    }
+
+    int ParallelGroup::ReserveNext(std::vector<ReservedRun>& Output, int MaxCount, const std::function<void()>& OnReserved)
+    {
+        std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        StartMeasuringLockHolding();
+        int count = 0;
+
+        TimespanMeasurementStart();
+
+        ForEachMain([this, &Output, &count, MaxCount](int i) {
+            auto& member = Members[i];
+            if (std::holds_alternative<std::shared_ptr<Module>>(member.Member))
+            {
+                if (ReserveModule(i, true, Output))
+                    count++;
+            }
+            else if (std::get<std::shared_ptr<Group>>(member.Member)->IsDone())
+            {
+                MarkRunStart(i, true);
+            }
+            return count >= MaxCount;
+        });
+        // Additional runs are only reserved one at a time when there's no first run to reserve,
+        // to avoid holding the modules that have to run in the next iteration.
+        if (count == 0)
+        {
+            auto reserve_additional = [this, &Output](int i) {
+                return std::holds_alternative<std::shared_ptr<Module>>(Members[i].Member)
+                    && ReserveModule(i, false, Output);
+            };
+            if (ForEachCyclic(SecondaryCreditSet, SecondaryCursor, reserve_additional)
+                || ForEachCyclic(SecondarySet, SecondaryCursor, [this, &reserve_additional](int i) {
+                        return !SecondaryCreditSet.Contains(i) && reserve_additional(i);
+                    }))
+            {
+                count++;
+            }
+        }
+        StopMeasuringLockHolding();
+        lock.unlock();
+
+        if (count != 0)
+        {
+            // Other threads may be waiting to take the reserved runs from the executor,
+            // woken up after the runs are available to them.
+            if (OnReserved)
+                OnReserved();
+            std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+            lock.lock();
+            NotifyingCounter++;
+            int wake_ups_count = Waiters.GetWakeUpsCount(count, MainSet.IsEmpty(), RunningThreadsCount == 0);
+            lock.unlock();
+            cv_lock.unlock();
+            TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
+        }
+        return count;
+    }
+    inline bool ParallelGroup::ReserveModule(int Index, bool IsFirstRun, std::vector<ReservedRun>& Output)
+    {
+        auto& m = std::get<std::shared_ptr<Module>>(Members[Index].Member);
+        // The reserved runs can be stolen by any thread.
+        if (m->GetAffinity() == Module::HardAffinity)
+            return false;
+        auto token = m->GetRunningToken();
+        if (token.CanRun())
+        {
+            MarkRunStart(Index, IsFirstRun);
+            auto& runinfo = RunInfos[Index];
+            RunningSet.Add(Index);
+            runinfo.RunCount++;
+            RunningThreadsCount++;
+            // The time that the reserved run waits to be run is included in the predictions.
+            runinfo.StartTime = std::chrono::steady_clock::now();
+            runinfo.HigherPredictedTimeSpan = m->PredictHigherExecutionTime();
+            runinfo.LowerPredictedTimeSpan = m->PredictLowerExecutionTime();
+            Output.push_back(CreateReservedRun(Index, std::move(token)));
+            return true;
+        }
+        return false;
+    }
+
+    void ParallelGroup::RunReserved(int MemberIndex, Module::RunningToken& Token)
+    {
+        if (Token.Run(this, MemberIndex))
+            FinishReservedModuleRun(MemberIndex);
+    }
+    void ParallelGroup::CancelReserved(int MemberIndex)
+    {
+        FinishReservedModuleRun(MemberIndex);
+    }
+    void ParallelGroup::FinishSuspendedRun(int MemberIndex)
+    {
+        FinishReservedModuleRun(MemberIndex);
+    }
+    inline void ParallelGroup::FinishReservedModuleRun(int MemberIndex)
+    {
+        // Lock before MembersSharedMutex lock for modifications before notify_all()
+        std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+        std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        RunningThreadsCount--;
+        NotifyingCounter++;
+        if (--RunInfos[MemberIndex].RunCount == 0)
+            RunningSet.Remove(MemberIndex);
+        int wake_ups_count = GetWakeUpsCountAfterModuleRun(MemberIndex);
+        lock.unlock();
+        cv_lock.unlock();
+        TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
+    }
+    inline int ParallelGroup::GetWakeUpsCountAfterModuleRun(int Index)
+    {
+        // NO MUTEX LOCK
+        // Only the module itself may become available to run again, through any member that holds it.
+        int runs_count = 0;
+        if (SharedModuleIndexes[Index].size() == 0)
+            runs_count = (MainSet.Contains(Index) || SecondarySet.Contains(Index)) ? 1 : 0;
+        else
+            for (int i : SharedModuleIndexes[Index])
+                if (MainSet.Contains(i) || SecondarySet.Contains(i))
+                    runs_count++;
+        return Waiters.GetWakeUpsCount(runs_count, MainSet.IsEmpty(), RunningThreadsCount == 0);
+    }
+
+    inline void ParallelGroup::MarkRunStart(int Index, bool IsFirstRun)
+    {
+        // NO MUTEX LOCK
+        if (IsFirstRun)
+        {
+            MainSet.Remove(Index);
+            int shares = Members[Index].RunSharesAfterFirstRun;
+            if (shares > 0)
+            {
+                SecondarySet.Add(Index);
+                SecondaryCreditSet.Add(Index);
+                SecondaryCredits[Index] = shares;
+            }
+            TimespanMeasurementStop();
+        }
+        else
+        {
+            if (SecondaryCredits[Index] > 0 && --SecondaryCredits[Index] == 0)
+                SecondaryCreditSet.Remove(Index);
+            if (SecondaryCreditSet.IsEmpty()) // Start a new round
+            {
+                SecondaryCreditSet = SecondarySet; // Same size, no allocation
+                for (int i = SecondarySet.FindNext(0); i != -1; i = SecondarySet.FindNext(i + 1))
+                    SecondaryCredits[i] = Members[i].RunSharesAfterFirstRun;
+            }
+            SecondaryCursor = Index + 1;
+        }
+    }
+    template <typename FunctionType>
+    inline bool ParallelGroup::ForEachCyclic(IndexSet& Set, int Start, FunctionType Function)
+    {
+        // NO MUTEX LOCK
+        for (int i = Set.FindNext(Start); i != -1; i = Set.FindNext(i + 1))
+            if (Function(i))
+                return true;
+        for (int i = Set.FindNext(0); i != -1 && i < Start; i = Set.FindNext(i + 1))
+            if (Function(i))
+                return true;
+        return false;
+    }
+
+    template <typename FunctionType>
+    inline bool ParallelGroup::ForEachMain(FunctionType Function)
+    {
+        // NO MUTEX LOCK
+        if (Policy == nullptr)
+        {
+            for (int i = MainSet.FindNext(0); i != -1; i = MainSet.FindNext(i + 1))
+                if (Function(i))
+                    return true;
+        }
+        else
+        {
+            // PriorityOrder may be reordered while the lock is unlocked to run a group,
+            // but it's not resized and remains a valid order to continue.
+            for (int k = 0; k < PriorityOrder.size(); k++)
+                if (MainSet.Contains(PriorityOrder[k]) && Function(PriorityOrder[k]))
+                    return true;
+        }
+        return false;
+    }
+    inline void ParallelGroup::UpdatePriorityOrder()
+    {
+        // NO MUTEX LOCK
+        for (int i = 0; i < Members.size(); i++)
+        {
+            if (std::holds_alternative<std::shared_ptr<Module>>(Members[i].Member))
+                Priorities[i] = Policy->GetPriority(*std::get<std::shared_ptr<Module>>(Members[i].Member));
+            else
+                Priorities[i] = Policy->GetPriority(*std::get<std::shared_ptr<Group>>(Members[i].Member));
+        }
+        // Same priorities keep the members' order
+        std::sort(PriorityOrder.begin(), PriorityOrder.end(), [this](int a, int b) {
+            return Priorities[a] > Priorities[b] || (Priorities[a] == Priorities[b] && a < b);
+        });
+    }
+
     inline void ParallelGroup::TimespanMeasurementStart()
     {
-        if (SecondaryQueue.size() == 0 && !MeasuringTimespan)
+        if (SecondarySet.IsEmpty() && !MeasuringTimespan)
         {
             IterationStartTime = std::chrono::steady_clock::now();
             MeasuringTimespan = true;
@@ -301,12 +604,16 @@ namespace LoopScheduler
     }
     inline void ParallelGroup::TimespanMeasurementStop()
     {
-        if (MainQueue.size() == 0 && MeasuringTimespan)
+        if (MainSet.IsEmpty() && MeasuringTimespan)
         {
             std::chrono::duration<double> duration = std::chrono::steady_clock::now() - IterationStartTime;
             double time = duration.count();
             HigherExecutionTimePredictor->ReportObservation(time);
             LowerExecutionTimePredictor->ReportObservation(time);
+            HigherPrediction.store(HigherExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+            LowerPrediction.store(LowerExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+            if (auto statistics = GetStatistics())
+                statistics->ReportRun(time);
             MeasuringTimespan = false;
         }
     }
@@ -319,45 +626,29 @@ namespace LoopScheduler
     bool ParallelGroup::IsAvailable(double MaxEstimatedExecutionTime)
     {
         std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
-        if (MainQueue.size() == 0) // IsDone()
+        if (MainSet.IsEmpty()) // IsDone()
             return true;
         return IsRunAvailableNoLock(MaxEstimatedExecutionTime);
     }
     inline bool ParallelGroup::IsRunAvailableNoLock(double MaxEstimatedExecutionTime)
     {
-        for (auto i : MainQueue)
-        {
+        const auto is_available = [this, MaxEstimatedExecutionTime](int i) {
             if (std::holds_alternative<std::shared_ptr<Module>>(Members[i].Member))
             {
                 auto& m = std::get<std::shared_ptr<Module>>(Members[i].Member);
                 if (MaxEstimatedExecutionTime != 0 && m->PredictHigherExecutionTime() > MaxEstimatedExecutionTime)
-                    continue;
-                if (m->IsAvailable())
-                    return true;
-            }
-            else
-            {
-                if (std::get<std::shared_ptr<Group>>(Members[i].Member)->IsAvailable(MaxEstimatedExecutionTime))
-                    return true;
-            }
-        }
-        for (auto i : SecondaryQueue)
-        {
-            if (std::holds_alternative<std::shared_ptr<Module>>(Members[i].Member))
-            {
-                auto& m = std::get<std::shared_ptr<Module>>(Members[i].Member);
-                if (MaxEstimatedExecutionTime != 0 && m->PredictHigherExecutionTime() > MaxEstimatedExecutionTime)
-                    continue;
-                if (m->IsAvailable())
-                    return true;
-            }
-            else
-            {
-                if (std::get<std::shared_ptr<Group>>(Members[i].Member)->IsAvailable(MaxEstimatedExecutionTime))
-                    return true;
+                    return false;
+                return m->IsAvailable();
             }
-        }
-        return false;
+            return std::get<std::shared_ptr<Group>>(Members[i].Member)->IsAvailable(MaxEstimatedExecutionTime);
+        };
+        for (int i = MainSet.FindNext(0); i != -1; i = MainSet.FindNext(i + 1))
+            if (is_available(i))
+                return true;
+        for (int i = SecondarySet.FindNext(0); i != -1; i = SecondarySet.FindNext(i + 1))
+            if (is_available(i))
+                return true;
+        return MainSet.IsEmpty() && IsUnfinishedMemberGroupRunAvailable(MaxEstimatedExecutionTime);
     }
 
     void ParallelGroup::WaitForRunAvailability(double MaxEstimatedExecutionTime, double MaxWaitingTime)
@@ -378,18 +669,23 @@ namespace LoopScheduler
         std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
         int start_notifying_counter = NotifyingCounter;
 
-        if (RunningThreadsCount == 0)
-            return;
-
         if constexpr (RunAvailability)
         {
-            // IsDone() and nothing else to run.
-            if (MainQueue.size() == 0 && SecondaryQueue.size() == 0)
+            // IsDone() and nothing else to run, except in the unfinished member groups.
+            if (MainSet.IsEmpty() && SecondarySet.IsEmpty())
+            {
+                lock.unlock();
+                WaitForUnfinishedMemberGroup(MaxEstimatedExecutionTime, MaxWaitingTime);
                 return;
+            }
         }
-        else
+
+        if (RunningThreadsCount == 0)
+            return;
+
+        if constexpr (!RunAvailability)
         {
-            if (MainQueue.size() == 0) // IsDone()
+            if (MainSet.IsEmpty()) // IsDone()
                 return;
         }
         if (IsRunAvailableNoLock(MaxEstimatedExecutionTime))
@@ -398,15 +694,27 @@ namespace LoopScheduler
         lock.unlock();
 
         const auto predicate = [this, start_notifying_counter] {
-            // NextEventConditionMutex already locked before this MembersSharedMutex lock
-            std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
-            return start_notifying_counter != NotifyingCounter;
+            // Doesn't need MembersSharedMutex, NotifyingCounter is only modified with NextEventConditionMutex locked.
+            return start_notifying_counter != NotifyingCounter.load(std::memory_order_relaxed)
+                || Loop::HasQueuedRunsForParkedWorker();
         };
 
+        auto statistics = GetStatistics();
+        std::chrono::time_point<std::chrono::steady_clock> waiting_start;
+        if (statistics != nullptr)
+            waiting_start = std::chrono::steady_clock::now();
+
+        LOOPSCHEDULER_TRACE_SCOPE("ParallelGroup::Wait", "wait", this);
         std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+        TargetedNotifier::WaitingGuard waiting_guard(
+                Waiters, MaxEstimatedExecutionTime != 0 || Loop::IsCurrentThreadConstrained(), !RunAvailability);
         if (MaxWaitingTime == 0)
         {
+#if LOOPSCHEDULER_USE_SMART_CV_WAITER
+            CVWaiter->Wait(NextEventConditionVariable, cv_lock, predicate);
+#else
             NextEventConditionVariable.wait(cv_lock, predicate);
+#endif
         }
         else if (MaxWaitingTime > 0)
         {
@@ -418,12 +726,18 @@ namespace LoopScheduler
             NextEventConditionVariable.wait_for(cv_lock, time, predicate);
 #endif
         }
+
+        if (statistics != nullptr)
+        {
+            std::chrono::duration<double> duration = std::chrono::steady_clock::now() - waiting_start;
+            statistics->ReportWaiting(duration.count());
+        }
     }
 
     bool ParallelGroup::IsDone()
     {
         std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
-        return MainQueue.size() == 0;
+        return MainSet.IsEmpty();
     }
 
     void ParallelGroup::StartNextIteration()
@@ -436,10 +750,16 @@ namespace LoopScheduler
     inline void ParallelGroup::StartNextIterationForThisGroup()
     {
         // NO MUTEX LOCK
-        MainQueue.clear();
-        SecondaryQueue.clear();
-        for (int i = 0; i < Members.size(); i++)
-            MainQueue.push_back(i);
+        RunPeriods.StartNextIteration();
+        if (RunPeriods.HasPeriods())
+            MainSet = RunPeriods.GetDueSet(); // Same size, no allocation
+        else
+            MainSet.Fill();
+        SecondarySet.Clear();
+        SecondaryCreditSet.Clear();
+        SecondaryCursor = 0;
+        if (Policy != nullptr)
+            UpdatePriorityOrder();
     }
 
     double ParallelGroup::PredictHigherRemainingExecutionTime()
@@ -449,14 +769,17 @@ namespace LoopScheduler
             return 0;
         double result = MNIMAL_TIME;
         auto now = std::chrono::steady_clock::now();
-        for (auto& item : ModulesRunCountsAndPredictedStopTimes)
-        {
-            std::chrono::duration<double> passed_time = now - item.second.StartTime;
-            result = std::max(result, item.second.HigherPredictedTimeSpan - passed_time.count());
-        }
-        for (auto& item : GroupsRunCounts)
+        for (int i = RunningSet.FindNext(0); i != -1; i = RunningSet.FindNext(i + 1))
         {
-            result = std::max(result, item.first->PredictHigherRemainingExecutionTime());
+            if (std::holds_alternative<std::shared_ptr<Module>>(Members[i].Member))
+            {
+                std::chrono::duration<double> passed_time = now - RunInfos[i].StartTime;
+                result = std::max(result, RunInfos[i].HigherPredictedTimeSpan - passed_time.count());
+            }
+            else
+            {
+                result = std::max(result, std::get<std::shared_ptr<Group>>(Members[i].Member)->PredictHigherRemainingExecutionTime());
+            }
         }
         return result;
     }
@@ -468,27 +791,54 @@ namespace LoopScheduler
             return 0;
         double result = MNIMAL_TIME;
         auto now = std::chrono::steady_clock::now();
-        for (auto& item : ModulesRunCountsAndPredictedStopTimes)
-        {
-            std::chrono::duration<double> passed_time = now - item.second.StartTime;
-            result = std::max(result, item.second.LowerPredictedTimeSpan - passed_time.count());
-        }
-        for (auto& item : GroupsRunCounts)
+        for (int i = RunningSet.FindNext(0); i != -1; i = RunningSet.FindNext(i + 1))
         {
-            result = std::max(result, item.first->PredictLowerRemainingExecutionTime());
+            if (std::holds_alternative<std::shared_ptr<Module>>(Members[i].Member))
+            {
+                std::chrono::duration<double> passed_time = now - RunInfos[i].StartTime;
+                result = std::max(result, RunInfos[i].LowerPredictedTimeSpan - passed_time.count());
+            }
+            else
+            {
+                result = std::max(result, std::get<std::shared_ptr<Group>>(Members[i].Member)->PredictLowerRemainingExecutionTime());
+            }
         }
         return result;
     }
 
     double ParallelGroup::PredictHigherExecutionTime()
     {
-        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
-        return HigherExecutionTimePredictor->Predict();
+        return HigherPrediction.load(std::memory_order_relaxed);
     }
     double ParallelGroup::PredictLowerExecutionTime()
     {
-        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
-        return LowerExecutionTimePredictor->Predict();
+        return LowerPrediction.load(std::memory_order_relaxed);
+    }
+
+    void ParallelGroup::NotifyAvailabilityChange()
+    {
+        {
+            // Lock before MembersSharedMutex lock for modifications before notify_all()
+            std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+            std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+            NotifyingCounter++;
+        }
+        NextEventConditionVariable.notify_all();
+        Group::NotifyAvailabilityChange();
+    }
+
+    void ParallelGroup::NotifyMemberInputAvailability()
+    {
+        int wake_ups_count;
+        {
+            // Lock before MembersSharedMutex lock for modifications before notify_all()
+            std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+            std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+            NotifyingCounter++;
+            // 1 run of the module became available.
+            wake_ups_count = Waiters.GetWakeUpsCount(1, false, false);
+        }
+        TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
     }
 
     bool ParallelGroup::UpdateLoop(Loop * LoopPtr)
@@ -509,8 +859,4 @@ namespace LoopScheduler
         }
         return true;
     }
-
-    ParallelGroup::integer::integer() : value(0) {}
-    ParallelGroup::integer::integer(int value) : value(value) {}
-    ParallelGroup::integer::operator int() { return value; }
 }
@@ -23,22 +23,24 @@
 #include "LoopScheduler.dec.h"
 #include "ModuleHoldingGroup.h"
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
-#include <list>
-#include <map>
 #include <memory>
 #include <shared_mutex>
 #include <tuple>
 #include <vector>
 
+#include "IndexSet.h"
 #include "ParallelGroupMember.h"
+#include "RunPeriodTracker.h"
+#include "TargetedNotifier.h"
 
 namespace LoopScheduler
 {
     /// @brief A group that runs the sub-groups and modules in parallel, but in order.
     ///
-    /// Some members can be run more than once.
+    /// Some members can be run more than once, or only on some iterations.
     /// This can be specified in ParallelGroupMember when constructing and object of this class.
     /// When IsDone() returns true, members might be still running.
     /// That means when this group is in the root,
@@ -63,12 +65,16 @@ namespace LoopScheduler
         /// @param LowerExecutionTimePredictor Predictor to predict the lower execution time of the whole group.
         ///                                    nullptr to use default.
         /// @param CVWaiter One waiter can be shared between different objects or have different time predictors.
+        /// @param Policy The policy to order the first runs of the members, ranked on each iteration's start.
+        ///               nullptr to run them in the members' order.
+        ///               The additional runs are not affected.
         ParallelGroup(
             std::vector<ParallelGroupMember> Members,
             bool ExtendIterationForAdditionalGroupRuns = false,
             std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor = nullptr,
             std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor = nullptr,
-            std::shared_ptr<SmartCVWaiter> CVWaiter = nullptr
+            std::shared_ptr<SmartCVWaiter> CVWaiter = nullptr,
+            std::shared_ptr<SchedulingPolicy> Policy = nullptr
         );
         virtual bool RunNext(double MaxEstimatedExecutionTime = 0) override;
         virtual bool IsRunAvailable(double MaxEstimatedExecutionTime = 0) override;
@@ -81,20 +87,59 @@ namespace LoopScheduler
         virtual double PredictLowerRemainingExecutionTime() override;
         virtual double PredictHigherExecutionTime() override;
         virtual double PredictLowerExecutionTime() override;
+        virtual void NotifyAvailabilityChange() override;
+        /// @brief Reserves module members in the same order as RunNext.
+        ///        Group members are not reserved, they can only run via RunNext.
+        ///        The modules with Module::HardAffinity are not reserved either.
+        virtual int ReserveNext(
+            std::vector<ReservedRun>& Output, int MaxCount, const std::function<void()>& OnReserved = nullptr
+        ) override;
+        /// @brief Sets whether RunNext packs the time window when MaxEstimatedExecutionTime is provided (e.g. by Idle).
+        ///
+        /// When enabled, RunNext runs module members back-to-back before returning,
+        /// each time choosing the one with the highest higher predicted execution time that fits the remaining time
+        /// (best-fit decreasing), the first runs before the additional runs.
+        /// The members' order and the policy are not used for these runs.
+        /// Group members only run as usual when no module member fits.
+        /// Disabled by default.
+        ///
+        /// Thread-safe
+        void SetBudgetPacking(bool Enabled);
+        /// @brief Thread-safe
+        bool GetBudgetPacking();
     protected:
         virtual bool UpdateLoop(Loop*) override;
+        virtual void RunReserved(int MemberIndex, Module::RunningToken& Token) override;
+        virtual void CancelReserved(int MemberIndex) override;
+        virtual void FinishSuspendedRun(int MemberIndex) override;
+        virtual void NotifyMemberInputAvailability() override;
     private:
         /// @brief A shared mutex for class members.
         std::shared_mutex MembersSharedMutex;
 
         std::vector<ParallelGroupMember> Members;
         std::vector<std::shared_ptr<Group>> GroupMembers;
-        std::list<int> MainQueue;
-        std::list<int> SecondaryQueue;
+        /// @brief Decides the members that run in each iteration, by their periods.
+        RunPeriodTracker RunPeriods;
+        /// @brief The members that haven't started their first run in this iteration.
+        IndexSet MainSet;
+        /// @brief The members that can run more, after their first run in this iteration.
+        IndexSet SecondarySet;
+        /// @brief The members in SecondarySet that have remaining run shares in the current round.
+        ///
+        /// Additional runs are distributed using weighted round-robin,
+        /// each member has its RunSharesAfterFirstRun as the credits for each round.
+        /// A new round starts when all the credits are used.
+        IndexSet SecondaryCreditSet;
+        std::vector<int> SecondaryCredits;
+        /// @brief The index to start looking for the next additional run from.
+        int SecondaryCursor;
         bool ExtendIterationForAdditionalGroupRuns;
         int RunningThreadsCount;
-        int NotifyingCounter;
-        int RunNextCount;
+        bool BudgetPacking;
+        /// @brief Incremented with both NextEventConditionMutex and MembersSharedMutex locked.
+        ///        Atomic to be read by the waiters' predicates without locking MembersSharedMutex.
+        std::atomic<int> NotifyingCounter;
 
         /// Is set to true on measurement start,
         /// and set to false after the measurement.
@@ -105,44 +150,90 @@ namespace LoopScheduler
 
         std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor;
         std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor;
+        /// @brief The predictors' predictions, published on each observation to be read without locking.
+        std::atomic<double> HigherPrediction;
+        std::atomic<double> LowerPrediction;
         std::shared_ptr<SmartCVWaiter> CVWaiter;
 
-        class integer // 0 by default
-        {
-            public: integer(); integer(int); operator int(); int value;
-        };
+        std::shared_ptr<SchedulingPolicy> Policy;
+        /// @brief The member indexes ordered by the policy's priorities. Only used when there is a policy.
+        std::vector<int> PriorityOrder;
+        std::vector<double> Priorities;
 
-        class ModuleRunCountAndPredictedStopTimes
+        /// @brief The run information of a member, indexed the same as Members.
+        class MemberRunInfo
         {
         public:
-            integer RunCount;
+            /// @brief The number of the member's runs that are running or reserved.
+            int RunCount = 0;
+            /// @brief Only used for module members, set on each run's start.
             std::chrono::steady_clock::time_point StartTime;
-            double HigherPredictedTimeSpan;
-            double LowerPredictedTimeSpan;
+            double HigherPredictedTimeSpan = 0;
+            double LowerPredictedTimeSpan = 0;
         };
 
-        std::map<std::shared_ptr<Module>, ModuleRunCountAndPredictedStopTimes> ModulesRunCountsAndPredictedStopTimes;
-        std::map<std::shared_ptr<Group>, integer> GroupsRunCounts;
+        /// @brief Pre-sized on construction, no allocation is needed to run the members.
+        std::vector<MemberRunInfo> RunInfos;
+        /// @brief The members that have a RunCount more than 0.
+        IndexSet RunningSet;
+        /// @brief For each module member that shares its module with other members, the indexes of all of them.
+        ///        Empty for the other members.
+        std::vector<std::vector<int>> SharedModuleIndexes;
 
         /// Must be locked BEFORE MembersSharedMutex lock
         /// when modifying members before NextEventConditionVariable.notify_all().
         std::mutex NextEventConditionMutex;
         std::condition_variable NextEventConditionVariable;
+        /// @brief Counts the threads waiting on NextEventConditionVariable to wake up only the needed ones.
+        TargetedNotifier Waiters;
 
-        inline bool RunModule(
-            std::shared_ptr<Module>&,
-            std::unique_lock<std::shared_mutex>&,
-            std::list<int>&,
-            std::list<int>&,
-            std::list<int>::iterator&,
-            int
-        );
-        inline bool RunGroup(std::shared_ptr<Group>&, std::unique_lock<std::shared_mutex>&, double MaxEstimatedExecutionTime);
+        inline bool RunModule(int Index, std::unique_lock<std::shared_mutex>&, bool IsFirstRun);
+        inline bool RunGroup(int Index, std::unique_lock<std::shared_mutex>&, double MaxEstimatedExecutionTime);
+        /// @brief Runs the module members that best fit the remaining time back-to-back. See SetBudgetPacking.
+        /// @return Whether something was run.
+        inline bool RunBestFits(std::unique_lock<std::shared_mutex>&, double MaxEstimatedExecutionTime);
+        /// @brief Returns the index of the available module member in the set, except the skipped ones,
+        ///        with the highest higher predicted execution time that fits the time, or -1.
+        ///
+        /// NO MUTEX LOCK
+        inline int FindBestFit(IndexSet& Set, double MaxEstimatedExecutionTime, const std::vector<int>& SkippedIndexes);
+        /// NO MUTEX LOCK
+        inline bool ReserveModule(int Index, bool IsFirstRun, std::vector<ReservedRun>&);
+        /// LOCKS MUTEX
+        /// Releases a reserved or suspended module run.
+        inline void FinishReservedModuleRun(int MemberIndex);
+        /// @brief Returns the number of waiters to wake up after a module member's run.
+        ///
+        /// NO MUTEX LOCK
+        inline int GetWakeUpsCountAfterModuleRun(int Index);
+        /// @brief Updates the sets when a member's run starts,
+        ///        or when a group member is done in the iteration (as its first run).
+        ///
+        /// NO MUTEX LOCK
+        inline void MarkRunStart(int Index, bool IsFirstRun);
+        /// @brief Calls the function for indexes in the set, starting from Start and continuing from 0.
+        ///        Stops when the function returns true.
+        ///
+        /// The set can be modified in the function.
+        /// NO MUTEX LOCK
+        template <typename FunctionType>
+        inline bool ForEachCyclic(IndexSet& Set, int Start, FunctionType Function);
+        /// @brief Calls the function for indexes in MainSet, in the policy's order if there is a policy.
+        ///        Stops when the function returns true.
+        ///
+        /// The set can be modified in the function.
+        /// NO MUTEX LOCK
+        template <typename FunctionType>
+        inline bool ForEachMain(FunctionType Function);
+        /// @brief Ranks the members using the policy.
+        ///
+        /// NO MUTEX LOCK
+        inline void UpdatePriorityOrder();
 
         /// Should be placed in RunNext's start.
         /// NO MUTEX LOCK
         inline void TimespanMeasurementStart();
-        /// Should be placed after each direct or indirect MainQueue.erase(...)
+        /// Should be placed after each direct or indirect MainSet.Remove(...)
         /// and before unlocking the mutex.
         /// NO MUTEX LOCK
         inline void TimespanMeasurementStop();
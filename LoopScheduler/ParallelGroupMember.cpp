@@ -24,8 +24,10 @@ namespace LoopScheduler
 {
     ParallelGroupMember::ParallelGroupMember(
             std::variant<std::shared_ptr<Group>, std::shared_ptr<Module>> Member,
-            int RunSharesAfterFirstRun
+            int RunSharesAfterFirstRun,
+            RunPeriod Period
         ) : Member(Member),
-            RunSharesAfterFirstRun(RunSharesAfterFirstRun)
+            RunSharesAfterFirstRun(RunSharesAfterFirstRun),
+            Period(Period)
     {}
 }
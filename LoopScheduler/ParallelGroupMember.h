@@ -25,6 +25,8 @@
 #include <memory>
 #include <variant>
 
+#include "RunPeriod.h"
+
 namespace LoopScheduler
 {
     /// @brief Represents a group member of either another group or a module.
@@ -36,11 +38,15 @@ namespace LoopScheduler
         ///                               0 Means it can only run once per loop iteration.
         ///
         /// This can be set to more than 1 for those members that need to run more often than others after the first run.
+        /// @param Period How often the member runs, for the members that need to run less often than once per iteration.
+        ///               The member has no additional runs on the iterations it's skipped on.
         ParallelGroupMember(
             std::variant<std::shared_ptr<Group>, std::shared_ptr<Module>> Member,
-            int RunSharesAfterFirstRun = 0
+            int RunSharesAfterFirstRun = 0,
+            RunPeriod Period = RunPeriod()
         );
         std::variant<std::shared_ptr<Group>, std::shared_ptr<Module>> Member;
         int RunSharesAfterFirstRun;
+        RunPeriod Period;
     };
 }
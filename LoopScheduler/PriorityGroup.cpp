@@ -0,0 +1,628 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "PriorityGroup.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "Module.h"
+#include "BiasedEMATimeSpanPredictor.h"
+#include "ExecutionStatistics.h"
+#include "Loop.h"
+#include "SmartCVWaiter.h"
+#include "Tracer.h"
+
+namespace LoopScheduler
+{
+    PriorityGroup::PriorityGroup(
+            std::vector<PriorityGroupMember> Members,
+            DispatchPolicy Policy,
+            std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor,
+            std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor,
+            std::shared_ptr<SmartCVWaiter> CVWaiter
+        ) : Members(Members), ReadySet(Members.size()), RunningSet(Members.size()), DoneSet(Members.size()),
+            RemainingMembersCount(0), RunningThreadsCount(0), MissedDeadlinesCount(0), NotifyingCounter(0),
+            RunInfos(Members.size()), MeasuringTimespan(false)
+    {
+        for (auto& member : Members)
+            if (!(member.Deadline >= 0))
+                throw std::logic_error("A member's deadline cannot be negative.");
+
+        // Static, the deadlines are relative to the iteration's start that all the members are ready at.
+        for (int i = 0; i < Members.size(); i++)
+            DispatchOrder.push_back(i);
+        const auto deadline_key = [&Members](int i) {
+            return Members[i].Deadline == 0 ? std::numeric_limits<double>::infinity() : Members[i].Deadline;
+        };
+        if (Policy == DispatchPolicy::HighestPriorityFirst)
+            std::stable_sort(DispatchOrder.begin(), DispatchOrder.end(), [&](int a, int b) {
+                if (Members[a].Priority != Members[b].Priority)
+                    return Members[a].Priority > Members[b].Priority;
+                return deadline_key(a) < deadline_key(b);
+            });
+        else
+            std::stable_sort(DispatchOrder.begin(), DispatchOrder.end(), [&](int a, int b) {
+                if (deadline_key(a) != deadline_key(b))
+                    return deadline_key(a) < deadline_key(b);
+                return Members[a].Priority > Members[b].Priority;
+            });
+
+        std::vector<std::shared_ptr<Group>> member_groups;
+        std::vector<std::shared_ptr<Module>> member_modules;
+        for (auto& member : Members)
+            if (std::holds_alternative<std::shared_ptr<Group>>(member.Member))
+                member_groups.push_back(std::get<std::shared_ptr<Group>>(member.Member));
+            else
+                member_modules.push_back(std::get<std::shared_ptr<Module>>(member.Member));
+
+        IntroduceMembers(std::move(member_groups), std::move(member_modules));
+
+        for (auto& member : Members)
+            if (std::holds_alternative<std::shared_ptr<Group>>(member.Member))
+                GroupMembers.push_back(std::get<std::shared_ptr<Group>>(member.Member));
+
+        if (HigherExecutionTimePredictor == nullptr)
+            HigherExecutionTimePredictor = std::unique_ptr<BiasedEMATimeSpanPredictor>(
+                new BiasedEMATimeSpanPredictor(
+                    0,
+                    BiasedEMATimeSpanPredictor::DEFAULT_FAST_ALPHA,
+                    BiasedEMATimeSpanPredictor::DEFAULT_SLOW_ALPHA
+                )
+            );
+        if (LowerExecutionTimePredictor == nullptr)
+            LowerExecutionTimePredictor = std::unique_ptr<BiasedEMATimeSpanPredictor>(
+                new BiasedEMATimeSpanPredictor(
+                    0,
+                    BiasedEMATimeSpanPredictor::DEFAULT_SLOW_ALPHA,
+                    BiasedEMATimeSpanPredictor::DEFAULT_FAST_ALPHA
+                )
+            );
+        if (CVWaiter == nullptr)
+            CVWaiter = std::shared_ptr<SmartCVWaiter>(new SmartCVWaiter());
+
+        this->HigherExecutionTimePredictor = std::move(HigherExecutionTimePredictor);
+        this->LowerExecutionTimePredictor = std::move(LowerExecutionTimePredictor);
+        HigherPrediction.store(this->HigherExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+        LowerPrediction.store(this->LowerExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+        this->CVWaiter = CVWaiter;
+
+        StartNextIterationForThisGroup();
+    }
+
+    bool PriorityGroup::RunNext(double MaxEstimatedExecutionTime)
+    {
+        std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        StartMeasuringLockHolding();
+
+        if (!MeasuringTimespan && RemainingMembersCount != 0)
+        {
+            IterationStartTime = std::chrono::steady_clock::now();
+            MeasuringTimespan = true;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        double iteration_time = GetIterationTime(now);
+        // The lowest slack of the members dispatched before the current one.
+        double slack = std::numeric_limits<double>::infinity();
+        for (int i : DispatchOrder)
+        {
+            if (ReadySet.Contains(i))
+            {
+                double max_time = LimitBySlack(MaxEstimatedExecutionTime, slack);
+                if (std::holds_alternative<std::shared_ptr<Module>>(Members[i].Member))
+                {
+                    auto& m = std::get<std::shared_ptr<Module>>(Members[i].Member);
+                    if (max_time >= 0 && (max_time == 0 || m->PredictHigherExecutionTime() <= max_time)
+                        && RunModule(i, lock))
+                        return true;
+                }
+                else
+                {
+                    auto& g = std::get<std::shared_ptr<Group>>(Members[i].Member);
+                    if (g->IsDone())
+                    {
+                        if (RunInfos[i].RunCount == 0)
+                        {
+                            MarkDone(i);
+                            continue;
+                        }
+                    }
+                    else if (max_time >= 0 && g->IsRunAvailable(max_time))
+                    {
+                        return RunGroup(i, lock, max_time);
+                    }
+                }
+            }
+            slack = std::min(slack, GetSlack(i, iteration_time));
+        }
+        StopMeasuringLockHolding();
+        if (RemainingMembersCount == 0) // IsDone()
+        {
+            lock.unlock();
+            return RunUnfinishedMemberGroup(MaxEstimatedExecutionTime);
+        }
+        return false;
+    }
+    inline bool PriorityGroup::RunModule(int Index, std::unique_lock<std::shared_mutex>& lock)
+    {
+        auto& m = std::get<std::shared_ptr<Module>>(Members[Index].Member);
+        auto token = m->GetRunningToken();
+        if (!token.CanRun())
+            return false;
+        ReadySet.Remove(Index);
+        RunningSet.Add(Index);
+        auto& runinfo = RunInfos[Index];
+        runinfo.RunCount++;
+        RunningThreadsCount++;
+        runinfo.StartTime = std::chrono::steady_clock::now();
+        runinfo.HigherPredictedTimeSpan = m->PredictHigherExecutionTime();
+        runinfo.LowerPredictedTimeSpan = m->PredictLowerExecutionTime();
+        StopMeasuringLockHolding();
+        lock.unlock();
+
+        // Starting a member with a deadline releases the members held back by it.
+        if (Members[Index].Deadline != 0)
+        {
+            // Lock before MembersSharedMutex lock for modifications before notify_all()
+            std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+            lock.lock();
+            NotifyingCounter++;
+            int wake_ups_count = Waiters.GetWakeUpsCount(TargetedNotifier::ALL, RemainingMembersCount == 0, RunningThreadsCount == 0);
+            lock.unlock();
+            cv_lock.unlock();
+            TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
+        }
+
+        if (token.Run(this, Index))
+            FinishModuleRun(Index);
+        // Else, released by FinishSuspendedRun
+        return true;
+    }
+    inline void PriorityGroup::FinishModuleRun(int Index)
+    {
+        // Lock before MembersSharedMutex lock for modifications before notify_all()
+        std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+        std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        RunInfos[Index].RunCount--;
+        RunningThreadsCount--;
+        NotifyingCounter++;
+        RunningSet.Remove(Index);
+        MarkDone(Index);
+        // Finishing a member with a deadline can release the members held back by it.
+        int ready_count = Members[Index].Deadline != 0 ? TargetedNotifier::ALL : 0;
+        int wake_ups_count = Waiters.GetWakeUpsCount(ready_count, RemainingMembersCount == 0, RunningThreadsCount == 0);
+        lock.unlock();
+        cv_lock.unlock();
+        TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
+    }
+    void PriorityGroup::FinishSuspendedRun(int MemberIndex)
+    {
+        FinishModuleRun(MemberIndex);
+    }
+    inline bool PriorityGroup::RunGroup(int Index, std::unique_lock<std::shared_mutex>& lock, double MaxEstimatedExecutionTime)
+    {
+        auto& g = std::get<std::shared_ptr<Group>>(Members[Index].Member);
+        auto& runinfo = RunInfos[Index];
+        RunningSet.Add(Index);
+        runinfo.RunCount++;
+        RunningThreadsCount++;
+        StopMeasuringLockHolding();
+        lock.unlock();
+
+        bool success;
+        {
+#if LOOPSCHEDULER_ENABLE_TRACING
+            Tracer::Scope trace_scope("PriorityGroup::RunGroup", "run", g.get());
+#endif
+            success = g->RunNext(MaxEstimatedExecutionTime);
+#if LOOPSCHEDULER_ENABLE_TRACING
+            if (!success)
+                trace_scope.Discard();
+#endif
+        }
+
+        // Lock before MembersSharedMutex lock for modifications before notify_all()
+        std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+        lock.lock();
+        RunningThreadsCount--;
+        NotifyingCounter++;
+        if (--runinfo.RunCount == 0)
+        {
+            RunningSet.Remove(Index);
+            if (ReadySet.Contains(Index) && g->IsDone())
+                MarkDone(Index);
+        }
+        // The number of the runs available in the group is unknown.
+        int wake_ups_count = Waiters.GetWakeUpsCount(TargetedNotifier::ALL, RemainingMembersCount == 0, RunningThreadsCount == 0);
+        lock.unlock();
+        cv_lock.unlock();
+        TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
+        return success;
+    }
+    inline void PriorityGroup::MarkDone(int Index)
+    {
+        // NO MUTEX LOCK
+        ReadySet.Remove(Index);
+        DoneSet.Add(Index);
+        auto now = std::chrono::steady_clock::now();
+        if (Members[Index].Deadline != 0 && GetIterationTime(now) > Members[Index].Deadline)
+            MissedDeadlinesCount++;
+        if (--RemainingMembersCount == 0 && MeasuringTimespan)
+        {
+            std::chrono::duration<double> duration = now - IterationStartTime;
+            double time = duration.count();
+            HigherExecutionTimePredictor->ReportObservation(time);
+            LowerExecutionTimePredictor->ReportObservation(time);
+            HigherPrediction.store(HigherExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+            LowerPrediction.store(LowerExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+            if (auto statistics = GetStatistics())
+                statistics->ReportRun(time);
+            MeasuringTimespan = false;
+        }
+    }
+
+    inline double PriorityGroup::GetIterationTime(std::chrono::steady_clock::time_point Now)
+    {
+        // NO MUTEX LOCK
+        if (!MeasuringTimespan)
+            return 0;
+        std::chrono::duration<double> duration = Now - IterationStartTime;
+        return duration.count();
+    }
+    inline double PriorityGroup::GetSlack(int Index, double IterationTime)
+    {
+        // NO MUTEX LOCK
+        double deadline = Members[Index].Deadline;
+        if (deadline == 0 || IterationTime >= deadline || DoneSet.Contains(Index))
+            return std::numeric_limits<double>::infinity();
+        double remaining_time = 0;
+        if (std::holds_alternative<std::shared_ptr<Module>>(Members[Index].Member))
+        {
+            // A running module already has its thread, holding back the others can't help it.
+            if (RunningSet.Contains(Index))
+                return std::numeric_limits<double>::infinity();
+            remaining_time = std::get<std::shared_ptr<Module>>(Members[Index].Member)->PredictHigherExecutionTime();
+        }
+        else
+        {
+            // Double mutex lock can occur if there's a group loop.
+            auto& g = std::get<std::shared_ptr<Group>>(Members[Index].Member);
+            // A done group that is still running can't take more threads.
+            if (g->IsDone())
+                return std::numeric_limits<double>::infinity();
+            if (RunningSet.Contains(Index))
+                remaining_time = g->PredictHigherRemainingExecutionTime();
+            else
+                remaining_time = g->PredictHigherExecutionTime();
+        }
+        return deadline - IterationTime - remaining_time;
+    }
+    inline double PriorityGroup::LimitBySlack(double MaxEstimatedExecutionTime, double Slack)
+    {
+        if (Slack == std::numeric_limits<double>::infinity())
+            return MaxEstimatedExecutionTime;
+        if (Slack <= 0)
+            return -1;
+        if (MaxEstimatedExecutionTime == 0 || Slack < MaxEstimatedExecutionTime)
+            return Slack;
+        return MaxEstimatedExecutionTime;
+    }
+
+    bool PriorityGroup::IsRunAvailable(double MaxEstimatedExecutionTime)
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        if (RemainingMembersCount == 0) // IsDone()
+            return IsUnfinishedMemberGroupRunAvailable(MaxEstimatedExecutionTime);
+        double holding_time;
+        return IsRunAvailableNoLock(MaxEstimatedExecutionTime, holding_time);
+    }
+    bool PriorityGroup::IsAvailable(double MaxEstimatedExecutionTime)
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        if (RemainingMembersCount == 0) // IsDone()
+            return true;
+        double holding_time;
+        return IsRunAvailableNoLock(MaxEstimatedExecutionTime, holding_time);
+    }
+    inline bool PriorityGroup::IsRunAvailableNoLock(double MaxEstimatedExecutionTime, double& HoldingTime)
+    {
+        HoldingTime = 0;
+        auto now = std::chrono::steady_clock::now();
+        double iteration_time = GetIterationTime(now);
+        double slack = std::numeric_limits<double>::infinity();
+        // The time until the earliest deadline of the members dispatched before the current one, that can hold it back.
+        double deadline_time = std::numeric_limits<double>::infinity();
+        for (int i : DispatchOrder)
+        {
+            if (ReadySet.Contains(i))
+            {
+                double max_time = LimitBySlack(MaxEstimatedExecutionTime, slack);
+                if (std::holds_alternative<std::shared_ptr<Module>>(Members[i].Member))
+                {
+                    auto& m = std::get<std::shared_ptr<Module>>(Members[i].Member);
+                    if (max_time >= 0 && (max_time == 0 || m->PredictHigherExecutionTime() <= max_time)
+                        && m->IsAvailable())
+                        return true;
+                }
+                else
+                {
+                    auto& g = std::get<std::shared_ptr<Group>>(Members[i].Member);
+                    if (g->IsDone())
+                    {
+                        if (RunInfos[i].RunCount == 0) // Can be marked as done by RunNext
+                            return true;
+                    }
+                    else if (max_time >= 0 && g->IsAvailable(max_time))
+                    {
+                        return true;
+                    }
+                }
+                if (slack != std::numeric_limits<double>::infinity())
+                    HoldingTime = deadline_time;
+            }
+            double member_slack = GetSlack(i, iteration_time);
+            if (member_slack != std::numeric_limits<double>::infinity())
+            {
+                slack = std::min(slack, member_slack);
+                deadline_time = std::min(deadline_time, Members[i].Deadline - iteration_time);
+            }
+        }
+        return false;
+    }
+
+    void PriorityGroup::WaitForRunAvailability(double MaxEstimatedExecutionTime, double MaxWaitingTime)
+    {
+        // There's nothing left to do when IsDone=true, except in the unfinished member groups.
+        if (RemainingMembersCount.load() == 0)
+        {
+            WaitForUnfinishedMemberGroup(MaxEstimatedExecutionTime, MaxWaitingTime);
+            return;
+        }
+        WaitForAvailabilityCommon(MaxEstimatedExecutionTime, MaxWaitingTime);
+    }
+    void PriorityGroup::WaitForAvailability(double MaxEstimatedExecutionTime, double MaxWaitingTime)
+    {
+        WaitForAvailabilityCommon(MaxEstimatedExecutionTime, MaxWaitingTime);
+    }
+    inline void PriorityGroup::WaitForAvailabilityCommon(double MaxEstimatedExecutionTime, double MaxWaitingTime)
+    {
+        std::chrono::time_point<std::chrono::steady_clock> start;
+        if (MaxWaitingTime != 0)
+            start = std::chrono::steady_clock::now();
+
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        int start_notifying_counter = NotifyingCounter;
+
+        if (RunningThreadsCount == 0)
+            return;
+        if (RemainingMembersCount == 0) // IsDone()
+            return;
+        double holding_time;
+        if (IsRunAvailableNoLock(MaxEstimatedExecutionTime, holding_time))
+            return;
+
+        lock.unlock();
+
+        // A deadline passing releases the members held back by it without a notification.
+        if (holding_time > 0)
+        {
+            if (MaxWaitingTime == 0)
+            {
+                start = std::chrono::steady_clock::now();
+                MaxWaitingTime = holding_time;
+            }
+            else
+            {
+                MaxWaitingTime = std::min(MaxWaitingTime, holding_time);
+            }
+        }
+
+        const auto predicate = [this, start_notifying_counter] {
+            // Doesn't need MembersSharedMutex, NotifyingCounter is only modified with NextEventConditionMutex locked.
+            return start_notifying_counter != NotifyingCounter.load(std::memory_order_relaxed)
+                || Loop::HasQueuedRunsForParkedWorker();
+        };
+
+        auto statistics = GetStatistics();
+        std::chrono::time_point<std::chrono::steady_clock> waiting_start;
+        if (statistics != nullptr)
+            waiting_start = std::chrono::steady_clock::now();
+
+        LOOPSCHEDULER_TRACE_SCOPE("PriorityGroup::Wait", "wait", this);
+        std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+        TargetedNotifier::WaitingGuard waiting_guard(
+                Waiters, MaxEstimatedExecutionTime != 0 || Loop::IsCurrentThreadConstrained(), true);
+        if (MaxWaitingTime == 0)
+        {
+#if LOOPSCHEDULER_USE_SMART_CV_WAITER
+            CVWaiter->Wait(NextEventConditionVariable, cv_lock, predicate);
+#else
+            NextEventConditionVariable.wait(cv_lock, predicate);
+#endif
+        }
+        else if (MaxWaitingTime > 0)
+        {
+            auto stop = start + std::chrono::duration<double>(MaxWaitingTime);
+            std::chrono::duration<double> time = stop - std::chrono::steady_clock::now();
+#if LOOPSCHEDULER_USE_SMART_CV_WAITER
+            CVWaiter->WaitFor(NextEventConditionVariable, cv_lock, time, predicate);
+#else
+            NextEventConditionVariable.wait_for(cv_lock, time, predicate);
+#endif
+        }
+
+        if (statistics != nullptr)
+        {
+            std::chrono::duration<double> duration = std::chrono::steady_clock::now() - waiting_start;
+            statistics->ReportWaiting(duration.count());
+        }
+    }
+
+    bool PriorityGroup::IsDone()
+    {
+        return RemainingMembersCount.load() == 0;
+    }
+
+    void PriorityGroup::StartNextIteration()
+    {
+        std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        StartNextIterationForThisGroup();
+        for (auto& group_member : GroupMembers)
+            group_member->StartNextIteration();
+    }
+    inline void PriorityGroup::StartNextIterationForThisGroup()
+    {
+        // NO MUTEX LOCK
+        ReadySet.Clear();
+        DoneSet.Clear();
+        for (int i = 0; i < Members.size(); i++)
+            ReadySet.Add(i);
+        RemainingMembersCount = Members.size();
+    }
+
+    double PriorityGroup::PredictHigherRemainingExecutionTime()
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        return PredictRemainingExecutionTimeNoLock<true>();
+    }
+
+    double PriorityGroup::PredictLowerRemainingExecutionTime()
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        return PredictRemainingExecutionTimeNoLock<false>();
+    }
+
+    double PriorityGroup::PredictHigherExecutionTime()
+    {
+        return HigherPrediction.load(std::memory_order_relaxed);
+    }
+    double PriorityGroup::PredictLowerExecutionTime()
+    {
+        return LowerPrediction.load(std::memory_order_relaxed);
+    }
+
+    void PriorityGroup::NotifyAvailabilityChange()
+    {
+        {
+            // Lock before MembersSharedMutex lock for modifications before notify_all()
+            std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+            std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+            NotifyingCounter++;
+        }
+        NextEventConditionVariable.notify_all();
+        Group::NotifyAvailabilityChange();
+    }
+
+    int PriorityGroup::GetMissedDeadlinesCount()
+    {
+        return MissedDeadlinesCount.load(std::memory_order_relaxed);
+    }
+
+    void PriorityGroup::NotifyMemberInputAvailability()
+    {
+        int wake_ups_count;
+        {
+            // Lock before MembersSharedMutex lock for modifications before notify_all()
+            std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+            std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+            NotifyingCounter++;
+            // 1 run of the module became available.
+            wake_ups_count = Waiters.GetWakeUpsCount(1, false, false);
+        }
+        TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
+    }
+
+    bool PriorityGroup::UpdateLoop(Loop * LoopPtr)
+    {
+        for (int i = 0; i < Members.size(); i++)
+        {
+            if (std::holds_alternative<std::shared_ptr<Module>>(Members[i].Member))
+            {
+                auto& m = std::get<std::shared_ptr<Module>>(Members[i].Member);
+                if (!m->SetLoop(LoopPtr))
+                {
+                    for (int j = 0; j < i; j++)
+                        if (std::holds_alternative<std::shared_ptr<Module>>(Members[j].Member))
+                            std::get<std::shared_ptr<Module>>(Members[j].Member)->SetLoop(nullptr);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    template <bool Higher>
+    inline double PriorityGroup::PredictRemainingExecutionTimeNoLock()
+    {
+        // NO MUTEX LOCK
+        if (RunningThreadsCount == 0)
+            return 0;
+        double result = MNIMAL_TIME;
+        auto now = std::chrono::steady_clock::now();
+        for (int i = 0; i < Members.size(); i++)
+        {
+            if (DoneSet.Contains(i))
+                continue;
+            double time = 0;
+            if (std::holds_alternative<std::shared_ptr<Module>>(Members[i].Member))
+            {
+                auto& m = std::get<std::shared_ptr<Module>>(Members[i].Member);
+                if (RunningSet.Contains(i))
+                {
+                    std::chrono::duration<double> passed_time = now - RunInfos[i].StartTime;
+                    if constexpr (Higher)
+                        time = std::max(RunInfos[i].HigherPredictedTimeSpan - passed_time.count(), MNIMAL_TIME);
+                    else
+                        time = std::max(RunInfos[i].LowerPredictedTimeSpan - passed_time.count(), MNIMAL_TIME);
+                }
+                else
+                {
+                    if constexpr (Higher)
+                        time = m->PredictHigherExecutionTime();
+                    else
+                        time = m->PredictLowerExecutionTime();
+                }
+            }
+            else
+            {
+                // Double mutex lock can occur if there's a group loop.
+                auto& g = std::get<std::shared_ptr<Group>>(Members[i].Member);
+                if (RunningSet.Contains(i))
+                {
+                    if constexpr (Higher)
+                        time = g->PredictHigherRemainingExecutionTime();
+                    else
+                        time = g->PredictLowerRemainingExecutionTime();
+                }
+                else if (!g->IsDone())
+                {
+                    if constexpr (Higher)
+                        time = g->PredictHigherExecutionTime();
+                    else
+                        time = g->PredictLowerExecutionTime();
+                }
+            }
+            result = std::max(result, time);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,200 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include "LoopScheduler.dec.h"
+#include "ModuleHoldingGroup.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "IndexSet.h"
+#include "PriorityGroupMember.h"
+#include "TargetedNotifier.h"
+
+namespace LoopScheduler
+{
+    /// @brief A group that runs the sub-groups and modules once per iteration in parallel,
+    ///        dispatching the ready members by their priorities or deadlines.
+    ///
+    /// The members' priorities and deadlines are specified in PriorityGroupMember.
+    /// A module member is done when its run is finished,
+    /// a group member is done when its IsDone returns true and it's not running in any thread.
+    ///
+    /// A member is held back while a member dispatched before it has a deadline that is not passed,
+    /// and is a module that is not started yet or a group that is not done,
+    /// and starting the member would take more than that member's slack:
+    /// the time until the deadline minus the higher predicted remaining time of that member
+    /// (PredictHigherRemainingExecutionTime for a running group member).
+    /// A running module member doesn't hold back the others, it already has a thread.
+    /// This keeps the threads free for the members with the deadlines, like a sub-group that can't run all of its
+    /// members in parallel, instead of starting a long lower-priority module.
+    /// A group member that is held back can still run what fits the slack, using its RunNext(MaxEstimatedExecutionTime).
+    class PriorityGroup : public ModuleHoldingGroup
+    {
+    public:
+        /// @brief The order that the members are dispatched in.
+        enum class DispatchPolicy
+        {
+            /// @brief Higher priorities first, then earlier deadlines.
+            HighestPriorityFirst,
+            /// @brief Earlier deadlines first (EDF), then higher priorities.
+            ///        The members without a deadline come after the ones with a deadline.
+            EarliestDeadlineFirst
+        };
+
+        /// @param Policy The order that the members are dispatched in. The members' order is used for the ties.
+        ///               Throws std::logic_error if a deadline is negative.
+        /// @param HigherExecutionTimePredictor Predictor to predict the higher execution time of the whole group.
+        ///                                     nullptr to use default.
+        /// @param LowerExecutionTimePredictor Predictor to predict the lower execution time of the whole group.
+        ///                                    nullptr to use default.
+        /// @param CVWaiter One waiter can be shared between different objects or have different time predictors.
+        PriorityGroup(
+            std::vector<PriorityGroupMember> Members,
+            DispatchPolicy Policy = DispatchPolicy::HighestPriorityFirst,
+            std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor = nullptr,
+            std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor = nullptr,
+            std::shared_ptr<SmartCVWaiter> CVWaiter = nullptr
+        );
+        virtual bool RunNext(double MaxEstimatedExecutionTime = 0) override;
+        virtual bool IsRunAvailable(double MaxEstimatedExecutionTime = 0) override;
+        virtual void WaitForRunAvailability(double MaxEstimatedExecutionTime = 0, double MaxWaitingTime = 0) override;
+        virtual bool IsAvailable(double MaxEstimatedExecutionTime = 0) override;
+        virtual void WaitForAvailability(double MaxEstimatedExecutionTime = 0, double MaxWaitingTime = 0) override;
+        virtual bool IsDone() override;
+        virtual void StartNextIteration() override;
+        /// @brief Returns the highest higher predicted remaining time of the members that are not done.
+        virtual double PredictHigherRemainingExecutionTime() override;
+        /// @brief Returns the highest lower predicted remaining time of the members that are not done.
+        virtual double PredictLowerRemainingExecutionTime() override;
+        virtual double PredictHigherExecutionTime() override;
+        virtual double PredictLowerExecutionTime() override;
+        virtual void NotifyAvailabilityChange() override;
+        /// @brief Returns the number of times a member was done after its deadline.
+        ///
+        /// Thread-safe
+        int GetMissedDeadlinesCount();
+    protected:
+        virtual bool UpdateLoop(Loop*) override;
+        virtual void FinishSuspendedRun(int MemberIndex) override;
+        virtual void NotifyMemberInputAvailability() override;
+    private:
+        /// @brief A shared mutex for class members.
+        std::shared_mutex MembersSharedMutex;
+
+        std::vector<PriorityGroupMember> Members;
+        std::vector<std::shared_ptr<Group>> GroupMembers;
+        /// @brief The member indexes in the order they are dispatched in.
+        std::vector<int> DispatchOrder;
+
+        /// @brief The members that can run, modules until they start and groups until they're done.
+        IndexSet ReadySet;
+        /// @brief The members that have a RunCount more than 0.
+        IndexSet RunningSet;
+        IndexSet DoneSet;
+        /// @brief Atomic to check IsDone without locking.
+        std::atomic<int> RemainingMembersCount;
+        int RunningThreadsCount;
+        std::atomic<int> MissedDeadlinesCount;
+        /// @brief Incremented with both NextEventConditionMutex and MembersSharedMutex locked.
+        ///        Atomic to be read by the waiters' predicates without locking MembersSharedMutex.
+        std::atomic<int> NotifyingCounter;
+
+        /// @brief The run information of a member, indexed the same as Members.
+        class MemberRunInfo
+        {
+        public:
+            /// @brief The number of threads running the member.
+            int RunCount = 0;
+            /// @brief Only used for module members.
+            std::chrono::steady_clock::time_point StartTime;
+            double HigherPredictedTimeSpan = 0;
+            double LowerPredictedTimeSpan = 0;
+        };
+        std::vector<MemberRunInfo> RunInfos;
+
+        /// Is set to true on measurement start,
+        /// and set to false after the measurement.
+        /// Measurement starts on the first RunNext(...) call after StartNextIteration() is called.
+        bool MeasuringTimespan;
+        /// @brief The deadlines are relative to this.
+        std::chrono::steady_clock::time_point IterationStartTime;
+
+        std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor;
+        std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor;
+        /// @brief The predictors' predictions, published on each observation to be read without locking.
+        std::atomic<double> HigherPrediction;
+        std::atomic<double> LowerPrediction;
+        std::shared_ptr<SmartCVWaiter> CVWaiter;
+
+        /// Must be locked BEFORE MembersSharedMutex lock
+        /// when modifying members before NextEventConditionVariable.notify_all().
+        std::mutex NextEventConditionMutex;
+        std::condition_variable NextEventConditionVariable;
+        /// @brief Counts the threads waiting on NextEventConditionVariable to wake up only the needed ones.
+        TargetedNotifier Waiters;
+
+        /// @brief Unlocks the lock if the module runs.
+        inline bool RunModule(int Index, std::unique_lock<std::shared_mutex>&);
+        /// @brief Unlocks the lock.
+        inline bool RunGroup(int Index, std::unique_lock<std::shared_mutex>&, double MaxEstimatedExecutionTime);
+        /// @brief Releases a finished module run.
+        ///
+        /// LOCKS MUTEX
+        inline void FinishModuleRun(int Index);
+        /// @brief Marks the member as done.
+        ///
+        /// NO MUTEX LOCK
+        inline void MarkDone(int Index);
+        /// @brief Returns the time in seconds since the iteration's start.
+        ///
+        /// NO MUTEX LOCK
+        inline double GetIterationTime(std::chrono::steady_clock::time_point Now);
+        /// @brief Returns the time that can be spent on other members without risking the member's deadline,
+        ///        or infinity if the member has no deadline to protect (done, passed or no deadline),
+        ///        or doesn't need another thread (a running module or a done group).
+        ///
+        /// NO MUTEX LOCK
+        inline double GetSlack(int Index, double IterationTime);
+        /// @brief Returns the max estimated execution time limited by the slack,
+        ///        or a negative value if nothing can start within the slack.
+        static inline double LimitBySlack(double MaxEstimatedExecutionTime, double Slack);
+
+        /// @param HoldingTime Set to the time until a held back member might be released by a deadline passing,
+        ///                    or 0 if no member was held back.
+        ///
+        /// NO MUTEX LOCK
+        inline bool IsRunAvailableNoLock(double MaxEstimatedExecutionTime, double& HoldingTime);
+        /// LOCKS MUTEX
+        inline void WaitForAvailabilityCommon(double MaxEstimatedExecutionTime, double MaxWaitingTime);
+        /// NO SUBGROUP CALL
+        /// NO MUTEX LOCK
+        inline void StartNextIterationForThisGroup();
+        /// NO MUTEX LOCK
+        template <bool Higher>
+        inline double PredictRemainingExecutionTimeNoLock();
+    };
+}
@@ -0,0 +1,46 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+#include <memory>
+#include <variant>
+
+namespace LoopScheduler
+{
+    /// @brief Represents a group member of either another group or a module,
+    ///        with its priority and deadline. Used by PriorityGroup.
+    struct PriorityGroupMember final
+    {
+    public:
+        /// @param Priority Members with higher priorities are dispatched first.
+        /// @param Deadline The time in seconds from the iteration's start that the member should be done by.
+        ///                 0 Means no deadline.
+        PriorityGroupMember(
+            std::variant<std::shared_ptr<Group>, std::shared_ptr<Module>> Member,
+            int Priority = 0,
+            double Deadline = 0
+        );
+        std::variant<std::shared_ptr<Group>, std::shared_ptr<Module>> Member;
+        int Priority;
+        double Deadline;
+    };
+}
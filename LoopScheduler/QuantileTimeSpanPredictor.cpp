@@ -0,0 +1,104 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "QuantileTimeSpanPredictor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace LoopScheduler
+{
+    /// @brief The weight to normalize the weights at, to avoid an overflow.
+    constexpr double MAX_WEIGHT = 1e100;
+
+    inline double GetBucketLowerBound(int Index)
+    {
+        return QuantileTimeSpanPredictor::MIN_TIME_SPAN
+            * std::exp2((double)Index / QuantileTimeSpanPredictor::BUCKETS_PER_OCTAVE);
+    }
+
+    QuantileTimeSpanPredictor::QuantileTimeSpanPredictor(double Quantile, double DecayFactor, double InitialValue)
+        : Quantile(Quantile), DecayFactor(DecayFactor)
+    {
+        if (!(Quantile > 0 && Quantile <= 1))
+            throw std::logic_error("The quantile has to be in (0, 1].");
+        if (!(DecayFactor > 0 && DecayFactor <= 1))
+            throw std::logic_error("The decay factor has to be in (0, 1].");
+        Initialize(InitialValue);
+    }
+
+    void QuantileTimeSpanPredictor::Initialize(double TimeSpan)
+    {
+        Weights.fill(0);
+        TotalWeight = 0;
+        NextWeight = 1;
+        Prediction = TimeSpan;
+    }
+
+    void QuantileTimeSpanPredictor::ReportObservation(double TimeSpan)
+    {
+        int index = 0;
+        if (TimeSpan > MIN_TIME_SPAN)
+            index = std::min((int)(std::log2(TimeSpan / MIN_TIME_SPAN) * BUCKETS_PER_OCTAVE), BUCKETS_COUNT - 1);
+        Weights[index] += NextWeight;
+        TotalWeight += NextWeight;
+        NextWeight /= DecayFactor;
+        if (NextWeight > MAX_WEIGHT)
+        {
+            // Normalize
+            for (auto& w : Weights)
+                w /= NextWeight;
+            TotalWeight /= NextWeight;
+            NextWeight = 1;
+        }
+        UpdatePrediction();
+    }
+
+    double QuantileTimeSpanPredictor::Predict() const
+    {
+        return Prediction;
+    }
+
+    TimeSpanPredictor * QuantileTimeSpanPredictor::Copy()
+    {
+        return new QuantileTimeSpanPredictor(*this);
+    }
+
+    inline void QuantileTimeSpanPredictor::UpdatePrediction()
+    {
+        // The weight above the quantile is looked for from the end, the tail is shorter.
+        double remaining_weight = TotalWeight * (1 - Quantile);
+        for (int i = BUCKETS_COUNT - 1; i >= 0; i--)
+        {
+            if (Weights[i] == 0)
+                continue;
+            if (Weights[i] >= remaining_weight)
+            {
+                double lower_bound = GetBucketLowerBound(i);
+                double upper_bound = GetBucketLowerBound(i + 1);
+                // Interpolated assuming the weight is uniformly distributed in the bucket.
+                Prediction = upper_bound - (upper_bound - lower_bound) * (remaining_weight / Weights[i]);
+                return;
+            }
+            remaining_weight -= Weights[i];
+        }
+    }
+}
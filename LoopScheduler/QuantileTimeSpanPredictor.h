@@ -0,0 +1,78 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+#include "TimeSpanPredictor.h"
+
+#include <array>
+
+namespace LoopScheduler
+{
+    /// @brief A TimeSpanPredictor implementation that predicts a quantile (e.g. p90 or p99) of the timespans,
+    ///        using a histogram with logarithmic buckets.
+    ///
+    /// The old observations' weights decay exponentially, so they age out.
+    /// Unlike an average, a single spike doesn't inflate the prediction
+    /// unless the spikes are more frequent than the quantile allows.
+    /// The prediction is interpolated in a bucket, with a relative resolution of about 9%.
+    class QuantileTimeSpanPredictor final : public TimeSpanPredictor
+    {
+    public:
+        /// @param Quantile The quantile to predict, in (0, 1]. For example 0.9 for p90 or 0.99 for p99.
+        /// @param DecayFactor The factor that the weights of the past observations are multiplied by,
+        ///                    on each observation, in (0, 1]. 1 for no decay.
+        /// @param InitialValue The prediction before the first observation.
+        QuantileTimeSpanPredictor(
+            double Quantile = DEFAULT_QUANTILE,
+            double DecayFactor = DEFAULT_DECAY_FACTOR,
+            double InitialValue = 0
+        );
+        virtual void Initialize(double TimeSpan) override;
+        virtual void ReportObservation(double TimeSpan) override;
+        virtual double Predict() const override;
+        virtual TimeSpanPredictor * Copy() override;
+
+        static constexpr double DEFAULT_QUANTILE = 0.9;
+        /// @brief Makes the weight of an observation half after about 70 observations.
+        static constexpr double DEFAULT_DECAY_FACTOR = 0.99;
+
+        /// @brief The lower bound of the first bucket in seconds. Shorter timespans are counted in the first bucket.
+        static constexpr double MIN_TIME_SPAN = 0.0000001;
+        static constexpr int BUCKETS_PER_OCTAVE = 8;
+        /// @brief Covers the timespans up to about 107 seconds. Longer timespans are counted in the last bucket.
+        static constexpr int BUCKETS_COUNT = 30 * BUCKETS_PER_OCTAVE;
+    private:
+        double Quantile;
+        double DecayFactor;
+
+        /// @brief The weights are not decayed, instead, the new observations' weight grows by 1/DecayFactor.
+        ///        All are normalized when the weight grows too large.
+        std::array<double, BUCKETS_COUNT> Weights;
+        double TotalWeight;
+        double NextWeight;
+        /// @brief Updated on each observation, Predict is called more often.
+        double Prediction;
+
+        /// NO MUTEX LOCK
+        inline void UpdatePrediction();
+    };
+}
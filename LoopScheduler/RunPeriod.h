@@ -0,0 +1,50 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+namespace LoopScheduler
+{
+    /// @brief Specifies how often a group member runs, for the members that don't need to run on every iteration.
+    ///        Used by ParallelGroup and SequentialGroup.
+    ///
+    /// A member with a period is skipped on the iterations it's not due on, like it's done in them.
+    /// When both an iterations count and a time are specified, the member only runs when both are due.
+    struct RunPeriod final
+    {
+    public:
+        /// @brief Used as the phase to let the group choose it.
+        static constexpr int AUTO_PHASE = -1;
+
+        /// @param Iterations Runs on 1 of every Iterations iterations of the group. 1 means every iteration.
+        /// @param Time The wall-clock time between the runs in seconds, like 0.1 to run at 10 Hz.
+        ///             The member runs on the first iteration that starts after its time is due.
+        ///             0 means no time period.
+        /// @param Phase The iteration in [0, Iterations - 1] to run on, counting from the group's first iteration.
+        ///              AUTO_PHASE to let the group spread the members with the same period across the iterations,
+        ///              balanced by their predicted execution times.
+        ///              The time periods are always spread within their periods.
+        RunPeriod(int Iterations = 1, double Time = 0, int Phase = AUTO_PHASE);
+        int Iterations;
+        double Time;
+        int Phase;
+    };
+}
@@ -0,0 +1,169 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "RunPeriodTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace LoopScheduler
+{
+    RunPeriodTracker::RunPeriodTracker(int MembersCount)
+        : IterationIndex(-1), DueSet(MembersCount), HasAnyPeriod(false)
+    {
+        DueSet.Fill();
+    }
+
+    RunPeriodTracker::RunPeriodTracker(std::vector<RunPeriod> Periods, const std::vector<double>& PredictedTimes)
+        : Periods(std::move(Periods)), IterationIndex(-1), HasAnyPeriod(false)
+    {
+        int count = this->Periods.size();
+        DueSet.Resize(count);
+        DueSet.Fill();
+        Phases.resize(count, 0);
+        TimeOffsets.resize(count, 0);
+        NextRunTimes.resize(count);
+
+        int balancing_iterations = 1;
+        std::vector<int> auto_phase_members;
+        std::vector<int> time_period_members;
+        for (int i = 0; i < count; i++)
+        {
+            auto& period = this->Periods[i];
+            if (period.Iterations < 1)
+                throw std::logic_error("A run period's iterations count must be at least 1.");
+            if (!(period.Time >= 0))
+                throw std::logic_error("A run period's time cannot be negative.");
+            if (period.Phase != RunPeriod::AUTO_PHASE && (period.Phase < 0 || period.Phase >= period.Iterations))
+                throw std::logic_error("A run period's phase must be in range [0, Iterations - 1].");
+            if (period.Iterations > 1)
+            {
+                HasAnyPeriod = true;
+                if (period.Phase == RunPeriod::AUTO_PHASE)
+                    auto_phase_members.push_back(i);
+                else
+                    Phases[i] = period.Phase;
+                // The phases repeat every LCM of the periods, a longer cycle is balanced approximately.
+                std::int64_t lcm = std::lcm((std::int64_t)balancing_iterations, (std::int64_t)period.Iterations);
+                balancing_iterations = lcm <= MAX_BALANCING_ITERATIONS ?
+                                       (int)lcm : std::max(balancing_iterations, period.Iterations);
+            }
+            if (period.Time > 0)
+            {
+                HasAnyPeriod = true;
+                time_period_members.push_back(i);
+            }
+        }
+
+        const auto get_time = [&PredictedTimes](int i) {
+            // Members without predictions are still spread by their count.
+            return std::max(i < PredictedTimes.size() ? PredictedTimes[i] : 0.0, MNIMAL_TIME);
+        };
+        std::vector<double> loads(balancing_iterations, 0);
+        for (int i = 0; i < count; i++)
+            if (this->Periods[i].Iterations > 1 && this->Periods[i].Phase != RunPeriod::AUTO_PHASE)
+                for (int j = Phases[i]; j < balancing_iterations; j += this->Periods[i].Iterations)
+                    loads[j] += get_time(i);
+        std::stable_sort(auto_phase_members.begin(), auto_phase_members.end(), [&](int a, int b) {
+            return get_time(a) > get_time(b);
+        });
+        for (int i : auto_phase_members)
+        {
+            int iterations = this->Periods[i].Iterations;
+            int best_phase = 0;
+            double best_max_load = 0;
+            double best_total_load = 0;
+            for (int phase = 0; phase < iterations && phase < balancing_iterations; phase++)
+            {
+                double max_load = 0;
+                double total_load = 0;
+                for (int j = phase; j < balancing_iterations; j += iterations)
+                {
+                    max_load = std::max(max_load, loads[j]);
+                    total_load += loads[j];
+                }
+                if (phase == 0 || max_load < best_max_load || (max_load == best_max_load && total_load < best_total_load))
+                {
+                    best_phase = phase;
+                    best_max_load = max_load;
+                    best_total_load = total_load;
+                }
+            }
+            Phases[i] = best_phase;
+            for (int j = best_phase; j < balancing_iterations; j += iterations)
+                loads[j] += get_time(i);
+        }
+
+        for (int k = 0; k < time_period_members.size(); k++)
+        {
+            int i = time_period_members[k];
+            TimeOffsets[i] = this->Periods[i].Time * k / time_period_members.size();
+        }
+    }
+
+    void RunPeriodTracker::StartNextIteration()
+    {
+        IterationIndex++;
+        if (!HasAnyPeriod)
+            return;
+        auto now = std::chrono::steady_clock::now();
+        for (int i = 0; i < Periods.size(); i++)
+        {
+            auto& period = Periods[i];
+            bool is_due = period.Iterations == 1 || IterationIndex % period.Iterations == Phases[i];
+            if (period.Time > 0)
+            {
+                if (IterationIndex == 0)
+                    NextRunTimes[i] = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(TimeOffsets[i]));
+                is_due = is_due && now >= NextRunTimes[i];
+                if (is_due)
+                {
+                    // Skips to the next run time after now, to keep the phase without catching up on the missed runs.
+                    std::chrono::duration<double> passed_time = now - NextRunTimes[i];
+                    double periods_count = std::floor(passed_time.count() / period.Time) + 1;
+                    NextRunTimes[i] += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(periods_count * period.Time));
+                }
+            }
+            if (is_due)
+                DueSet.Add(i);
+            else
+                DueSet.Remove(i);
+        }
+    }
+
+    bool RunPeriodTracker::IsDue(int Index) const
+    {
+        return !HasAnyPeriod || DueSet.Contains(Index);
+    }
+
+    const IndexSet& RunPeriodTracker::GetDueSet() const
+    {
+        return DueSet;
+    }
+
+    bool RunPeriodTracker::HasPeriods() const
+    {
+        return HasAnyPeriod;
+    }
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "IndexSet.h"
+#include "RunPeriod.h"
+
+namespace LoopScheduler
+{
+    /// @brief Decides which members of a group are due to run on each iteration, using their RunPeriods.
+    ///
+    /// The automatic phases are chosen once on construction, each member with the period of N iterations
+    /// is put on the phase with the lowest predicted load of the members already placed, the longest members first.
+    /// The members with time periods get their first runs spread evenly within their periods,
+    /// and keep that phase after that, skipping the runs that are missed instead of running them later.
+    /// Used by groups, NOT thread-safe.
+    class RunPeriodTracker final
+    {
+    public:
+        /// @brief Creates a tracker that has every member due on every iteration.
+        RunPeriodTracker(int MembersCount = 0);
+        /// @param Periods The members' periods.
+        ///                Throws std::logic_error if a period or phase is out of range.
+        /// @param PredictedTimes The members' predicted execution times, used to balance the automatic phases.
+        RunPeriodTracker(std::vector<RunPeriod> Periods, const std::vector<double>& PredictedTimes);
+        /// @brief Decides the members that are due on the new iteration. Call once on each iteration's start.
+        void StartNextIteration();
+        /// @brief Returns whether the member is due on the current iteration.
+        bool IsDue(int Index) const;
+        /// @brief Returns the members that are due on the current iteration.
+        const IndexSet& GetDueSet() const;
+        /// @brief Returns whether any member can be skipped on some iterations.
+        bool HasPeriods() const;
+    private:
+        /// @brief The maximum number of iterations that the automatic phases are balanced over.
+        static constexpr int MAX_BALANCING_ITERATIONS = 1024;
+
+        std::vector<RunPeriod> Periods;
+        std::vector<int> Phases;
+        /// @brief The time offsets of the members' first runs within their time periods, in seconds.
+        std::vector<double> TimeOffsets;
+        std::vector<std::chrono::steady_clock::time_point> NextRunTimes;
+        std::int64_t IterationIndex;
+        IndexSet DueSet;
+        bool HasAnyPeriod;
+    };
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+#include "ChannelBase.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace LoopScheduler
+{
+    /// @brief A bounded lock-free channel with a single producer thread and a single consumer thread at a time,
+    ///        like a module that cannot run in parallel handing data to another one.
+    ///
+    /// The producer and the consumer only share the published counts, so each push or pop batch
+    /// costs one atomic store, and the other side's count is only reloaded when the cached one is not enough.
+    /// Can be a module's input channel (see Module::AddInputChannel).
+    ///
+    /// @tparam T The type of the items, has to be default constructible and move assignable.
+    template <typename T>
+    class SPSCChannel final : public ChannelBase
+    {
+    public:
+        /// @param Capacity The maximum number of the items, rounded up to a power of 2. Throws std::logic_error if 0.
+        SPSCChannel(std::size_t Capacity)
+        {
+            if (Capacity == 0)
+                throw std::logic_error("The channel's capacity must be at least 1.");
+            std::size_t size = 1;
+            while (size < Capacity)
+                size *= 2;
+            Items.resize(size);
+            Mask = size - 1;
+        }
+        /// @brief Thread-safe
+        std::size_t GetCapacity()
+        {
+            return Mask + 1;
+        }
+        /// @brief Used by the producer to push an item.
+        /// @return Whether it was pushed, false if the channel is full.
+        bool TryPush(T Item)
+        {
+            if (!HasRoom(1))
+                return false;
+            Items[WriteIndex & Mask] = std::move(Item);
+            PublishPushedCount(++WriteIndex);
+            return true;
+        }
+        /// @brief Used by the producer to push the items in [First, Last) until the channel is full,
+        ///        publishing them together.
+        /// @return The number of the pushed items, from First.
+        template <typename InputIterator>
+        std::size_t PushBatch(InputIterator First, InputIterator Last)
+        {
+            std::size_t count = 0;
+            for (; First != Last && HasRoom(count + 1); ++First, count++)
+                Items[(WriteIndex + count) & Mask] = *First;
+            if (count != 0)
+            {
+                WriteIndex += count;
+                PublishPushedCount(WriteIndex);
+            }
+            return count;
+        }
+        /// @brief Used by the consumer to pop an item.
+        /// @return Whether an item was popped, false if the channel is empty.
+        bool TryPop(T& Output)
+        {
+            if (!HasItems(1))
+                return false;
+            Output = std::move(Items[ReadIndex & Mask]);
+            PublishPoppedCount(++ReadIndex);
+            return true;
+        }
+        /// @brief Used by the consumer to pop up to MaxCount items to Output, publishing the pops together.
+        /// @return The number of the popped items.
+        template <typename OutputIterator>
+        std::size_t PopBatch(OutputIterator Output, std::size_t MaxCount)
+        {
+            std::size_t count = 0;
+            for (; count < MaxCount && HasItems(count + 1); count++)
+                *Output++ = std::move(Items[(ReadIndex + count) & Mask]);
+            if (count != 0)
+            {
+                ReadIndex += count;
+                PublishPoppedCount(ReadIndex);
+            }
+            return count;
+        }
+    private:
+        std::vector<T> Items;
+        std::size_t Mask;
+
+        /// @brief Only accessed by the producer.
+        alignas(64) std::uint64_t WriteIndex = 0;
+        /// @brief The consumer's ReadIndex last seen by the producer.
+        std::uint64_t CachedReadIndex = 0;
+        /// @brief Only accessed by the consumer.
+        alignas(64) std::uint64_t ReadIndex = 0;
+        /// @brief The producer's WriteIndex last seen by the consumer.
+        std::uint64_t CachedWriteIndex = 0;
+
+        /// @brief Used by the producer, whether Count more items fit after the unpublished ones.
+        bool HasRoom(std::size_t Count)
+        {
+            if (WriteIndex + Count - CachedReadIndex <= Items.size())
+                return true;
+            CachedReadIndex = GetPoppedCount();
+            return WriteIndex + Count - CachedReadIndex <= Items.size();
+        }
+        /// @brief Used by the consumer, whether Count items can be popped.
+        bool HasItems(std::size_t Count)
+        {
+            if (ReadIndex + Count <= CachedWriteIndex)
+                return true;
+            CachedWriteIndex = GetPushedCount();
+            return ReadIndex + Count <= CachedWriteIndex;
+        }
+    };
+}
@@ -0,0 +1,41 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+namespace LoopScheduler
+{
+    /// @brief An abstract class to rank the members of a group, to decide which ones run first.
+    ///
+    /// Used by groups that accept a policy to order the members that are ready to run,
+    /// members with higher priorities run first.
+    /// Should be thread-safe, a policy object can be shared between groups.
+    class SchedulingPolicy
+    {
+    public:
+        virtual ~SchedulingPolicy() = default;
+        /// @brief Returns the priority of a module member.
+        virtual double GetPriority(Module& Member) = 0;
+        /// @brief Returns the priority of a group member.
+        virtual double GetPriority(Group& Member) = 0;
+    };
+}
@@ -21,11 +21,15 @@
 #include "SequentialGroup.h"
 
 #include <algorithm>
+#include <stdexcept>
 #include <utility>
 
 #include "Module.h"
 #include "BiasedEMATimeSpanPredictor.h"
+#include "ExecutionStatistics.h"
+#include "Loop.h"
 #include "SmartCVWaiter.h"
+#include "Tracer.h"
 
 namespace LoopScheduler
 {
@@ -33,9 +37,26 @@ namespace LoopScheduler
             std::vector<SequentialGroupMember> Members,
             std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor,
             std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor,
-            std::shared_ptr<SmartCVWaiter> CVWaiter
-        ) : Members(Members), CurrentMemberIndex(-1), CurrentMemberRunsCount(0), RunningThreadsCount(0)
+            std::shared_ptr<SmartCVWaiter> CVWaiter,
+            std::vector<RunPeriod> RunPeriods,
+            int PipelineDepth
+        ) : Members(Members), PipelineDepth(PipelineDepth), OldestIteration(0), IterationsCount(1),
+            NotifyingCounter(0)
     {
+        if (RunPeriods.size() != 0 && RunPeriods.size() != Members.size())
+            throw std::logic_error("The run periods must be either empty or one for each member.");
+        if (PipelineDepth < 1)
+            throw std::logic_error("The pipeline depth must be at least 1.");
+        if (RunPeriods.size() == 0)
+            RunPeriods.resize(Members.size());
+        std::vector<double> predicted_times;
+        for (auto& member : Members)
+            predicted_times.push_back(std::visit([](auto& m) { return m->PredictHigherExecutionTime(); }, member));
+        this->RunPeriods = RunPeriodTracker(std::move(RunPeriods), predicted_times);
+        this->RunPeriods.StartNextIteration();
+        Iterations.resize(PipelineDepth);
+        Iterations[0].DueSet = this->RunPeriods.GetDueSet();
+
         std::vector<std::shared_ptr<Group>> member_groups;
         std::vector<std::shared_ptr<Module>> member_modules;
         for (auto& member : Members)
@@ -71,6 +92,8 @@ namespace LoopScheduler
 
         this->HigherExecutionTimePredictor = std::move(HigherExecutionTimePredictor);
         this->LowerExecutionTimePredictor = std::move(LowerExecutionTimePredictor);
+        HigherPrediction.store(this->HigherExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+        LowerPrediction.store(this->LowerExecutionTimePredictor->Predict(), std::memory_order_relaxed);
         this->CVWaiter = CVWaiter;
     }
 
@@ -78,14 +101,21 @@ namespace LoopScheduler
     {
     private:
         int& num;
+        bool is_dismissed = false;
     public:
         IncrementGuard(int& num) : num(num)
         {
             num++;
         }
+        /// @brief Keeps the number incremented, to be decremented later.
+        void Dismiss()
+        {
+            is_dismissed = true;
+        }
         ~IncrementGuard()
         {
-            num--;
+            if (!is_dismissed)
+                num--;
         }
     };
 
@@ -107,87 +137,269 @@ namespace LoopScheduler
         }
     };
 
+    /// Reports the time from construction to destruction as waiting time, if statistics is not nullptr.
+    class WaitingStatisticsGuard
+    {
+    private:
+        ExecutionStatistics * statistics;
+        std::chrono::steady_clock::time_point start;
+    public:
+        WaitingStatisticsGuard(ExecutionStatistics * statistics) : statistics(statistics)
+        {
+            if (statistics != nullptr)
+                start = std::chrono::steady_clock::now();
+        }
+        ~WaitingStatisticsGuard()
+        {
+            if (statistics != nullptr)
+            {
+                std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+                statistics->ReportWaiting(duration.count());
+            }
+        }
+    };
+
     bool SequentialGroup::RunNext(double MaxEstimatedExecutionTime)
     {
         std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        StartMeasuringLockHolding();
         std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex, std::defer_lock);
-        if (ShouldIncrementCurrentMemberIndex())
-        {
-            TimespanMeasurementStart();
-            CurrentMemberIndex++;
-            CurrentMemberRunsCount = 0;
-        }
-        if (ShouldRunNextModuleFromCurrentMemberIndex(MaxEstimatedExecutionTime))
+        bool has_moved = false;
+        // The older iterations first, to finish them sooner.
+        for (int position = 0; position < IterationsCount; position++)
         {
-            auto& member = std::get<std::shared_ptr<Module>>(Members[CurrentMemberIndex]);
-            auto token = member->GetRunningToken();
-            if (token.CanRun())
+            int iteration = GetIteration(position);
+            auto& state = Iterations[iteration];
+            if (ShouldIncrementCurrentMemberIndex(iteration))
             {
-                IncrementGuard increment_guard(RunningThreadsCount);
-                CurrentMemberRunsCount++;
-                LastModuleStartTime = std::chrono::steady_clock::now();
-                LastModuleHigherPredictedTimeSpan = member->PredictHigherExecutionTime();
-                LastModuleLowerPredictedTimeSpan = member->PredictLowerExecutionTime();
-                lock.unlock();
-                token.Run();
-                cv_lock.lock(); // Lock before MembersSharedMutex lock for modifications before notify_all()
-                lock.lock(); // Lock for both increment_guard and TimespanMeasurementStop()
+                TimespanMeasurementStart(iteration);
+                // The first iteration is started on construction, it belongs to the frame that the loop starts with.
+                if (state.FrameIndex == -1 && state.CurrentMemberIndex == -1)
+                    if (auto loop = GetLoop(); loop != nullptr)
+                        state.FrameIndex = loop->GetFrameIndexForCurrentThread();
+                int limit = GetStagesLimit(iteration);
+                // Skips the members that are not due, stopping at the last one or before the previous iteration's stage.
+                do
+                {
+                    state.CurrentMemberIndex++;
+                    // The member groups are shared by the iterations in progress, started when each iteration reaches them.
+                    if (PipelineDepth != 1 && std::holds_alternative<std::shared_ptr<Group>>(Members[state.CurrentMemberIndex]))
+                    {
+                        Loop::FrameScope frame_scope(state.FrameIndex);
+                        std::get<std::shared_ptr<Group>>(Members[state.CurrentMemberIndex])->StartNextIteration();
+                    }
+                }
+                while (!state.DueSet.Contains(state.CurrentMemberIndex) && state.CurrentMemberIndex < (int)Members.size() - 1
+                       && state.CurrentMemberIndex + 1 < limit);
+                state.CurrentMemberRunsCount = 0;
+                has_moved = PipelineDepth != 1;
+                if (!state.DueSet.Contains(state.CurrentMemberIndex)) // The last member is skipped => IsDone=true.
+                    TimespanMeasurementStop(iteration);
             }
-            else
+            if (ShouldRunNextModuleFromCurrentMemberIndex(iteration, MaxEstimatedExecutionTime))
             {
-                return false;
+                auto& member = std::get<std::shared_ptr<Module>>(Members[state.CurrentMemberIndex]);
+                auto token = member->GetRunningToken();
+                if (!token.CanRun())
+                    continue;
+                {
+                    IncrementGuard increment_guard(state.RunningThreadsCount);
+                    state.CurrentMemberRunsCount++;
+                    state.LastModuleStartTime = std::chrono::steady_clock::now();
+                    state.LastModuleHigherPredictedTimeSpan = member->PredictHigherExecutionTime();
+                    state.LastModuleLowerPredictedTimeSpan = member->PredictLowerExecutionTime();
+                    Loop::FrameScope frame_scope(state.FrameIndex);
+                    StopMeasuringLockHolding();
+                    lock.unlock();
+                    if (has_moved)
+                        NotifyStageChange();
+                    if (!token.Run(this, iteration))
+                    {
+                        increment_guard.Dismiss(); // Released by FinishSuspendedRun
+                        return true;
+                    }
+                    cv_lock.lock(); // Lock before MembersSharedMutex lock for modifications before notify_all()
+                    lock.lock(); // Lock for both increment_guard and TimespanMeasurementStop()
+                }
+                TimespanMeasurementStop(iteration);
+                int wake_ups_count = GetWakeUpsCountAfterRun(iteration);
+                lock.unlock(); // Unlock after both increment_guard and TimespanMeasurementStop()
+                cv_lock.unlock(); // Unlock after MembersSharedMutex unlock after modifications before notify_all()
+                TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
+                return true;
             }
-            TimespanMeasurementStop();
-            lock.unlock(); // Unlock after both increment_guard and TimespanMeasurementStop()
-            cv_lock.unlock(); // Unlock after MembersSharedMutex unlock after modifications before notify_all()
-            NextEventConditionVariable.notify_all();
-            return true;
-        }
-        else if (double max_time; ShouldTryRunNextGroupFromCurrentMemberIndex(MaxEstimatedExecutionTime, max_time))
-        {
-            bool success = false;
+            else if (double max_time; ShouldTryRunNextGroupFromCurrentMemberIndex(iteration, MaxEstimatedExecutionTime, max_time))
             {
-                IncrementGuard increment_guard(RunningThreadsCount);
-                CurrentMemberRunsCount++;
-                auto& member = std::get<std::shared_ptr<Group>>(Members[CurrentMemberIndex]);
-                lock.unlock();
+                auto& member = std::get<std::shared_ptr<Group>>(Members[state.CurrentMemberIndex]);
+                // The newer iterations may have something to run instead.
+                if (position != IterationsCount - 1 && !member->IsRunAvailable(max_time))
+                    continue;
+                bool success = false;
+                {
+                    IncrementGuard increment_guard(state.RunningThreadsCount);
+                    state.CurrentMemberRunsCount++;
+                    Loop::FrameScope frame_scope(state.FrameIndex);
+                    StopMeasuringLockHolding();
+                    lock.unlock();
+                    if (has_moved)
+                        NotifyStageChange();
 
-                success = member->RunNext(max_time);
+                    {
+#if LOOPSCHEDULER_ENABLE_TRACING
+                        Tracer::Scope trace_scope("SequentialGroup::RunGroup", "run", member.get());
+#endif
+                        success = member->RunNext(max_time);
+#if LOOPSCHEDULER_ENABLE_TRACING
+                        if (!success)
+                            trace_scope.Discard();
+#endif
+                    }
 
-                cv_lock.lock(); // Lock before MembersSharedMutex lock for modifications before notify_all()
-                lock.lock(); // Lock for both increment_guard and TimespanMeasurementStop()
+                    cv_lock.lock(); // Lock before MembersSharedMutex lock for modifications before notify_all()
+                    lock.lock(); // Lock for both increment_guard and TimespanMeasurementStop()
+                }
+                TimespanMeasurementStop(iteration);
+                int wake_ups_count = GetWakeUpsCountAfterRun(iteration);
+                lock.unlock(); // Unlock after both increment_guard and TimespanMeasurementStop()
+                cv_lock.unlock(); // Unlock after MembersSharedMutex unlock after modifications before notify_all()
+                TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
+                return success;
             }
-            TimespanMeasurementStop();
-            lock.unlock(); // Unlock after both increment_guard and TimespanMeasurementStop()
-            cv_lock.unlock(); // Unlock after MembersSharedMutex unlock after modifications before notify_all()
-            NextEventConditionVariable.notify_all();
-            return success;
         }
+        StopMeasuringLockHolding();
+        // Only the unfinished member groups may have something left to run.
+        bool is_own_finished = IsIterationDoneNoLock(GetIteration(IterationsCount - 1));
+        lock.unlock();
+        if (has_moved)
+            NotifyStageChange();
+        if (is_own_finished)
+            return RunUnfinishedMemberGroup(MaxEstimatedExecutionTime);
         return false;
     }
 
-    inline void SequentialGroup::TimespanMeasurementStart()
+    void SequentialGroup::FinishSuspendedRun(int Iteration)
+    {
+        // Lock before MembersSharedMutex lock for modifications before notify_all()
+        std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+        std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
+        // The iteration can't move to another stage while it's running.
+        Iterations[Iteration].RunningThreadsCount--;
+        TimespanMeasurementStop(Iteration);
+        int wake_ups_count = GetWakeUpsCountAfterRun(Iteration);
+        lock.unlock();
+        cv_lock.unlock();
+        TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
+    }
+
+    inline int SequentialGroup::GetIteration(int Position)
+    {
+        // NO MUTEX LOCK
+        return (OldestIteration + Position) % PipelineDepth;
+    }
+
+    inline bool SequentialGroup::IsIterationDoneNoLock(int Iteration)
+    {
+        // NO MUTEX LOCK
+        auto& state = Iterations[Iteration];
+        return (state.CurrentMemberIndex == (int)Members.size() - 1)
+               && (state.RunningThreadsCount == 0)
+               && (
+                    state.CurrentMemberIndex == -1
+                    || !state.DueSet.Contains(state.CurrentMemberIndex)
+                    || (std::holds_alternative<std::shared_ptr<Module>>(Members[state.CurrentMemberIndex]) ?
+                        (state.CurrentMemberRunsCount != 0)
+                        : (IsStageReachedByNextIteration(Iteration)
+                           || std::get<std::shared_ptr<Group>>(Members[state.CurrentMemberIndex])->IsDone()))
+                );
+    }
+    inline bool SequentialGroup::IsStageReachedByNextIteration(int Iteration)
+    {
+        // NO MUTEX LOCK
+        int position = (Iteration + PipelineDepth - OldestIteration) % PipelineDepth;
+        if (position >= IterationsCount - 1)
+            return false;
+        // The next iteration only reaches the stage after this iteration is done with it.
+        return Iterations[GetIteration(position + 1)].CurrentMemberIndex >= Iterations[Iteration].CurrentMemberIndex;
+    }
+
+    inline bool SequentialGroup::IsDoneNoLock()
+    {
+        // NO MUTEX LOCK
+        int newest = GetIteration(IterationsCount - 1);
+        if (IsIterationDoneNoLock(newest))
+            return true;
+        if (PipelineDepth == 1 || Iterations[newest].CurrentMemberIndex <= 0)
+            return false;
+        // The newest iteration has moved past the first stage, the next one can start if there's room for it.
+        // The iterations are done in order.
+        int in_progress_count = IterationsCount;
+        for (int position = 0; position < IterationsCount - 1 && IsIterationDoneNoLock(GetIteration(position)); position++)
+            in_progress_count--;
+        return in_progress_count < PipelineDepth;
+    }
+
+    inline bool SequentialGroup::IsFinishedNoLock()
+    {
+        // NO MUTEX LOCK
+        // The iterations are done in order.
+        return IsIterationDoneNoLock(GetIteration(IterationsCount - 1)) && AreMemberGroupsFinished();
+    }
+
+    inline int SequentialGroup::GetStagesLimit(int Iteration)
+    {
+        // NO MUTEX LOCK
+        if (Iteration == OldestIteration)
+            return Members.size();
+        int previous = (Iteration + PipelineDepth - 1) % PipelineDepth;
+        return IsIterationDoneNoLock(previous) ? Members.size() : Iterations[previous].CurrentMemberIndex;
+    }
+
+    inline int SequentialGroup::GetWakeUpsCountAfterRun(int Iteration)
+    {
+        // NO MUTEX LOCK
+        auto& state = Iterations[Iteration];
+        // When pipelining, the other iterations may be able to move too.
+        if (PipelineDepth != 1)
+            return Waiters.GetWakeUpsCount(TargetedNotifier::ALL, IsDoneNoLock(), false);
+        int next_index = ShouldIncrementCurrentMemberIndex(Iteration) ? state.CurrentMemberIndex + 1 : state.CurrentMemberIndex;
+        // Only 1 thread can run the next member if it's a module,
+        // the number of the runs available in a group is unknown.
+        int runs_count = (next_index >= 0 && next_index < Members.size()
+                          && std::holds_alternative<std::shared_ptr<Module>>(Members[next_index])) ?
+                         1 : TargetedNotifier::ALL;
+        // The waiters don't return early when nothing is running, the woken ones can continue the sequence.
+        return Waiters.GetWakeUpsCount(runs_count, state.CurrentMemberIndex == (int)Members.size() - 1, false);
+    }
+
+    inline void SequentialGroup::NotifyStageChange()
+    {
+        // Locked after the modifications, the waiters that missed them are already waiting.
+        std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+        int wake_ups_count = Waiters.GetWakeUpsCount(TargetedNotifier::ALL, false, false);
+        cv_lock.unlock();
+        TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
+    }
+
+    inline void SequentialGroup::TimespanMeasurementStart(int Iteration)
     {
-        if (CurrentMemberIndex == -1)
+        if (Iterations[Iteration].CurrentMemberIndex == -1)
         {
-            IterationStartTime = std::chrono::steady_clock::now();
+            Iterations[Iteration].StartTime = std::chrono::steady_clock::now();
         }
     }
-    inline void SequentialGroup::TimespanMeasurementStop()
+    inline void SequentialGroup::TimespanMeasurementStop(int Iteration)
     {
-        if ((CurrentMemberIndex == (int)Members.size() - 1)
-            && (RunningThreadsCount == 0) // Called after increment_guard is destructed => already decremented
-            && (
-                CurrentMemberIndex == -1
-                || (std::holds_alternative<std::shared_ptr<Module>>(Members[CurrentMemberIndex]) ?
-                    (CurrentMemberRunsCount != 0)
-                    : (std::get<std::shared_ptr<Group>>(Members[CurrentMemberIndex])->IsDone()))
-            )) // IsDone
+        // Called after increment_guard is destructed => RunningThreadsCount is already decremented
+        if (IsIterationDoneNoLock(Iteration))
         {
-            std::chrono::duration<double> duration = std::chrono::steady_clock::now() - IterationStartTime;
+            std::chrono::duration<double> duration = std::chrono::steady_clock::now() - Iterations[Iteration].StartTime;
             double time = duration.count();
             HigherExecutionTimePredictor->ReportObservation(time);
             LowerExecutionTimePredictor->ReportObservation(time);
+            HigherPrediction.store(HigherExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+            LowerPrediction.store(LowerExecutionTimePredictor->Predict(), std::memory_order_relaxed);
+            if (auto statistics = GetStatistics())
+                statistics->ReportRun(time);
         }
     }
 
@@ -199,41 +411,39 @@ namespace LoopScheduler
     bool SequentialGroup::IsAvailable(double MaxEstimatedExecutionTime)
     {
         std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
-        if (IsRunAvailableNoLock(MaxEstimatedExecutionTime))
-        {
-            return true;
-        }
-        if ((CurrentMemberIndex == (int)Members.size() - 1)
-            && (RunningThreadsCount == 0)) // (And no next module to run) => IsDone=true.
-        {
-            return true;
-        }
-        return false;
+        return IsRunAvailableNoLock(MaxEstimatedExecutionTime) || IsDoneNoLock();
     }
     inline bool SequentialGroup::IsRunAvailableNoLock(double MaxEstimatedExecutionTime)
     {
-        if (ShouldIncrementCurrentMemberIndex()
-            || ShouldRunNextModuleFromCurrentMemberIndex(MaxEstimatedExecutionTime))
+        for (int position = 0; position < IterationsCount; position++)
         {
-            return true;
-        }
-        if (double max_exec_time; ShouldTryRunNextGroupFromCurrentMemberIndex(MaxEstimatedExecutionTime, max_exec_time))
-        {
-            auto& member = std::get<std::shared_ptr<Group>>(Members[CurrentMemberIndex]);
-            return member->IsRunAvailable(max_exec_time);
+            int iteration = GetIteration(position);
+            if (ShouldIncrementCurrentMemberIndex(iteration)
+                || ShouldRunNextModuleFromCurrentMemberIndex(iteration, MaxEstimatedExecutionTime))
+            {
+                return true;
+            }
+            if (double max_exec_time; ShouldTryRunNextGroupFromCurrentMemberIndex(iteration, MaxEstimatedExecutionTime, max_exec_time))
+            {
+                auto& member = std::get<std::shared_ptr<Group>>(Members[Iterations[iteration].CurrentMemberIndex]);
+                if (member->IsRunAvailable(max_exec_time))
+                    return true;
+            }
         }
-        return false;
+        return IsIterationDoneNoLock(GetIteration(IterationsCount - 1))
+            && IsUnfinishedMemberGroupRunAvailable(MaxEstimatedExecutionTime);
     }
 
     void SequentialGroup::WaitForRunAvailability(double MaxEstimatedExecutionTime, double MaxWaitingTime)
     {
-        // Same because there's nothing left to do when IsDone=true.
-        WaitForAvailabilityCommon(MaxEstimatedExecutionTime, MaxWaitingTime);
+        // Only different when pipelining, there's nothing left to do when IsDone=true otherwise.
+        WaitForAvailabilityCommon<true>(MaxEstimatedExecutionTime, MaxWaitingTime);
     }
     void SequentialGroup::WaitForAvailability(double MaxEstimatedExecutionTime, double MaxWaitingTime)
     {
-        WaitForAvailabilityCommon(MaxEstimatedExecutionTime, MaxWaitingTime);
+        WaitForAvailabilityCommon<false>(MaxEstimatedExecutionTime, MaxWaitingTime);
     }
+    template <bool RunAvailability>
     inline void SequentialGroup::WaitForAvailabilityCommon(double MaxEstimatedExecutionTime, double MaxWaitingTime)
     {
         std::chrono::time_point<std::chrono::steady_clock> start;
@@ -243,38 +453,58 @@ namespace LoopScheduler
         bool wait_for_next_module = false;
         bool wait_for_next_group = false;
         double max_exec_time;
+        // The member to wait for, of the oldest iteration that has one.
+        int member_index = -1;
+
+        // Returns true when there's no need to wait on NextEventConditionVariable. NO MUTEX LOCK
+        const auto is_ready = [this, &MaxEstimatedExecutionTime, &wait_for_next_module, &wait_for_next_group, &max_exec_time,
+                               &member_index] {
+            for (int position = 0; position < IterationsCount; position++)
+                if (ShouldIncrementCurrentMemberIndex(GetIteration(position)))
+                    return true;
+            for (int position = 0; position < IterationsCount; position++)
+            {
+                int iteration = GetIteration(position);
+                if (ShouldRunNextModuleFromCurrentMemberIndex(iteration, MaxEstimatedExecutionTime)) // There is a next module to run.
+                {
+                    wait_for_next_module = true; // Wait outside condition_variable::wait
+                    member_index = Iterations[iteration].CurrentMemberIndex;
+                    return true;
+                }
+                if (ShouldTryRunNextGroupFromCurrentMemberIndex(iteration, MaxEstimatedExecutionTime, max_exec_time)) // Can wait for the group.
+                {
+                    wait_for_next_group = true; // Wait outside condition_variable::wait
+                    member_index = Iterations[iteration].CurrentMemberIndex;
+                    return true;
+                }
+            }
+            if constexpr (RunAvailability)
+                return IsIterationDoneNoLock(GetIteration(IterationsCount - 1)); // Nothing left to run in the iterations.
+            else
+                return IsDoneNoLock();
+        };
 
         std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
-        if (ShouldIncrementCurrentMemberIndex())
-            return;
-        if (ShouldRunNextModuleFromCurrentMemberIndex(MaxEstimatedExecutionTime)) // There is a next module to run.
-            wait_for_next_module = true; // Wait outside condition_variable::wait later
-        if (ShouldTryRunNextGroupFromCurrentMemberIndex(MaxEstimatedExecutionTime, max_exec_time)) // Can wait for the group.
-            wait_for_next_group = true; // Wait outside condition_variable::wait later
-        if ((CurrentMemberIndex == (int)Members.size() - 1)
-                && (RunningThreadsCount == 0)) // (And no next module to run) => IsDone=true.
+        int start_notifying_counter = NotifyingCounter;
+        if (is_ready() && !wait_for_next_module && !wait_for_next_group)
         {
+            if constexpr (RunAvailability)
+            {
+                // Except in the unfinished member groups.
+                lock.unlock();
+                WaitForUnfinishedMemberGroup(MaxEstimatedExecutionTime, MaxWaitingTime);
+            }
             return;
         }
 
-        const auto predicate = [this, &lock, &MaxEstimatedExecutionTime, &wait_for_next_module, &wait_for_next_group, &max_exec_time] {
+        const auto predicate = [this, &lock, &is_ready, start_notifying_counter] {
             lock.lock(); // NextEventConditionMutex already locked before this MembersSharedMutex lock
-            if (ShouldIncrementCurrentMemberIndex())
-            {
-                return true;
-            }
-            if (ShouldRunNextModuleFromCurrentMemberIndex(MaxEstimatedExecutionTime)) // There is a next module to run.
-            {
-                wait_for_next_module = true; // Wait outside condition_variable::wait
-                return true;
-            }
-            if (ShouldTryRunNextGroupFromCurrentMemberIndex(MaxEstimatedExecutionTime, max_exec_time)) // Can wait for the group.
+            if (start_notifying_counter != NotifyingCounter.load(std::memory_order_relaxed) // NotifyAvailabilityChange
+                || Loop::HasQueuedRunsForParkedWorker())
             {
-                wait_for_next_group = true; // Wait outside condition_variable::wait
                 return true;
             }
-            if ((CurrentMemberIndex == (int)Members.size() - 1)
-                && (RunningThreadsCount == 0)) // (And no next module to run) => IsDone=true.
+            if (is_ready())
             {
                 return true;
             }
@@ -282,13 +512,22 @@ namespace LoopScheduler
             return false;
         }; // Locked when predicated returns true, should be unlocked at entry
 
+        WaitingStatisticsGuard waiting_statistics_guard(GetStatistics());
+
         if (!wait_for_next_module && !wait_for_next_group)
         {
             lock.unlock(); // Locked after wait/wait_for
+            LOOPSCHEDULER_TRACE_SCOPE("SequentialGroup::Wait", "wait", this);
             std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+            TargetedNotifier::WaitingGuard waiting_guard(
+                    Waiters, MaxEstimatedExecutionTime != 0 || Loop::IsCurrentThreadConstrained(), true);
             if (MaxWaitingTime == 0)
             {
+#if LOOPSCHEDULER_USE_SMART_CV_WAITER
+                CVWaiter->Wait(NextEventConditionVariable, cv_lock, predicate);
+#else
                 NextEventConditionVariable.wait(cv_lock, predicate);
+#endif
             }
             else if (MaxWaitingTime > 0)
             {
@@ -304,7 +543,7 @@ namespace LoopScheduler
 
         if (wait_for_next_module)
         {
-            auto& member = std::get<std::shared_ptr<Module>>(Members[CurrentMemberIndex]);
+            auto& member = std::get<std::shared_ptr<Module>>(Members[member_index]);
             if (member->IsAvailable())
                 return;
             lock.unlock();
@@ -324,7 +563,7 @@ namespace LoopScheduler
         }
         if (wait_for_next_group)
         {
-            auto& member = std::get<std::shared_ptr<Group>>(Members[CurrentMemberIndex]);
+            auto& member = std::get<std::shared_ptr<Group>>(Members[member_index]);
             if (member->IsAvailable(max_exec_time))
                 return;
             lock.unlock();
@@ -345,22 +584,38 @@ namespace LoopScheduler
     bool SequentialGroup::IsDone()
     {
         std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
-        return (CurrentMemberIndex == (int)Members.size() - 1)
-               && (RunningThreadsCount == 0)
-               && (
-                    CurrentMemberIndex == -1
-                    || (std::holds_alternative<std::shared_ptr<Module>>(Members[CurrentMemberIndex]) ?
-                        (CurrentMemberRunsCount != 0)
-                        : (std::get<std::shared_ptr<Group>>(Members[CurrentMemberIndex])->IsDone()))
-                );
+        return IsDoneNoLock();
+    }
+
+    bool SequentialGroup::IsFinished()
+    {
+        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
+        return IsFinishedNoLock();
     }
 
     void SequentialGroup::StartNextIteration()
     {
+        auto loop = GetLoop();
+        std::int64_t frame_index = loop == nullptr ? -1 : loop->GetFrameIndexForCurrentThread();
         std::unique_lock<std::shared_mutex> lock(MembersSharedMutex);
-        CurrentMemberIndex = -1;
-        for (auto& group_member : GroupMembers)
-            group_member->StartNextIteration();
+        // Removes the done iterations, and the oldest one if there's no room (the group isn't done),
+        // in which case the new iteration takes its place.
+        while (IterationsCount != 0
+               && (IterationsCount == PipelineDepth || IsIterationDoneNoLock(OldestIteration)))
+        {
+            OldestIteration = (OldestIteration + 1) % PipelineDepth;
+            IterationsCount--;
+        }
+        auto& state = Iterations[GetIteration(IterationsCount)];
+        IterationsCount++;
+        state.CurrentMemberIndex = -1;
+        RunPeriods.StartNextIteration();
+        state.DueSet = RunPeriods.GetDueSet();
+        state.FrameIndex = frame_index;
+        // When pipelining, the member groups are started when the iteration reaches them.
+        if (PipelineDepth == 1)
+            for (auto& group_member : GroupMembers)
+                group_member->StartNextIteration();
     }
 
     double SequentialGroup::PredictHigherRemainingExecutionTime()
@@ -377,13 +632,33 @@ namespace LoopScheduler
 
     double SequentialGroup::PredictHigherExecutionTime()
     {
-        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
-        return HigherExecutionTimePredictor->Predict();
+        return HigherPrediction.load(std::memory_order_relaxed);
     }
     double SequentialGroup::PredictLowerExecutionTime()
     {
-        std::shared_lock<std::shared_mutex> lock(MembersSharedMutex);
-        return LowerExecutionTimePredictor->Predict();
+        return LowerPrediction.load(std::memory_order_relaxed);
+    }
+
+    void SequentialGroup::NotifyAvailabilityChange()
+    {
+        {
+            std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+            NotifyingCounter++;
+        }
+        NextEventConditionVariable.notify_all();
+        Group::NotifyAvailabilityChange();
+    }
+
+    void SequentialGroup::NotifyMemberInputAvailability()
+    {
+        int wake_ups_count;
+        {
+            std::unique_lock<std::mutex> cv_lock(NextEventConditionMutex);
+            NotifyingCounter++;
+            // 1 run of the module became available.
+            wake_ups_count = Waiters.GetWakeUpsCount(1, false, false);
+        }
+        TargetedNotifier::Notify(NextEventConditionVariable, wake_ups_count);
     }
 
     bool SequentialGroup::UpdateLoop(Loop * LoopPtr)
@@ -405,31 +680,39 @@ namespace LoopScheduler
         return true;
     }
 
-    inline bool SequentialGroup::ShouldRunNextModuleFromCurrentMemberIndex(double MaxEstimatedExecutionTime)
+    inline bool SequentialGroup::ShouldRunNextModuleFromCurrentMemberIndex(int Iteration, double MaxEstimatedExecutionTime)
     {
         // NO MUTEX LOCK
-        return RunningThreadsCount == 0 && CurrentMemberRunsCount == 0
-            && CurrentMemberIndex != -1
-            && std::holds_alternative<std::shared_ptr<Module>>(Members[CurrentMemberIndex])
+        auto& state = Iterations[Iteration];
+        return state.RunningThreadsCount == 0 && state.CurrentMemberRunsCount == 0
+            && state.CurrentMemberIndex != -1
+            && state.DueSet.Contains(state.CurrentMemberIndex)
+            && std::holds_alternative<std::shared_ptr<Module>>(Members[state.CurrentMemberIndex])
+            && std::get<std::shared_ptr<Module>>(Members[state.CurrentMemberIndex])->CanRunInCurrentThread()
             && (MaxEstimatedExecutionTime == 0
-                || std::get<std::shared_ptr<Module>>(Members[CurrentMemberIndex])->PredictHigherExecutionTime()
+                || std::get<std::shared_ptr<Module>>(Members[state.CurrentMemberIndex])->PredictHigherExecutionTime()
                     <= MaxEstimatedExecutionTime);
     }
     inline bool SequentialGroup::ShouldTryRunNextGroupFromCurrentMemberIndex(
+            int Iteration,
             double InputMaxEstimatedExecutionTime,
             double& OutputMaxEstimatedExecutionTime)
     {
         // NO MUTEX LOCK
-        if (CurrentMemberIndex != -1 && std::holds_alternative<std::shared_ptr<Group>>(Members[CurrentMemberIndex]))
+        auto& state = Iterations[Iteration];
+        if (state.CurrentMemberIndex != -1 && state.DueSet.Contains(state.CurrentMemberIndex)
+            && std::holds_alternative<std::shared_ptr<Group>>(Members[state.CurrentMemberIndex])
+            && !IsStageReachedByNextIteration(Iteration)) // Else the group is running the next iteration's stage
         {
-            if (std::get<std::shared_ptr<Group>>(Members[CurrentMemberIndex])->IsDone())
+            if (std::get<std::shared_ptr<Group>>(Members[state.CurrentMemberIndex])->IsDone())
             {
-                if (RunningThreadsCount != 0) // Else: either ShouldIncrement... or IsDone
+                if (state.RunningThreadsCount != 0) // Else: either ShouldIncrement..., waiting for the previous iteration, or IsDone
                 {
                     if (InputMaxEstimatedExecutionTime == 0)
-                        OutputMaxEstimatedExecutionTime = PredictRemainingExecutionTimeNoLock<false>();
+                        OutputMaxEstimatedExecutionTime = PredictRemainingExecutionTimeNoLock<false>(Iteration);
                     else
-                        OutputMaxEstimatedExecutionTime = std::min(InputMaxEstimatedExecutionTime, PredictRemainingExecutionTimeNoLock<false>());
+                        OutputMaxEstimatedExecutionTime = std::min(
+                            InputMaxEstimatedExecutionTime, PredictRemainingExecutionTimeNoLock<false>(Iteration));
                     // Return false when there's no time left
                     // to prevent RunningThreadsCount to increase pointlessly and block the loop.
                     return OutputMaxEstimatedExecutionTime > MNIMAL_TIME;
@@ -443,35 +726,39 @@ namespace LoopScheduler
         }
         return false;
     }
-    inline bool SequentialGroup::ShouldIncrementCurrentMemberIndex()
+    inline bool SequentialGroup::ShouldIncrementCurrentMemberIndex(int Iteration)
     {
         // NO MUTEX LOCK
-        return (RunningThreadsCount == 0)
-            && (CurrentMemberIndex < (int)Members.size() - 1)
+        auto& state = Iterations[Iteration];
+        return (state.RunningThreadsCount == 0)
+            && (state.CurrentMemberIndex < (int)Members.size() - 1)
             && (
-                CurrentMemberIndex == -1
-                || (std::holds_alternative<std::shared_ptr<Module>>(Members[CurrentMemberIndex]) ?
-                    (CurrentMemberRunsCount != 0)
-                    : (std::get<std::shared_ptr<Group>>(Members[CurrentMemberIndex])->IsDone()))
-            );
+                state.CurrentMemberIndex == -1
+                || !state.DueSet.Contains(state.CurrentMemberIndex)
+                || (std::holds_alternative<std::shared_ptr<Module>>(Members[state.CurrentMemberIndex]) ?
+                    (state.CurrentMemberRunsCount != 0)
+                    : (std::get<std::shared_ptr<Group>>(Members[state.CurrentMemberIndex])->IsDone()))
+            )
+            && (PipelineDepth == 1 || state.CurrentMemberIndex + 1 < GetStagesLimit(Iteration));
     }
     template <bool Higher>
-    inline double SequentialGroup::PredictRemainingExecutionTimeNoLock()
+    inline double SequentialGroup::PredictRemainingExecutionTimeNoLock(int Iteration)
     {
         // NO MUTEX LOCK
-        if (RunningThreadsCount == 0) // else CurrentMemberIndex shouldn't be -1
+        auto& state = Iterations[Iteration];
+        if (state.RunningThreadsCount == 0) // else CurrentMemberIndex shouldn't be -1
             return 0;
-        if (std::holds_alternative<std::shared_ptr<Module>>(Members[CurrentMemberIndex]))
+        if (std::holds_alternative<std::shared_ptr<Module>>(Members[state.CurrentMemberIndex]))
         {
-            std::chrono::duration<double> duration = std::chrono::steady_clock::now() - LastModuleStartTime;
+            std::chrono::duration<double> duration = std::chrono::steady_clock::now() - state.LastModuleStartTime;
             if constexpr (Higher)
                 return std::max(
-                    LastModuleHigherPredictedTimeSpan - duration.count(),
+                    state.LastModuleHigherPredictedTimeSpan - duration.count(),
                     MNIMAL_TIME
                 );
             else
                 return std::max(
-                    LastModuleLowerPredictedTimeSpan - duration.count(),
+                    state.LastModuleLowerPredictedTimeSpan - duration.count(),
                     MNIMAL_TIME
                 );
             
@@ -481,14 +768,23 @@ namespace LoopScheduler
             // Double mutex lock can occur if there's a group loop.
             if constexpr (Higher)
                 return std::max(
-                    std::get<std::shared_ptr<Group>>(Members[CurrentMemberIndex])->PredictHigherRemainingExecutionTime(),
+                    std::get<std::shared_ptr<Group>>(Members[state.CurrentMemberIndex])->PredictHigherRemainingExecutionTime(),
                     MNIMAL_TIME
                 );
             else
                 return std::max(
-                    std::get<std::shared_ptr<Group>>(Members[CurrentMemberIndex])->PredictLowerRemainingExecutionTime(),
+                    std::get<std::shared_ptr<Group>>(Members[state.CurrentMemberIndex])->PredictLowerRemainingExecutionTime(),
                     MNIMAL_TIME
                 );
         }
     }
+    template <bool Higher>
+    inline double SequentialGroup::PredictRemainingExecutionTimeNoLock()
+    {
+        // NO MUTEX LOCK
+        double result = 0;
+        for (int position = 0; position < IterationsCount; position++)
+            result = std::max(result, PredictRemainingExecutionTimeNoLock<Higher>(GetIteration(position)));
+        return result;
+    }
 }
@@ -23,13 +23,19 @@
 #include "LoopScheduler.dec.h"
 #include "ModuleHoldingGroup.h"
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <mutex>
 #include <shared_mutex>
 #include <variant>
 #include <vector>
 
+#include "IndexSet.h"
+#include "RunPeriodTracker.h"
+#include "TargetedNotifier.h"
+
 namespace LoopScheduler
 {
     /// @brief Represents a group member of either another group or a module.
@@ -41,6 +47,14 @@ namespace LoopScheduler
     /// When a stage is done, the next stage starts ignoring whether the next stage's module can run.
     /// The module or subgroup of a stage won't run in parallel with other stages.
     /// A stage is defined as a member of a vector using the constructor.
+    /// A stage with a RunPeriod is skipped on the iterations it's not due on.
+    ///
+    /// With a PipelineDepth greater than 1, up to that many iterations are in progress at the same time,
+    /// e.g. the simulation stage of an iteration runs while the rendering stage of the previous one is running.
+    /// The stage k of an iteration starts once the stage k of the previous iteration is done
+    /// and its stage k + 1 has started, so each stage still runs its iterations in order and without overlapping.
+    /// IsDone returns true when the next iteration can start, which is when the newest iteration has moved past
+    /// its first stage and fewer iterations than the depth are in progress. IsFinished returns true when all of them are done and the member groups are finished.
     class SequentialGroup : public ModuleHoldingGroup
     {
     public:
@@ -49,11 +63,19 @@ namespace LoopScheduler
         /// @param LowerExecutionTimePredictor Predictor to predict the lower execution time of the whole group.
         ///                                    nullptr to use default.
         /// @param CVWaiter One waiter can be shared between different objects or have different time predictors.
+        /// @param RunPeriods How often each member runs, indexed the same as Members.
+        ///                   Empty to run all the members on every iteration.
+        ///                   Throws std::logic_error if the size is different from the members' count.
+        /// @param PipelineDepth The maximum number of the iterations in progress at the same time.
+        ///                      1 (default) to run the iterations one after another.
+        ///                      Throws std::logic_error if less than 1.
         SequentialGroup(
             std::vector<SequentialGroupMember> Members,
             std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor = nullptr,
             std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor = nullptr,
-            std::shared_ptr<SmartCVWaiter> CVWaiter = nullptr
+            std::shared_ptr<SmartCVWaiter> CVWaiter = nullptr,
+            std::vector<RunPeriod> RunPeriods = {},
+            int PipelineDepth = 1
         );
         virtual bool RunNext(double MaxEstimatedExecutionTime = 0) override;
         virtual bool IsRunAvailable(double MaxEstimatedExecutionTime = 0) override;
@@ -61,46 +83,107 @@ namespace LoopScheduler
         virtual bool IsAvailable(double MaxEstimatedExecutionTime = 0) override;
         virtual void WaitForAvailability(double MaxEstimatedExecutionTime = 0, double MaxWaitingTime = 0) override;
         virtual bool IsDone() override;
+        virtual bool IsFinished() override;
         virtual void StartNextIteration() override;
         virtual double PredictHigherRemainingExecutionTime() override;
         virtual double PredictLowerRemainingExecutionTime() override;
         virtual double PredictHigherExecutionTime() override;
         virtual double PredictLowerExecutionTime() override;
+        virtual void NotifyAvailabilityChange() override;
     protected:
         virtual bool UpdateLoop(Loop*) override;
+        /// @param Iteration The ring index of the iteration that ran the module, given to the module's token.
+        virtual void FinishSuspendedRun(int Iteration) override;
+        virtual void NotifyMemberInputAvailability() override;
     private:
         /// @brief A shared mutex for class members.
         std::shared_mutex MembersSharedMutex;
 
         std::vector<std::variant<std::shared_ptr<Group>, std::shared_ptr<Module>>> Members;
         std::vector<std::shared_ptr<Group>> GroupMembers;
-        /// @brief Can only be in range [-1, Members.size() - 1] (Only { -1 } if Members.size() = 0)
-        int CurrentMemberIndex;
-        int CurrentMemberRunsCount;
-        int RunningThreadsCount;
+        /// @brief Decides the members that run in each iteration, by their periods.
+        ///        The members that are not due are done without running.
+        RunPeriodTracker RunPeriods;
 
-        std::chrono::steady_clock::time_point LastModuleStartTime;
-        double LastModuleHigherPredictedTimeSpan;
-        double LastModuleLowerPredictedTimeSpan;
+        /// @brief The progress of an iteration through the stages.
+        class IterationState
+        {
+        public:
+            /// @brief Can only be in range [-1, Members.size() - 1] (Only { -1 } if Members.size() = 0)
+            int CurrentMemberIndex = -1;
+            int CurrentMemberRunsCount = 0;
+            int RunningThreadsCount = 0;
+            /// @brief The members that are due on the iteration, decided by RunPeriods on the iteration's start.
+            IndexSet DueSet;
+            /// Only set on the first RunNext(...) call after the iteration is started.
+            std::chrono::steady_clock::time_point StartTime;
+            std::chrono::steady_clock::time_point LastModuleStartTime;
+            double LastModuleHigherPredictedTimeSpan = 0;
+            double LastModuleLowerPredictedTimeSpan = 0;
+            /// @brief The loop's frame when the iteration started, set for its members' runs (see Loop::FrameScope).
+            std::int64_t FrameIndex = -1;
+        };
+        int PipelineDepth;
+        /// @brief A ring of PipelineDepth iterations, the ones in progress start from OldestIteration.
+        ///
+        /// The iterations are done in order, as an iteration can't move past the stage of the previous one.
+        std::vector<IterationState> Iterations;
+        int OldestIteration;
+        /// @brief The number of the iterations in progress or done since the last StartNextIteration, at least 1.
+        int IterationsCount;
+        /// @brief Incremented by NotifyAvailabilityChange with NextEventConditionMutex locked, to stop the waiters.
+        std::atomic<int> NotifyingCounter;
 
         /// Must be locked BEFORE MembersSharedMutex lock
         /// when modifying members before NextEventConditionVariable.notify_all().
         std::mutex NextEventConditionMutex;
         std::condition_variable NextEventConditionVariable;
-
-        /// Only set on the first RunNext(...) call after StartNextIteration() is called.
-        std::chrono::steady_clock::time_point IterationStartTime;
+        /// @brief Counts the threads waiting on NextEventConditionVariable to wake up only the needed ones.
+        TargetedNotifier Waiters;
 
         std::unique_ptr<TimeSpanPredictor> HigherExecutionTimePredictor;
         std::unique_ptr<TimeSpanPredictor> LowerExecutionTimePredictor;
+        /// @brief The predictors' predictions, published on each observation to be read without locking.
+        std::atomic<double> HigherPrediction;
+        std::atomic<double> LowerPrediction;
         std::shared_ptr<SmartCVWaiter> CVWaiter;
 
+        /// @brief Returns the ring index of the iteration at the position in the iterations in progress, 0 for the oldest.
+        ///
+        /// NO MUTEX LOCK
+        inline int GetIteration(int Position);
+        /// NO MUTEX LOCK
+        inline bool IsIterationDoneNoLock(int Iteration);
+        /// @brief Checks whether the next iteration has reached the iteration's current stage,
+        ///        in which case the member group there has moved on to the next iteration.
+        ///
+        /// NO MUTEX LOCK
+        inline bool IsStageReachedByNextIteration(int Iteration);
+        /// NO MUTEX LOCK
+        inline bool IsDoneNoLock();
+        /// NO MUTEX LOCK
+        inline bool IsFinishedNoLock();
+        /// @brief Returns the index of the first stage that the iteration can't move to,
+        ///        the stage of the previous iteration if it's not done yet.
+        ///
+        /// NO MUTEX LOCK
+        inline int GetStagesLimit(int Iteration);
+
         /// Should be placed in RunNext's start.
         /// NO MUTEX LOCK
-        inline void TimespanMeasurementStart();
+        inline void TimespanMeasurementStart(int Iteration);
+        /// @brief Returns the number of waiters to wake up after a member's run.
+        ///
+        /// NO MUTEX LOCK
+        inline int GetWakeUpsCountAfterRun(int Iteration);
         /// Should be placed after each RunNext's member run.
         /// NO MUTEX LOCK
-        inline void TimespanMeasurementStop();
+        inline void TimespanMeasurementStop(int Iteration);
+        /// @brief Wakes up the waiters after an iteration moved to another stage when pipelining,
+        ///        as the next iteration may be able to move or start now.
+        ///
+        /// LOCKS MUTEX, call with MembersSharedMutex unlocked.
+        inline void NotifyStageChange();
 
         /// @brief ShouldRunNextModuleFromCurrentMemberIndex
         ///        && ShouldTryRunNextGroupFromCurrentMemberIndex
@@ -108,7 +191,7 @@ namespace LoopScheduler
         ///        = false
         ///
         /// NO MUTEX LOCK
-        inline bool ShouldRunNextModuleFromCurrentMemberIndex(double MaxEstimatedExecutionTime);
+        inline bool ShouldRunNextModuleFromCurrentMemberIndex(int Iteration, double MaxEstimatedExecutionTime);
         /// @brief ShouldRunNextModuleFromCurrentMemberIndex
         ///        && ShouldTryRunNextGroupFromCurrentMemberIndex
         ///        && ShouldIncrementCurrentMemberIndex
@@ -118,20 +201,30 @@ namespace LoopScheduler
         ///
         /// @param InputMaxEstimatedExecutionTime The given MaxEstimatedExecutionTime.
         /// @param OutputMaxEstimatedExecutionTime The value that should be used instead. This is set only when the return value is true.
-        inline bool ShouldTryRunNextGroupFromCurrentMemberIndex(double InputMaxEstimatedExecutionTime, double& OutputMaxEstimatedExecutionTime);
+        inline bool ShouldTryRunNextGroupFromCurrentMemberIndex(
+            int Iteration, double InputMaxEstimatedExecutionTime, double& OutputMaxEstimatedExecutionTime);
         /// @brief ShouldRunNextModuleFromCurrentMemberIndex
         ///        && ShouldTryRunNextGroupFromCurrentMemberIndex
         ///        && ShouldIncrementCurrentMemberIndex
         ///        = false
         ///
         /// NO MUTEX LOCK
-        inline bool ShouldIncrementCurrentMemberIndex();
+        inline bool ShouldIncrementCurrentMemberIndex(int Iteration);
         /// NO MUTEX LOCK
         inline bool IsRunAvailableNoLock(double MaxEstimatedExecutionTime);
+        /// @tparam RunAvailability Whether to wait until all the iterations are finished (IsFinished)
+        ///                         instead of until the next one can start (IsDone), when there's nothing to run.
+        ///
         /// LOCKS MUTEX
+        template <bool RunAvailability>
         inline void WaitForAvailabilityCommon(double MaxEstimatedExecutionTime, double MaxWaitingTime);
         /// NO MUTEX LOCK
         template <bool Higher>
+        inline double PredictRemainingExecutionTimeNoLock(int Iteration);
+        /// @brief The maximum of the iterations' remaining execution times.
+        ///
+        /// NO MUTEX LOCK
+        template <bool Higher>
         inline double PredictRemainingExecutionTimeNoLock();
     };
 }
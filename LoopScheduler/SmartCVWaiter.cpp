@@ -20,11 +20,18 @@
 
 #include "SmartCVWaiter.h"
 
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #include <immintrin.h>
+#endif
+
 #include "BiasedEMATimeSpanPredictor.h"
 
 namespace LoopScheduler
 {
-    SmartCVWaiter::SmartCVWaiter(std::unique_ptr<TimeSpanPredictor> HigherErrorPredictor)
+    SmartCVWaiter::SmartCVWaiter(std::unique_ptr<TimeSpanPredictor> HigherErrorPredictor, double MaxSpinTime)
+        : MaxSpinTime(std::max(MaxSpinTime, 0.0)), SpinTime(std::max(MaxSpinTime, 0.0))
     {
         if (HigherErrorPredictor == nullptr)
             HigherErrorPredictor = std::unique_ptr<BiasedEMATimeSpanPredictor>(
@@ -37,4 +44,64 @@ namespace LoopScheduler
 
         this->HigherErrorPredictor = std::move(HigherErrorPredictor);
     }
+
+    void SmartCVWaiter::SetMaxSpinTime(double MaxSpinTime)
+    {
+        MaxSpinTime = std::max(MaxSpinTime, 0.0);
+        this->MaxSpinTime.store(MaxSpinTime, std::memory_order_relaxed);
+        SpinTime.store(MaxSpinTime, std::memory_order_relaxed);
+    }
+
+    double SmartCVWaiter::GetMaxSpinTime()
+    {
+        return MaxSpinTime.load(std::memory_order_relaxed);
+    }
+
+    double SmartCVWaiter::GetSpinTime()
+    {
+        return SpinTime.load(std::memory_order_relaxed);
+    }
+
+    double SmartCVWaiter::PredictError()
+    {
+        std::shared_lock<std::shared_mutex> shared_lock(PredictorMutex);
+        return HigherErrorPredictor->Predict();
+    }
+
+    void SmartCVWaiter::ReportParkedWait(double Time)
+    {
+        double max_spin_time = GetMaxSpinTime();
+        if (max_spin_time == 0)
+            return;
+        double spin_time = GetSpinTime();
+        // The event happened about the wake-up latency before the thread got to run.
+        if (Time - PredictError() <= max_spin_time)
+            spin_time = std::min(spin_time * 2, max_spin_time); // Spinning longer would have caught it
+        else
+            spin_time = std::max(spin_time * 0.5, std::min(MIN_SPIN_TIME, max_spin_time));
+        SpinTime.store(spin_time, std::memory_order_relaxed);
+    }
+
+    void SmartCVWaiter::ReportSpunWait(double Time)
+    {
+        double max_spin_time = GetMaxSpinTime();
+        double spin_time = GetSpinTime();
+        // Keeps a margin to still catch the slightly longer waits.
+        if (spin_time < Time * 2)
+            SpinTime.store(std::min(Time * 2, max_spin_time), std::memory_order_relaxed);
+    }
+
+    void SmartCVWaiter::Relax(int Iteration)
+    {
+        if (Iteration % 16 == 15)
+        {
+            std::this_thread::yield();
+            return;
+        }
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#endif
+    }
 }
@@ -22,6 +22,8 @@
 
 #include "LoopScheduler.dec.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <memory>
@@ -35,39 +37,137 @@ namespace LoopScheduler
     /// @brief Performs std::condition_variable::wait_for in a smarter way,
     ///        by accounting for the historical wait_for timing error
     ///        to wait more predictably.
+    ///
+    /// Can also spin before parking the thread on the condition variable,
+    /// to avoid the wake-up latency for short waits.
+    /// The spin time adapts to the waits: it grows when the waits end shortly after the threads are parked,
+    /// considering the wake-up latency (predicted as the historical wait_for timing error),
+    /// and shrinks when they don't.
+    /// The waiting strategy is shared by the objects using the same waiter,
+    /// so it can be selected for a group, or for a whole loop by passing the same waiter to its groups and modules.
     class SmartCVWaiter final
     {
     public:
-        SmartCVWaiter(std::unique_ptr<TimeSpanPredictor> HigherErrorPredictor = nullptr);
+        /// @param MaxSpinTime The maximum time in seconds to spin before parking. 0 to not spin (default).
+        SmartCVWaiter(std::unique_ptr<TimeSpanPredictor> HigherErrorPredictor = nullptr, double MaxSpinTime = 0);
 
+        /// @brief Waits until the predicate returns true. Spins first if spinning is enabled.
+        ///
+        /// The predicate is called with cv_lock locked.
+        template <typename PredicateType>
+        void Wait(std::condition_variable& cv, std::unique_lock<std::mutex>& cv_lock, PredicateType predicate);
+        /// @brief Waits until the predicate returns true or the time is elapsed. Spins first if spinning is enabled.
+        ///
+        /// The predicate is called with cv_lock locked.
+        /// The wait is shortened by the predicted timing error, which is learned from the waits
+        /// that ended without the predicate being satisfied (the actual minus the requested waiting time).
+        ///
+        /// @return The predicate's result,
+        ///         or false without waiting if the time is shorter than the predicted timing error.
         template <typename PredicateType>
         bool WaitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& cv_lock,
                 std::chrono::duration<double> time, PredicateType predicate);
+
+        /// @brief Thread-safe
+        void SetMaxSpinTime(double MaxSpinTime);
+        /// @brief Thread-safe
+        double GetMaxSpinTime();
+        /// @brief Returns the current adapted spin time in seconds.
+        ///
+        /// Thread-safe
+        double GetSpinTime();
+
+        /// @brief The spin time doesn't shrink below this when spinning is enabled, to be able to grow again.
+        static constexpr double MIN_SPIN_TIME = 0.000001;
     private:
         std::unique_ptr<TimeSpanPredictor> HigherErrorPredictor;
         std::shared_mutex PredictorMutex;
+        std::atomic<double> MaxSpinTime;
+        std::atomic<double> SpinTime;
+
+        double PredictError();
+        /// @brief Calls the predicate repeatedly, unlocking cv_lock between the calls.
+        /// @return Whether the predicate returned true before the time was elapsed.
+        template <typename PredicateType>
+        bool Spin(std::unique_lock<std::mutex>& cv_lock, double time, PredicateType predicate);
+        /// @brief Adapts the spin time after a wait that parked the thread.
+        /// @param Time The total waiting time, including the spin.
+        void ReportParkedWait(double Time);
+        /// @brief Adapts the spin time after a wait that ended while spinning.
+        void ReportSpunWait(double Time);
+        /// @brief Hints the processor that the thread is spinning, and yields once in a while.
+        static void Relax(int Iteration);
     };
 
+    template <typename PredicateType>
+    bool SmartCVWaiter::Spin(std::unique_lock<std::mutex>& cv_lock, double time, PredicateType predicate)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto stop = start + std::chrono::duration<double>(time);
+        for (int i = 0; ; i++)
+        {
+            if (predicate())
+            {
+                std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+                ReportSpunWait(duration.count());
+                return true;
+            }
+            if (std::chrono::steady_clock::now() >= stop)
+                return false;
+            // Unlocked to let the notifiers modify the state
+            cv_lock.unlock();
+            Relax(i);
+            cv_lock.lock();
+        }
+    }
+
+    template <typename PredicateType>
+    void SmartCVWaiter::Wait(std::condition_variable& cv, std::unique_lock<std::mutex>& cv_lock, PredicateType predicate)
+    {
+        double spin_time = GetSpinTime();
+        if (spin_time == 0)
+        {
+            cv.wait(cv_lock, predicate);
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (Spin(cv_lock, spin_time, predicate))
+            return;
+        cv.wait(cv_lock, predicate);
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        ReportParkedWait(duration.count());
+    }
+
     template <typename PredicateType>
     bool SmartCVWaiter::WaitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& cv_lock,
             std::chrono::duration<double> time, PredicateType predicate)
     {
-        double error_prediction;
+        double spin_time = std::min(GetSpinTime(), time.count());
+        std::chrono::steady_clock::time_point wait_start;
+        if (spin_time != 0)
         {
-            std::shared_lock<std::shared_mutex> shared_lock(PredictorMutex);
-            error_prediction = HigherErrorPredictor->Predict();
+            wait_start = std::chrono::steady_clock::now();
+            if (Spin(cv_lock, spin_time, predicate))
+                return true;
+            time -= std::chrono::steady_clock::now() - wait_start;
         }
+        double error_prediction = PredictError();
         if (error_prediction >= time.count())
             return false;
         std::chrono::duration<double> corrected_time(error_prediction > 0 ? time - std::chrono::duration<double>(error_prediction) : time);
-        std::chrono::time_point<std::chrono::steady_clock> start;
+        auto start = std::chrono::steady_clock::now();
         bool result = cv.wait_for(cv_lock, corrected_time, predicate);
+        auto stop = std::chrono::steady_clock::now();
         if (!result) // Only record when the predicate wasn't satisfied => pure time error
         {
-            std::chrono::time_point<std::chrono::steady_clock> stop;
             std::chrono::duration<double> actual_time = stop - start;
             std::lock_guard<std::shared_mutex> lock(PredictorMutex);
-            HigherErrorPredictor->ReportObservation((actual_time - time).count());
+            HigherErrorPredictor->ReportObservation((actual_time - corrected_time).count());
+        }
+        else if (spin_time != 0)
+        {
+            std::chrono::duration<double> duration = stop - wait_start;
+            ReportParkedWait(duration.count());
         }
         return result;
     }
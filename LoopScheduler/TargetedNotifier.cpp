@@ -0,0 +1,68 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "TargetedNotifier.h"
+
+namespace LoopScheduler
+{
+    TargetedNotifier::TargetedNotifier() : WaitersCount(0), ConstrainedWaitersCount(0), DoneWaitersCount(0) {}
+
+    TargetedNotifier::WaitingGuard::WaitingGuard(TargetedNotifier& Notifier, bool IsConstrained, bool IsWaitingForDone)
+        : Notifier(Notifier), IsConstrained(IsConstrained), IsWaitingForDone(IsWaitingForDone)
+    {
+        Notifier.WaitersCount.fetch_add(1, std::memory_order_relaxed);
+        if (IsConstrained)
+            Notifier.ConstrainedWaitersCount.fetch_add(1, std::memory_order_relaxed);
+        if (IsWaitingForDone)
+            Notifier.DoneWaitersCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    TargetedNotifier::WaitingGuard::~WaitingGuard()
+    {
+        if (IsWaitingForDone)
+            Notifier.DoneWaitersCount.fetch_sub(1, std::memory_order_relaxed);
+        if (IsConstrained)
+            Notifier.ConstrainedWaitersCount.fetch_sub(1, std::memory_order_relaxed);
+        Notifier.WaitersCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    int TargetedNotifier::GetWakeUpsCount(int RunsCount, bool IsDone, bool IsIdle)
+    {
+        int waiters_count = WaitersCount.load(std::memory_order_relaxed);
+        if (waiters_count == 0)
+            return 0;
+        if (RunsCount == ALL || RunsCount >= waiters_count || IsIdle
+            || ConstrainedWaitersCount.load(std::memory_order_relaxed) != 0
+            || (IsDone && DoneWaitersCount.load(std::memory_order_relaxed) != 0))
+            return ALL;
+        return RunsCount;
+    }
+
+    void TargetedNotifier::Notify(std::condition_variable& ConditionVariable, int WakeUpsCount)
+    {
+        if (WakeUpsCount == ALL)
+        {
+            ConditionVariable.notify_all();
+            return;
+        }
+        for (int i = 0; i < WakeUpsCount; i++)
+            ConditionVariable.notify_one();
+    }
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+#include <atomic>
+#include <condition_variable>
+
+namespace LoopScheduler
+{
+    /// @brief Counts the threads waiting on a condition variable,
+    ///        to wake up only as many of them as there are new runs available, instead of all of them.
+    ///
+    /// The waiters are registered using WaitingGuard with the condition variable's mutex locked,
+    /// so a notifier that modified the state with the mutex locked sees the waiters that may be parked.
+    /// All the waiters are woken up when they may not be able to take the new runs,
+    /// like when a waiter has a max estimated execution time,
+    /// or when they may be waiting for something else than a run, like for the group to be done.
+    /// Thread-safe.
+    class TargetedNotifier final
+    {
+    public:
+        TargetedNotifier();
+
+        /// @brief Used instead of a count to wake up all the waiters.
+        static constexpr int ALL = -1;
+
+        /// @brief Registers a waiting thread from construction to destruction.
+        ///
+        /// Must be constructed with the condition variable's mutex locked.
+        class WaitingGuard final
+        {
+        public:
+            /// @param IsConstrained Whether the waiter can't take every run, like when it has a max estimated execution time
+            ///                      or runs in a loop worker reserved for some groups.
+            /// @param IsWaitingForDone Whether the waiter also waits for the group to be done.
+            WaitingGuard(TargetedNotifier& Notifier, bool IsConstrained, bool IsWaitingForDone);
+            WaitingGuard(const WaitingGuard&) = delete;
+            WaitingGuard& operator=(const WaitingGuard&) = delete;
+            ~WaitingGuard();
+        private:
+            TargetedNotifier& Notifier;
+            bool IsConstrained;
+            bool IsWaitingForDone;
+        };
+
+        /// @brief Returns the number of waiters to wake up after an event.
+        ///
+        /// Should be called after modifying the state with the condition variable's mutex locked.
+        ///
+        /// @param RunsCount The number of runs that became available by the event, or ALL if unknown.
+        /// @param IsDone Whether the group is done after the event.
+        /// @param IsIdle Whether nothing is running in the group after the event.
+        ///               The waiters return without waiting when nothing is running, so they are all woken up.
+        /// @return The number of waiters to wake up, or ALL.
+        int GetWakeUpsCount(int RunsCount, bool IsDone, bool IsIdle);
+        /// @brief Wakes up the number of waiters returned by GetWakeUpsCount.
+        static void Notify(std::condition_variable& ConditionVariable, int WakeUpsCount);
+    private:
+        std::atomic<int> WaitersCount;
+        std::atomic<int> ConstrainedWaitersCount;
+        std::atomic<int> DoneWaitersCount;
+    };
+}
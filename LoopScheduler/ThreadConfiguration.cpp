@@ -0,0 +1,128 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "ThreadConfiguration.h"
+
+#include <fstream>
+#include <sstream>
+
+#if defined(__linux__) || defined(__APPLE__)
+    #include <pthread.h>
+#endif
+#if defined(__linux__)
+    #include <sched.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace LoopScheduler
+{
+    bool ThreadConfiguration::ApplyToCurrentThread(bool IsRestoring) const
+    {
+        bool success = true;
+#if defined(__linux__)
+        const std::vector<int>& cores = (Cores.size() == 0 && NumaNode >= 0) ? GetNumaNodeCores(NumaNode) : Cores;
+        if (Cores.size() == 0 && NumaNode >= 0 && cores.size() == 0)
+            success = false;
+        if (cores.size() != 0)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int core : cores)
+                if (core >= 0 && core < CPU_SETSIZE)
+                    CPU_SET(core, &set);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+                success = false;
+        }
+        // The defaults keep the inherited scheduling and nice level, unless restoring them.
+        if (RealtimePriority > 0 || IsRestoring)
+        {
+            sched_param param{};
+            param.sched_priority = RealtimePriority;
+            if (pthread_setschedparam(pthread_self(), RealtimePriority > 0 ? SCHED_FIFO : SCHED_OTHER, &param) != 0)
+                success = false;
+        }
+        if (RealtimePriority <= 0 && (Nice != 0 || IsRestoring)
+            && setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), Nice) != 0)
+            success = false;
+        if (Name.size() != 0 && pthread_setname_np(pthread_self(), Name.substr(0, 15).c_str()) != 0)
+            success = false;
+#else
+        if (Cores.size() != 0 || NumaNode >= 0 || RealtimePriority != 0 || Nice != 0)
+            success = false;
+    #if defined(__APPLE__)
+        if (Name.size() != 0 && pthread_setname_np(Name.c_str()) != 0)
+            success = false;
+    #else
+        if (Name.size() != 0)
+            success = false;
+    #endif
+#endif
+        return success;
+    }
+
+    ThreadConfiguration ThreadConfiguration::GetCurrentThreadConfiguration()
+    {
+        ThreadConfiguration result;
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+            for (int i = 0; i < CPU_SETSIZE; i++)
+                if (CPU_ISSET(i, &set))
+                    result.Cores.push_back(i);
+        int policy;
+        sched_param param{};
+        if (pthread_getschedparam(pthread_self(), &policy, &param) == 0 && policy == SCHED_FIFO)
+            result.RealtimePriority = param.sched_priority;
+        result.Nice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid));
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+        char name[64];
+        if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0)
+            result.Name = name;
+#endif
+        return result;
+    }
+
+    std::vector<int> ThreadConfiguration::GetNumaNodeCores(int NumaNode)
+    {
+        std::vector<int> result;
+#if defined(__linux__)
+        // A list of ranges, like "0-7,16-23"
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(NumaNode) + "/cpulist");
+        std::string range;
+        while (std::getline(file, range, ','))
+        {
+            std::istringstream stream(range);
+            int first, last;
+            char separator;
+            if (!(stream >> first))
+                break;
+            last = first;
+            if (stream >> separator >> last && separator != '-')
+                break;
+            for (int i = first; i <= last; i++)
+                result.push_back(i);
+        }
+#endif
+        return result;
+    }
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace LoopScheduler
+{
+    /// @brief The configuration of a loop worker thread, set using Loop::SetThreadConfigurations.
+    ///
+    /// The CPU affinity, the NUMA node, the scheduling and the nice level are only supported on Linux,
+    /// the name is supported on Linux and macOS.
+    /// The unsupported settings are not applied, and counted as failures (see Loop::GetThreadConfigurationFailuresCount).
+    struct ThreadConfiguration final
+    {
+    public:
+        /// @brief The logical CPU cores to pin the thread to. Empty to not pin the thread.
+        std::vector<int> Cores;
+        /// @brief The NUMA node to pin the thread to its cores, when Cores is empty. -1 for no NUMA node.
+        int NumaNode = -1;
+        /// @brief The SCHED_FIFO real-time priority in range [1, 99], usually needs privileges.
+        ///        0 to keep the default scheduling.
+        int RealtimePriority = 0;
+        /// @brief The nice level of the thread, only applied when RealtimePriority is 0. 0 to keep the default.
+        int Nice = 0;
+        /// @brief The thread's name, truncated to 15 characters on Linux. Empty to keep the default.
+        std::string Name;
+        /// @brief The groups that the worker is reserved for.
+        ///        The worker only runs the modules in these groups and their member groups (recursively).
+        ///        Empty to run everything.
+        ///
+        /// The modules can still run in the other workers.
+        std::vector<std::shared_ptr<Group>> ReservedGroups;
+
+        /// @brief Applies the settings other than ReservedGroups to the calling thread.
+        /// @param IsRestoring Whether to apply the scheduling and the nice level even when they're 0,
+        ///                    to restore the settings returned by GetCurrentThreadConfiguration.
+        /// @return Whether all the settings were applied.
+        bool ApplyToCurrentThread(bool IsRestoring = false) const;
+        /// @brief Returns the calling thread's current settings, to apply them back later.
+        static ThreadConfiguration GetCurrentThreadConfiguration();
+        /// @brief Returns the logical CPU cores of a NUMA node, or an empty vector if it's unknown.
+        static std::vector<int> GetNumaNodeCores(int NumaNode);
+    };
+}
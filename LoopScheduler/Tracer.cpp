@@ -0,0 +1,244 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "Tracer.h"
+
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace LoopScheduler
+{
+    namespace
+    {
+        class TraceEvent
+        {
+        public:
+            const char * Name;
+            const char * Category;
+            const void * Object;
+            std::chrono::steady_clock::time_point StartTime;
+            std::chrono::steady_clock::time_point StopTime;
+        };
+
+        /// @brief A ring buffer written by 1 thread.
+        class ThreadBuffer
+        {
+        public:
+            ThreadBuffer(int ThreadNumber)
+                : ThreadNumber(ThreadNumber), Events(new TraceEvent[Tracer::EVENTS_PER_THREAD]), WriteCount(0), Generation(0)
+            {}
+            const int ThreadNumber;
+            std::unique_ptr<TraceEvent[]> Events;
+            /// @brief Only modified by the owner thread.
+            std::atomic<std::uint64_t> WriteCount;
+            /// @brief The recording that the events belong to. Only modified by the owner thread.
+            std::atomic<std::uint64_t> Generation;
+        };
+
+        class TracerState
+        {
+        public:
+            std::atomic<bool> Recording{false};
+            /// @brief Incremented on each Start, the buffers from previous generations are cleared lazily.
+            std::atomic<std::uint64_t> Generation{0};
+            std::chrono::steady_clock::time_point StartTime;
+            std::mutex Mutex;
+            /// @brief The buffers are kept after their threads exit, to be exported.
+            std::vector<std::shared_ptr<ThreadBuffer>> Buffers;
+            std::map<const void*, std::string> Names;
+        };
+
+        TracerState& GetState()
+        {
+            static TracerState state;
+            return state;
+        }
+
+        thread_local std::shared_ptr<ThreadBuffer> LocalBuffer;
+
+        inline ThreadBuffer& GetLocalBuffer(TracerState& state)
+        {
+            if (LocalBuffer == nullptr)
+            {
+                std::unique_lock<std::mutex> lock(state.Mutex);
+                LocalBuffer = std::make_shared<ThreadBuffer>((int)state.Buffers.size());
+                state.Buffers.push_back(LocalBuffer);
+            }
+            return *LocalBuffer;
+        }
+
+        void WriteJSONString(std::ostream& stream, const std::string& str)
+        {
+            stream << '"';
+            for (char c : str)
+            {
+                if (c == '"' || c == '\\')
+                    stream << '\\' << c;
+                else if ((unsigned char)c < 0x20)
+                    stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+                else
+                    stream << c;
+            }
+            stream << '"';
+        }
+    }
+
+    void Tracer::Start()
+    {
+        auto& state = GetState();
+        std::unique_lock<std::mutex> lock(state.Mutex);
+        state.Recording.store(false);
+        state.StartTime = std::chrono::steady_clock::now();
+        state.Generation.fetch_add(1);
+        state.Recording.store(true);
+    }
+
+    void Tracer::Stop()
+    {
+        GetState().Recording.store(false);
+    }
+
+    bool Tracer::IsRecording()
+    {
+        return GetState().Recording.load(std::memory_order_relaxed);
+    }
+
+    void Tracer::SetName(const void * Object, std::string Name)
+    {
+        auto& state = GetState();
+        std::unique_lock<std::mutex> lock(state.Mutex);
+        if (Name.empty())
+            state.Names.erase(Object);
+        else
+            state.Names[Object] = std::move(Name);
+    }
+
+    void Tracer::Record(
+        const char * Name,
+        const char * Category,
+        const void * Object,
+        std::chrono::steady_clock::time_point StartTime,
+        std::chrono::steady_clock::time_point StopTime)
+    {
+        auto& state = GetState();
+        if (!state.Recording.load(std::memory_order_relaxed))
+            return;
+        auto& buffer = GetLocalBuffer(state);
+        auto generation = state.Generation.load(std::memory_order_acquire);
+        std::uint64_t count;
+        if (buffer.Generation.load(std::memory_order_relaxed) != generation)
+        {
+            buffer.WriteCount.store(0, std::memory_order_relaxed);
+            buffer.Generation.store(generation, std::memory_order_release);
+            count = 0;
+        }
+        else
+        {
+            count = buffer.WriteCount.load(std::memory_order_relaxed);
+        }
+        buffer.Events[count % EVENTS_PER_THREAD] = TraceEvent{Name, Category, Object, StartTime, StopTime};
+        buffer.WriteCount.store(count + 1, std::memory_order_release);
+    }
+
+    void Tracer::WriteChromeTrace(std::ostream& stream)
+    {
+        auto& state = GetState();
+        std::unique_lock<std::mutex> lock(state.Mutex);
+        auto generation = state.Generation.load();
+        auto flags = stream.flags();
+        auto precision = stream.precision();
+        stream << std::fixed << std::setprecision(3);
+
+        const auto to_microseconds = [&state](std::chrono::steady_clock::time_point time) {
+            return ((std::chrono::duration<double, std::micro>)(time - state.StartTime)).count();
+        };
+
+        stream << "{\"traceEvents\":[";
+        bool is_first = true;
+        for (auto& buffer : state.Buffers)
+        {
+            if (buffer->Generation.load(std::memory_order_acquire) != generation)
+                continue;
+            std::uint64_t count = buffer->WriteCount.load(std::memory_order_acquire);
+            if (count == 0)
+                continue;
+
+            stream << (is_first ? "\n" : ",\n");
+            is_first = false;
+            stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->ThreadNumber
+                   << ",\"args\":{\"name\":\"Thread " << buffer->ThreadNumber << "\"}}";
+
+            std::uint64_t first = count > EVENTS_PER_THREAD ? count - EVENTS_PER_THREAD : 0;
+            for (std::uint64_t i = first; i < count; i++)
+            {
+                const TraceEvent& event = buffer->Events[i % EVENTS_PER_THREAD];
+                stream << ",\n{\"name\":";
+                auto name = state.Names.find(event.Object);
+                if (name == state.Names.end())
+                    WriteJSONString(stream, event.Name);
+                else if (std::string(event.Category) == "run")
+                    WriteJSONString(stream, name->second);
+                else
+                    WriteJSONString(stream, std::string(event.Name) + " (" + name->second + ")");
+                stream << ",\"cat\":";
+                WriteJSONString(stream, event.Category);
+                stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->ThreadNumber
+                       << ",\"ts\":" << to_microseconds(event.StartTime)
+                       << ",\"dur\":" << ((std::chrono::duration<double, std::micro>)(event.StopTime - event.StartTime)).count()
+                       << ",\"args\":{\"event\":";
+                WriteJSONString(stream, event.Name);
+                stream << ",\"object\":\"" << event.Object << "\"}}";
+            }
+        }
+        stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        stream.flags(flags);
+        stream.precision(precision);
+    }
+
+    std::string Tracer::GetChromeTrace()
+    {
+        std::ostringstream stream;
+        WriteChromeTrace(stream);
+        return stream.str();
+    }
+
+    Tracer::Scope::Scope(const char * Name, const char * Category, const void * Object)
+        : Name(Name), Category(Category), Object(Object), Recording(IsRecording())
+    {
+        if (Recording)
+            StartTime = std::chrono::steady_clock::now();
+    }
+
+    Tracer::Scope::~Scope()
+    {
+        if (Recording)
+            Record(Name, Category, Object, StartTime, std::chrono::steady_clock::now());
+    }
+
+    void Tracer::Scope::Discard()
+    {
+        Recording = false;
+    }
+}
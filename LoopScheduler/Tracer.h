@@ -0,0 +1,110 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#if LOOPSCHEDULER_ENABLE_TRACING
+    /// @brief Records the enclosing scope as a trace event. Removed when LOOPSCHEDULER_ENABLE_TRACING is 0.
+    /// @param Name A string literal, the event's name.
+    /// @param Category A string literal, the event's category.
+    /// @param Object The object that the event belongs to, used to look up a name set by Tracer::SetName.
+    #define LOOPSCHEDULER_TRACE_SCOPE(Name, Category, Object) \
+        LoopScheduler::Tracer::Scope LOOPSCHEDULER_TRACE_SCOPE_CONCAT(loopscheduler_trace_scope_, __LINE__)(Name, Category, Object)
+    #define LOOPSCHEDULER_TRACE_SCOPE_CONCAT(a, b) LOOPSCHEDULER_TRACE_SCOPE_CONCAT_INNER(a, b)
+    #define LOOPSCHEDULER_TRACE_SCOPE_CONCAT_INNER(a, b) a##b
+#else
+    #define LOOPSCHEDULER_TRACE_SCOPE(Name, Category, Object)
+#endif
+
+namespace LoopScheduler
+{
+    /// @brief Records the loop's execution to per-thread ring buffers,
+    ///        to be exported in the Chrome Trace Event format (viewable in Perfetto or chrome://tracing).
+    ///
+    /// The events are only recorded by the library when it's compiled with LOOPSCHEDULER_ENABLE_TRACING set to 1,
+    /// otherwise the recording points are removed at compile-time.
+    /// Recording doesn't lock, each thread writes to its own buffer,
+    /// and the oldest events are overwritten when a buffer is full.
+    /// Thread-safe.
+    class Tracer final
+    {
+    public:
+        /// @brief The capacity of each thread's ring buffer.
+        static constexpr int EVENTS_PER_THREAD = 1 << 16;
+
+        /// @brief Clears the recorded events and starts recording.
+        static void Start();
+        /// @brief Stops recording. The recorded events are kept until the next Start.
+        static void Stop();
+        static bool IsRecording();
+        /// @brief Sets the name to show for the events of a module or a group.
+        ///
+        /// Replaces the name of the "run" events, and is added to the name of the others (waits and idles).
+        /// The name is kept until it's set again, an empty name removes it.
+        static void SetName(const void * Object, std::string Name);
+        /// @brief Writes the recorded events as a Chrome Trace Event JSON document.
+        ///
+        /// Should be called after Stop, the events recorded while writing may be partially written.
+        static void WriteChromeTrace(std::ostream&);
+        /// @brief Returns the recorded events as a Chrome Trace Event JSON document.
+        static std::string GetChromeTrace();
+
+        /// @brief Records an event from its construction to its destruction.
+        ///
+        /// Use LOOPSCHEDULER_TRACE_SCOPE instead to be removable at compile-time.
+        class Scope final
+        {
+        public:
+            /// @param Name Must outlive the tracer, like a string literal.
+            /// @param Category Must outlive the tracer, like a string literal.
+            Scope(const char * Name, const char * Category, const void * Object);
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            ~Scope();
+            /// @brief Prevents recording the event, like when nothing was run.
+            void Discard();
+        private:
+            const char * Name;
+            const char * Category;
+            const void * Object;
+            std::chrono::steady_clock::time_point StartTime;
+            bool Recording;
+        };
+
+        /// @brief Records an event with a known start and stop time.
+        static void Record(
+            const char * Name,
+            const char * Category,
+            const void * Object,
+            std::chrono::steady_clock::time_point StartTime,
+            std::chrono::steady_clock::time_point StopTime
+        );
+    private:
+        Tracer() = delete;
+    };
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "WorkStealingQueue.h"
+
+#include <utility>
+
+namespace LoopScheduler
+{
+    WorkStealingQueue::WorkStealingQueue() : Size(0) {}
+
+    void WorkStealingQueue::Push(Group::ReservedRun&& Run)
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        Runs.push_back(std::move(Run));
+        Size.store(Runs.size(), std::memory_order_relaxed);
+    }
+
+    bool WorkStealingQueue::Pop(Group::ReservedRun& Output)
+    {
+        if (Size.load(std::memory_order_relaxed) == 0)
+            return false;
+        std::unique_lock<std::mutex> lock(Mutex);
+        if (Runs.size() == 0)
+            return false;
+        Output = std::move(Runs.back());
+        Runs.pop_back();
+        Size.store(Runs.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    bool WorkStealingQueue::Steal(Group::ReservedRun& Output)
+    {
+        if (Size.load(std::memory_order_relaxed) == 0)
+            return false;
+        std::unique_lock<std::mutex> lock(Mutex);
+        if (Runs.size() == 0)
+            return false;
+        Output = std::move(Runs.front());
+        Runs.pop_front();
+        Size.store(Runs.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    bool WorkStealingQueue::IsEmpty()
+    {
+        return Size.load(std::memory_order_relaxed) == 0;
+    }
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2021 Majidzadeh (hashpragmaonce@gmail.com)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "LoopScheduler.dec.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+#include "Group.h"
+
+namespace LoopScheduler
+{
+    /// @brief A queue of reserved runs owned by a loop thread, used by the Loop's work-stealing executor.
+    ///
+    /// The owner thread pushes and pops at the back,
+    /// other threads steal from the front.
+    /// Thread-safe.
+    class WorkStealingQueue final
+    {
+    public:
+        WorkStealingQueue();
+        /// @brief Used by the owner thread to add a run.
+        void Push(Group::ReservedRun&& Run);
+        /// @brief Used by the owner thread to take the most recently added run.
+        /// @return Whether a run was taken.
+        bool Pop(Group::ReservedRun& Output);
+        /// @brief Used by other threads to take the least recently added run.
+        /// @return Whether a run was taken.
+        bool Steal(Group::ReservedRun& Output);
+        /// @brief Checks whether the queue is empty without locking.
+        ///        The result may be outdated immediately.
+        bool IsEmpty();
+    private:
+        std::mutex Mutex;
+        std::deque<Group::ReservedRun> Runs;
+        /// @brief Used to check for emptiness without locking the mutex.
+        std::atomic<int> Size;
+    };
+}
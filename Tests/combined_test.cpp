@@ -2,10 +2,16 @@
 
 #include "../LoopScheduler/LoopScheduler.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <exception>
+#include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <random>
 #include <stdexcept>
@@ -16,9 +22,29 @@
 class Report
 {
 public:
-    int ReportStart(std::string Name);
+    /// @param FrameIndex The run's frame (see Module::GetFrame), shown in the report if not -1.
+    int ReportStart(std::string Name, std::int64_t FrameIndex = -1);
     void ReportStop(int);
     std::string GetReport();
+    /// @brief Returns the total time of the runs that are run inside the named module's runs, in their threads,
+    ///        while the module was idling, and the total time of the module's runs.
+    std::string GetIdlingReport(std::string IdlerName);
+    /// @brief Checks whether each run of the second module started after the run of the first module
+    ///        with the same number had stopped, and both have the same number of runs.
+    bool IsEachRunAfter(std::string FirstName, std::string SecondName);
+    /// @brief Checks whether a run of the other module, of a later frame, started while a run of the named module was running.
+    bool HasNewerFrameRunDuring(std::string Name, std::string OtherName);
+    /// @brief Counts the named module's runs that a run of the first module started in, before any run of the second module.
+    int CountRunsStartingFirstDuring(std::string Name, std::string FirstName, std::string SecondName);
+    /// @brief Counts the named module's runs that a run of the other module started in.
+    int CountRunsWithStartDuring(std::string Name, std::string OtherName);
+    /// @brief Checks whether each frame that the named module ran on has a run of the other module.
+    bool HasRunOnEachFrameOf(std::string Name, std::string OtherName);
+    /// @brief Returns the frames of the named module's runs, in the order they started.
+    std::vector<std::int64_t> GetFrames(std::string Name);
+    /// @brief Returns the shortest time in seconds between the starts of the named module's consecutive runs,
+    ///        or 0 if it has less than 2 runs.
+    double GetShortestTimeBetweenRuns(std::string Name);
 private:
     class RunInfo
     {
@@ -26,11 +52,13 @@ private:
         RunInfo(
             std::thread::id ThreadId,
             std::string Name,
+            std::int64_t FrameIndex,
             std::chrono::steady_clock::time_point Start,
             std::chrono::steady_clock::time_point Stop
         );
         std::thread::id ThreadId;
         std::string Name;
+        std::int64_t FrameIndex;
         std::chrono::steady_clock::time_point Start;
         std::chrono::steady_clock::time_point Stop;
     };
@@ -38,11 +66,13 @@ private:
     std::vector<RunInfo> Runs;
 };
 
-int Report::ReportStart(std::string Name)
+int Report::ReportStart(std::string Name, std::int64_t FrameIndex)
 {
     Mutex.lock();
     int result = Runs.size();
-    Runs.push_back(RunInfo(std::this_thread::get_id(), Name, std::chrono::steady_clock::now(), std::chrono::steady_clock::now()));
+    Runs.push_back(RunInfo(
+        std::this_thread::get_id(), Name, FrameIndex, std::chrono::steady_clock::now(), std::chrono::steady_clock::now()
+    ));
     Mutex.unlock();
     return result;
 }
@@ -67,6 +97,8 @@ std::string Report::GetReport()
             thread_numbers[run_info.ThreadId] = thread_counter++;
         result += std::to_string(thread_numbers[run_info.ThreadId]) + ": ";
         result += run_info.Name + ", ";
+        if (run_info.FrameIndex != -1)
+            result += "frame " + std::to_string(run_info.FrameIndex) + ", ";
         result += std::to_string(((std::chrono::duration<double>)(run_info.Start - start)).count()) + "-";
         result += std::to_string(((std::chrono::duration<double>)(run_info.Stop - start)).count()) + '\n';
     }
@@ -74,12 +106,184 @@ std::string Report::GetReport()
     return result;
 }
 
+std::string Report::GetIdlingReport(std::string IdlerName)
+{
+    Mutex.lock();
+    double idler_time = 0;
+    double work_time = 0;
+    for (auto& idler_run : Runs)
+    {
+        if (idler_run.Name != IdlerName)
+            continue;
+        idler_time += ((std::chrono::duration<double>)(idler_run.Stop - idler_run.Start)).count();
+        for (auto& run_info : Runs)
+        {
+            if (run_info.ThreadId == idler_run.ThreadId && run_info.Name != IdlerName
+                && run_info.Start >= idler_run.Start && run_info.Stop <= idler_run.Stop)
+            {
+                work_time += ((std::chrono::duration<double>)(run_info.Stop - run_info.Start)).count();
+            }
+        }
+    }
+    Mutex.unlock();
+    std::string result = IdlerName + " idled for " + std::to_string(idler_time) + "s, ";
+    result += std::to_string(work_time) + "s of work was run meanwhile";
+    if (idler_time != 0)
+        result += " (" + std::to_string(work_time / idler_time * 100) + "%)";
+    return result + '\n';
+}
+
+bool Report::IsEachRunAfter(std::string FirstName, std::string SecondName)
+{
+    Mutex.lock();
+    std::vector<RunInfo*> first_runs;
+    std::vector<RunInfo*> second_runs;
+    for (auto& run_info : Runs)
+    {
+        if (run_info.Name == FirstName)
+            first_runs.push_back(&run_info);
+        else if (run_info.Name == SecondName)
+            second_runs.push_back(&run_info);
+    }
+    bool result = first_runs.size() == second_runs.size();
+    for (int i = 0; result && i < second_runs.size(); i++)
+        result = first_runs[i]->Stop <= second_runs[i]->Start;
+    Mutex.unlock();
+    return result;
+}
+
+bool Report::HasNewerFrameRunDuring(std::string Name, std::string OtherName)
+{
+    Mutex.lock();
+    bool result = false;
+    for (auto& run_info : Runs)
+    {
+        if (run_info.Name != Name)
+            continue;
+        for (auto& other_run_info : Runs)
+        {
+            if (other_run_info.Name == OtherName && other_run_info.FrameIndex > run_info.FrameIndex
+                && other_run_info.Start >= run_info.Start && other_run_info.Start < run_info.Stop)
+            {
+                result = true;
+            }
+        }
+    }
+    Mutex.unlock();
+    return result;
+}
+
+int Report::CountRunsStartingFirstDuring(std::string Name, std::string FirstName, std::string SecondName)
+{
+    Mutex.lock();
+    int result = 0;
+    for (auto& run_info : Runs)
+    {
+        if (run_info.Name != Name)
+            continue;
+        const RunInfo * first = nullptr;
+        const RunInfo * second = nullptr;
+        for (auto& other_run_info : Runs)
+        {
+            if (other_run_info.Start < run_info.Start || other_run_info.Start >= run_info.Stop)
+                continue;
+            if (other_run_info.Name == FirstName && (first == nullptr || other_run_info.Start < first->Start))
+                first = &other_run_info;
+            else if (other_run_info.Name == SecondName && (second == nullptr || other_run_info.Start < second->Start))
+                second = &other_run_info;
+        }
+        if (first != nullptr && (second == nullptr || first->Start < second->Start))
+            result++;
+    }
+    Mutex.unlock();
+    return result;
+}
+
+int Report::CountRunsWithStartDuring(std::string Name, std::string OtherName)
+{
+    Mutex.lock();
+    int result = 0;
+    for (auto& run_info : Runs)
+    {
+        if (run_info.Name != Name)
+            continue;
+        for (auto& other_run_info : Runs)
+        {
+            if (other_run_info.Name == OtherName
+                && other_run_info.Start >= run_info.Start && other_run_info.Start < run_info.Stop)
+            {
+                result++;
+                break;
+            }
+        }
+    }
+    Mutex.unlock();
+    return result;
+}
+
+bool Report::HasRunOnEachFrameOf(std::string Name, std::string OtherName)
+{
+    Mutex.lock();
+    bool result = true;
+    for (auto& run_info : Runs)
+    {
+        if (run_info.Name != Name)
+            continue;
+        bool has_other_run = false;
+        for (auto& other_run_info : Runs)
+        {
+            if (other_run_info.Name == OtherName && other_run_info.FrameIndex == run_info.FrameIndex)
+            {
+                has_other_run = true;
+                break;
+            }
+        }
+        if (!has_other_run)
+            result = false;
+    }
+    Mutex.unlock();
+    return result;
+}
+
+std::vector<std::int64_t> Report::GetFrames(std::string Name)
+{
+    Mutex.lock();
+    std::vector<std::int64_t> result;
+    for (auto& run_info : Runs)
+        if (run_info.Name == Name)
+            result.push_back(run_info.FrameIndex);
+    Mutex.unlock();
+    return result;
+}
+
+double Report::GetShortestTimeBetweenRuns(std::string Name)
+{
+    Mutex.lock();
+    double result = 0;
+    const RunInfo * previous = nullptr;
+    for (auto& run_info : Runs)
+    {
+        if (run_info.Name != Name)
+            continue;
+        if (previous != nullptr)
+        {
+            double time = ((std::chrono::duration<double>)(run_info.Start - previous->Start)).count();
+            if (result == 0 || time < result)
+                result = time;
+        }
+        previous = &run_info;
+    }
+    Mutex.unlock();
+    return result;
+}
+
 Report::RunInfo::RunInfo(
         std::thread::id ThreadId,
         std::string Name,
+        std::int64_t FrameIndex,
         std::chrono::steady_clock::time_point Start,
         std::chrono::steady_clock::time_point Stop
-    ) : ThreadId(ThreadId), Name(Name), Start(Start), Stop(Stop)
+    ) : ThreadId(ThreadId), Name(Name), FrameIndex(FrameIndex), Start(Start), Stop(Stop)
 {}
 
 class IdlingTimerModule : public LoopScheduler::Module
@@ -107,6 +311,7 @@ IdlingTimerModule::IdlingTimerModule(double TimeMin, double TimeMax, double Idli
       Name(Name),
       Predictor(IdlingTimeSlice, 0.05, 0.5)
 {
+    LoopScheduler::Tracer::SetName(this, Name);
 }
 void IdlingTimerModule::OnRun()
 {
@@ -136,7 +341,7 @@ private:
 };
 
 StoppingModule::StoppingModule(int RunCountsLimit)
-    : RunCountsLimit(RunCountsLimit)
+    : RunCounts(0), RunCountsLimit(RunCountsLimit)
 {}
 void StoppingModule::OnRun()
 {
@@ -148,7 +353,7 @@ void StoppingModule::OnRun()
 class WorkingModule : public LoopScheduler::Module
 {
 public:
-    WorkingModule(int WorkAmountMin, int WorkAmountMax, Report& ReportRef, std::string Name, bool CanRunInParallel = false, bool UseCustomCanRUn = false);
+    WorkingModule(int WorkAmountMin, int WorkAmountMax, Report& ReportRef, std::string Name, bool CanRunInParallel = false, bool UseCustomCanRUn = false, bool UseHardAffinity = false);
 protected:
     virtual void OnRun() override;
     virtual bool CanRun() override;
@@ -162,14 +367,18 @@ private:
     std::thread::id thread_id;
 };
 
-WorkingModule::WorkingModule(int WorkAmountMin, int WorkAmountMax, Report& ReportRef, std::string Name, bool CanRunInParallel, bool UseCustomCanRUn)
+WorkingModule::WorkingModule(int WorkAmountMin, int WorkAmountMax, Report& ReportRef, std::string Name, bool CanRunInParallel, bool UseCustomCanRUn, bool UseHardAffinity)
     : random_device(),
       random_engine(random_device()),
       random_distribution(WorkAmountMin, WorkAmountMax),
       ReportRef(ReportRef),
       Name(Name),
+      HadFirstRun(false),
       Module(CanRunInParallel, nullptr, nullptr, UseCustomCanRUn)
 {
+    LoopScheduler::Tracer::SetName(this, Name);
+    if (UseHardAffinity)
+        SetAffinity(HardAffinity);
 }
 void WorkingModule::OnRun()
 {
@@ -178,7 +387,7 @@ void WorkingModule::OnRun()
         thread_id = std::this_thread::get_id();
         HadFirstRun = true;
     }
-    int report_id = ReportRef.ReportStart(Name);
+    int report_id = ReportRef.ReportStart(Name, GetFrame().Index);
     int WorkAmount = random_distribution(random_engine);
     for (int i = 0; i < WorkAmount; i++)
     {
@@ -195,7 +404,7 @@ bool WorkingModule::CanRun()
     return true;
 }
 
-void test1()
+void test1(bool BudgetPacking)
 {
     Report report;
 
@@ -219,6 +428,7 @@ void test1()
     parallel_members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<StoppingModule>(100)));
 
     std::shared_ptr<LoopScheduler::ParallelGroup> parallel_group(new LoopScheduler::ParallelGroup(parallel_members));
+    parallel_group->SetBudgetPacking(BudgetPacking);
 
     std::vector<LoopScheduler::SequentialGroupMember> sequential_members;
     sequential_members.push_back(parallel_group);
@@ -227,9 +437,17 @@ void test1()
     std::shared_ptr<LoopScheduler::SequentialGroup> sequential_group(new LoopScheduler::SequentialGroup(sequential_members));
 
     LoopScheduler::Loop loop(sequential_group);
+    LoopScheduler::Tracer::Start();
     loop.Run(4);
+    LoopScheduler::Tracer::Stop();
 
     std::cout << report.GetReport();
+    std::cout << report.GetIdlingReport("Idler");
+#if LOOPSCHEDULER_ENABLE_TRACING
+    std::ofstream trace_file("combined_test_trace.json");
+    LoopScheduler::Tracer::WriteChromeTrace(trace_file);
+    std::cout << "The trace is written to combined_test_trace.json, it can be opened in Perfetto.\n";
+#endif
 }
 
 void test2()
@@ -355,7 +573,8 @@ std::variant<std::variant<std::shared_ptr<LoopScheduler::Group>, std::shared_ptr
         std::cout << "  stopper: StoppingModule\n";
         std::cout << "  worker: WorkingModule\n";
         std::cout << "  aworker: WorkingModule with CanRunInParallel=true\n";
-        std::cout << "  sworker: WorkingModule running in the same thread as before\n";
+        std::cout << "  sworker: WorkingModule running in the same thread as before, using a custom CanRun\n";
+        std::cout << "  hworker: WorkingModule running in the same thread as before, using a hard affinity\n";
         std::cout << "  idler: IdlingTimerModule\n";
         std::cout << "Or enter a group name to include that as a member, 'done' to stop: ";
         std::cin >> input;
@@ -370,7 +589,7 @@ std::variant<std::variant<std::shared_ptr<LoopScheduler::Group>, std::shared_ptr
             std::cin >> count;
             return std::make_shared<StoppingModule>(count);
         }
-        if (input == "worker" || input == "aworker" || input == "sworker")
+        if (input == "worker" || input == "aworker" || input == "sworker" || input == "hworker")
         {
             int min_work;
             int max_work;
@@ -383,7 +602,8 @@ std::variant<std::variant<std::shared_ptr<LoopScheduler::Group>, std::shared_ptr
             std::cin >> max_work;
             bool can_run_in_parallel = input[0] == 'a';
             bool use_custom_can_run = input[0] == 's';
-            return std::make_shared<WorkingModule>(min_work, max_work, report, name, can_run_in_parallel, use_custom_can_run);
+            bool use_hard_affinity = input[0] == 'h';
+            return std::make_shared<WorkingModule>(min_work, max_work, report, name, can_run_in_parallel, use_custom_can_run, use_hard_affinity);
         }
         if (input == "idler")
         {
@@ -418,7 +638,8 @@ void test_custom()
     std::map<std::string, std::shared_ptr<LoopScheduler::Group>> groups;
     while (true)
     {
-        std::cout << "Enter 'parallel' to create a ParallelGroup, or 'sequential' to create a SequentialGroup, 'done' to stop: ";
+        std::cout << "Enter 'parallel' to create a ParallelGroup, 'sequential' to create a SequentialGroup,\n";
+        std::cout << "or 'pipelined' to create a SequentialGroup with overlapping iterations, 'done' to stop: ";
         std::cin >> input;
         if (input == "parallel")
         {
@@ -438,8 +659,14 @@ void test_custom()
             }
             groups[name] = std::shared_ptr<LoopScheduler::ParallelGroup>(new LoopScheduler::ParallelGroup(parallel_members));
         }
-        else if (input == "sequential")
+        else if (input == "sequential" || input == "pipelined")
         {
+            int pipeline_depth = 1;
+            if (input == "pipelined")
+            {
+                std::cout << "Enter the pipeline depth (the maximum number of iterations in progress): ";
+                std::cin >> pipeline_depth;
+            }
             std::cout << "Enter a name for the new SequentialGroup: ";
             std::string name = prompt_name(groups);
             std::cout << "Adding members to " << name << ". Do not forget to add 1 StoppingModule to the loop.\n";
@@ -451,7 +678,9 @@ void test_custom()
                     break;
                 sequential_members.push_back(LoopScheduler::SequentialGroupMember(std::get<0>(member)));
             }
-            groups[name] = std::shared_ptr<LoopScheduler::SequentialGroup>(new LoopScheduler::SequentialGroup(sequential_members));
+            groups[name] = std::shared_ptr<LoopScheduler::SequentialGroup>(new LoopScheduler::SequentialGroup(
+                sequential_members, nullptr, nullptr, nullptr, {}, pipeline_depth
+            ));
         }
         else if (input == "done")
         {
@@ -486,18 +715,778 @@ void test_custom()
     std::cout << report.GetReport();
 }
 
+/// @brief Suspends each run with a delay, checking that the run isn't finished and keeps its frame meanwhile.
+class SuspendingModule : public LoopScheduler::CoroutineModule
+{
+public:
+    SuspendingModule(double DelayTime, Report& ReportRef, std::string Name);
+    int RunsCount;
+    bool HasFailed;
+protected:
+    virtual Task OnRunAsync() override;
+private:
+    double DelayTime;
+    Report& ReportRef;
+    std::string Name;
+};
+
+SuspendingModule::SuspendingModule(double DelayTime, Report& ReportRef, std::string Name)
+    : RunsCount(0), HasFailed(false), DelayTime(DelayTime), ReportRef(ReportRef), Name(Name)
+{
+    LoopScheduler::Tracer::SetName(this, Name);
+}
+SuspendingModule::Task SuspendingModule::OnRunAsync()
+{
+    auto frame_index = GetFrame().Index;
+    int report_id = ReportRef.ReportStart(Name, frame_index);
+    int finished_runs_count = GetFinishedRunsCount();
+    co_await Delay(DelayTime);
+    if (GetFinishedRunsCount() != finished_runs_count || GetFrame().Index != frame_index)
+        HasFailed = true;
+    RunsCount++;
+    ReportRef.ReportStop(report_id);
+}
+
+class SleepingModule : public LoopScheduler::Module
+{
+public:
+    SleepingModule(double Time, Report& ReportRef, std::string Name);
+protected:
+    virtual void OnRun() override;
+private:
+    double Time;
+    Report& ReportRef;
+    std::string Name;
+};
+
+SleepingModule::SleepingModule(double Time, Report& ReportRef, std::string Name)
+    : Time(Time), ReportRef(ReportRef), Name(Name)
+{
+    LoopScheduler::Tracer::SetName(this, Name);
+}
+void SleepingModule::OnRun()
+{
+    int report_id = ReportRef.ReportStart(Name);
+    std::this_thread::sleep_for(std::chrono::duration<double>(Time));
+    ReportRef.ReportStop(report_id);
+}
+
+/// @brief Reports its runs' frames, predicted to take a fixed time to balance the run periods' phases.
+class PeriodicModule : public LoopScheduler::Module
+{
+public:
+    PeriodicModule(double PredictedTime, Report& ReportRef, std::string Name);
+protected:
+    virtual void OnRun() override;
+private:
+    Report& ReportRef;
+    std::string Name;
+};
+
+PeriodicModule::PeriodicModule(double PredictedTime, Report& ReportRef, std::string Name)
+    : Module(
+        false,
+        std::unique_ptr<LoopScheduler::BiasedEMATimeSpanPredictor>(new LoopScheduler::BiasedEMATimeSpanPredictor(
+            PredictedTime,
+            LoopScheduler::BiasedEMATimeSpanPredictor::DEFAULT_FAST_ALPHA,
+            LoopScheduler::BiasedEMATimeSpanPredictor::DEFAULT_SLOW_ALPHA
+        ))
+      ),
+      ReportRef(ReportRef), Name(Name)
+{
+    LoopScheduler::Tracer::SetName(this, Name);
+}
+void PeriodicModule::OnRun()
+{
+    int report_id = ReportRef.ReportStart(Name, GetFrame().Index);
+    ReportRef.ReportStop(report_id);
+}
+
+/// @brief Idles for a fixed time on each run, the other modules run in its thread meanwhile.
+class PackingModule : public LoopScheduler::Module
+{
+public:
+    PackingModule(double IdlingTime, Report& ReportRef, std::string Name);
+protected:
+    virtual void OnRun() override;
+private:
+    double IdlingTime;
+    Report& ReportRef;
+    std::string Name;
+};
+
+PackingModule::PackingModule(double IdlingTime, Report& ReportRef, std::string Name)
+    : IdlingTime(IdlingTime), ReportRef(ReportRef), Name(Name)
+{
+    LoopScheduler::Tracer::SetName(this, Name);
+}
+void PackingModule::OnRun()
+{
+    int report_id = ReportRef.ReportStart(Name);
+    Idle(IdlingTime);
+    ReportRef.ReportStop(report_id);
+}
+
+/// @brief Counts the runs of each index of a ParallelFor, and the threads that ran the chunks.
+class ParallelForModule : public LoopScheduler::Module
+{
+public:
+    ParallelForModule(int IndexesCount, int GrainSize);
+    std::vector<std::atomic<int>> IndexRunsCounts;
+    int RunsCount;
+    int GetThreadsCount();
+protected:
+    virtual void OnRun() override;
+private:
+    int GrainSize;
+    std::mutex ThreadIdsMutex;
+    std::vector<std::thread::id> ThreadIds;
+};
+
+ParallelForModule::ParallelForModule(int IndexesCount, int GrainSize)
+    : IndexRunsCounts(IndexesCount), RunsCount(0), GrainSize(GrainSize)
+{
+    LoopScheduler::Tracer::SetName(this, "ParallelFor");
+}
+int ParallelForModule::GetThreadsCount()
+{
+    std::unique_lock<std::mutex> lock(ThreadIdsMutex);
+    return ThreadIds.size();
+}
+void ParallelForModule::OnRun()
+{
+    RunsCount++;
+    ParallelFor(0, IndexRunsCounts.size(), GrainSize, [this](int ChunkBegin, int ChunkEnd) {
+        {
+            std::unique_lock<std::mutex> lock(ThreadIdsMutex);
+            if (std::find(ThreadIds.begin(), ThreadIds.end(), std::this_thread::get_id()) == ThreadIds.end())
+                ThreadIds.push_back(std::this_thread::get_id());
+        }
+        for (int i = ChunkBegin; i < ChunkEnd; i++)
+        {
+            IndexRunsCounts[i]++;
+            for (int j = 0; j < 1000; j++); // Work unit
+        }
+    });
+}
+
+class ProducingModule : public LoopScheduler::Module
+{
+public:
+    ProducingModule(std::shared_ptr<LoopScheduler::MPMCChannel<int>> Output, int ItemsCount, Report& ReportRef, std::string Name);
+    std::atomic<int> PushedCount;
+protected:
+    virtual void OnRun() override;
+private:
+    std::shared_ptr<LoopScheduler::MPMCChannel<int>> Output;
+    std::vector<int> Items;
+    Report& ReportRef;
+    std::string Name;
+};
+
+ProducingModule::ProducingModule(
+        std::shared_ptr<LoopScheduler::MPMCChannel<int>> Output, int ItemsCount, Report& ReportRef, std::string Name
+    ) : PushedCount(0), Output(Output), Items(ItemsCount, 1), ReportRef(ReportRef), Name(Name)
+{
+    LoopScheduler::Tracer::SetName(this, Name);
+}
+void ProducingModule::OnRun()
+{
+    int report_id = ReportRef.ReportStart(Name, GetFrame().Index);
+    PushedCount += Output->PushBatch(Items.begin(), Items.end());
+    ReportRef.ReportStop(report_id);
+}
+
+/// @brief Sleeps before and after pushing its items, the run is reported as a whole.
+class DelayedProducingModule : public LoopScheduler::Module
+{
+public:
+    DelayedProducingModule(std::shared_ptr<LoopScheduler::MPMCChannel<int>> Output, int ItemsCount, double Delay, Report& ReportRef, std::string Name);
+    std::atomic<int> PushedCount;
+protected:
+    virtual void OnRun() override;
+private:
+    std::shared_ptr<LoopScheduler::MPMCChannel<int>> Output;
+    std::vector<int> Items;
+    double Delay;
+    Report& ReportRef;
+    std::string Name;
+};
+
+DelayedProducingModule::DelayedProducingModule(
+        std::shared_ptr<LoopScheduler::MPMCChannel<int>> Output, int ItemsCount, double Delay, Report& ReportRef, std::string Name
+    ) : PushedCount(0), Output(Output), Items(ItemsCount, 1), Delay(Delay), ReportRef(ReportRef), Name(Name)
+{
+    LoopScheduler::Tracer::SetName(this, Name);
+}
+void DelayedProducingModule::OnRun()
+{
+    int report_id = ReportRef.ReportStart(Name, GetFrame().Index);
+    std::this_thread::sleep_for(std::chrono::duration<double>(Delay));
+    PushedCount += Output->PushBatch(Items.begin(), Items.end());
+    std::this_thread::sleep_for(std::chrono::duration<double>(Delay));
+    ReportRef.ReportStop(report_id);
+}
+
+/// @brief Pops the items of its input channel, and pushes the number of the popped items to its output channel.
+class ConsumingModule : public LoopScheduler::Module
+{
+public:
+    ConsumingModule(
+        std::shared_ptr<LoopScheduler::MPMCChannel<int>> Input,
+        std::shared_ptr<LoopScheduler::SPSCChannel<int>> Output,
+        Report& ReportRef, std::string Name
+    );
+protected:
+    virtual void OnRun() override;
+private:
+    std::shared_ptr<LoopScheduler::MPMCChannel<int>> Input;
+    std::shared_ptr<LoopScheduler::SPSCChannel<int>> Output;
+    std::vector<int> Items;
+    Report& ReportRef;
+    std::string Name;
+};
+
+ConsumingModule::ConsumingModule(
+        std::shared_ptr<LoopScheduler::MPMCChannel<int>> Input,
+        std::shared_ptr<LoopScheduler::SPSCChannel<int>> Output,
+        Report& ReportRef, std::string Name
+    ) : Input(Input), Output(Output), Items(Input->GetCapacity()), ReportRef(ReportRef), Name(Name)
+{
+    LoopScheduler::Tracer::SetName(this, Name);
+    AddInputChannel(Input);
+}
+void ConsumingModule::OnRun()
+{
+    int report_id = ReportRef.ReportStart(Name, GetFrame().Index);
+    int count = 0;
+    std::size_t popped_count = Input->PopBatch(Items.begin(), Items.size());
+    for (int i = 0; i < popped_count; i++)
+        count += Items[i];
+    while (!Output->TryPush(count))
+        Idle(0.0001);
+    ReportRef.ReportStop(report_id);
+}
+
+/// @brief Sums the numbers of its input channel.
+class CountingModule : public LoopScheduler::Module
+{
+public:
+    CountingModule(std::shared_ptr<LoopScheduler::SPSCChannel<int>> Input);
+    int Count;
+protected:
+    virtual void OnRun() override;
+private:
+    std::shared_ptr<LoopScheduler::SPSCChannel<int>> Input;
+};
+
+CountingModule::CountingModule(std::shared_ptr<LoopScheduler::SPSCChannel<int>> Input) : Count(0), Input(Input)
+{
+    AddInputChannel(Input);
+}
+void CountingModule::OnRun()
+{
+    int count;
+    while (Input->TryPop(count))
+        Count += count;
+}
+
+void test4()
+{
+    Report report;
+    auto items_channel = std::make_shared<LoopScheduler::MPMCChannel<int>>(1024);
+    auto counts_channel = std::make_shared<LoopScheduler::SPSCChannel<int>>(16);
+
+    std::vector<std::shared_ptr<ProducingModule>> producers;
+    std::vector<LoopScheduler::ParallelGroupMember> parallel_members;
+    for (int i = 0; i < 3; i++)
+    {
+        producers.push_back(std::make_shared<ProducingModule>(items_channel, 100, report, "Producer" + std::to_string(i + 1)));
+        parallel_members.push_back(LoopScheduler::ParallelGroupMember(producers.back()));
+    }
+    parallel_members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<StoppingModule>(100)));
+    std::shared_ptr<LoopScheduler::ParallelGroup> parallel_group(new LoopScheduler::ParallelGroup(parallel_members));
+
+    auto counter = std::make_shared<CountingModule>(counts_channel);
+    std::vector<LoopScheduler::SequentialGroupMember> sequential_members;
+    sequential_members.push_back(parallel_group);
+    sequential_members.push_back(std::make_shared<ConsumingModule>(items_channel, counts_channel, report, "Consumer"));
+    sequential_members.push_back(counter);
+    std::shared_ptr<LoopScheduler::SequentialGroup> sequential_group(new LoopScheduler::SequentialGroup(sequential_members));
+
+    LoopScheduler::Loop loop(sequential_group);
+    loop.Run(4);
+
+    std::cout << report.GetReport();
+    int pushed_count = 0;
+    for (auto& producer : producers)
+        pushed_count += producer->PushedCount;
+    int left_count = items_channel->GetSize();
+    std::cout << "Pushed " << pushed_count << " items, counted " << counter->Count << " items, "
+              << left_count << " items left in the channel.\n";
+    if (pushed_count == counter->Count + left_count && counts_channel->IsEmpty())
+        std::cout << "Test 4-1 passed.\n";
+    else
+        std::cout << "Test 4-1 failed.\n";
+
+    // The consumer is ready before its channel has items, and is woken up by the push of a parallel sibling.
+    Report wake_up_report;
+    const int iterations_count = 10;
+    auto delayed_items_channel = std::make_shared<LoopScheduler::MPMCChannel<int>>(1024);
+    auto delayed_counts_channel = std::make_shared<LoopScheduler::SPSCChannel<int>>(64);
+    auto delayed_producer = std::make_shared<DelayedProducingModule>(delayed_items_channel, 100, 0.01, wake_up_report, "DelayedProducer");
+    std::vector<LoopScheduler::ParallelGroupMember> wake_up_members;
+    wake_up_members.push_back(LoopScheduler::ParallelGroupMember(
+        std::make_shared<ConsumingModule>(delayed_items_channel, delayed_counts_channel, wake_up_report, "WokenConsumer")
+    ));
+    wake_up_members.push_back(LoopScheduler::ParallelGroupMember(delayed_producer));
+    wake_up_members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<StoppingModule>(iterations_count)));
+    std::shared_ptr<LoopScheduler::ParallelGroup> wake_up_group(new LoopScheduler::ParallelGroup(wake_up_members));
+    std::atomic<bool> is_finished = false;
+    std::thread watchdog([&is_finished] {
+        for (int i = 0; i < 1000 && !is_finished; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (!is_finished)
+        {
+            std::cout << "Test 4-2 failed. The loop stalled while the consumer was waiting for its items.\n";
+            std::_Exit(1);
+        }
+    });
+    {
+        LoopScheduler::Loop loop(wake_up_group);
+        loop.Run(2);
+    }
+    is_finished = true;
+    watchdog.join();
+
+    bool is_each_count_after_push = true;
+    int delayed_counted = 0;
+    for (int count; delayed_counts_channel->TryPop(count); delayed_counted += count)
+        if (count == 0)
+            is_each_count_after_push = false;
+    if (is_each_count_after_push && delayed_counted == delayed_producer->PushedCount)
+        std::cout << "Test 4-2 passed.\n";
+    else
+        std::cout << "Test 4-2 failed. The consumer ran before the items were pushed, or missed some.\n";
+    // The producer's thread is still sleeping after the push, another thread has to be woken up for the consumer.
+    int woken_count = wake_up_report.CountRunsWithStartDuring("DelayedProducer", "WokenConsumer");
+    if (woken_count == iterations_count)
+        std::cout << "Test 4-3 passed.\n";
+    else
+        std::cout << "Test 4-3 failed. The consumer only started during " << woken_count << " of "
+                  << iterations_count << " producer runs.\n";
+}
+
+void test5()
+{
+    Report report;
+    std::vector<LoopScheduler::DependencyGroupMember> members;
+    members.push_back(std::make_shared<WorkingModule>(10000, 20000, report, "Physics"));
+    members.push_back(std::make_shared<WorkingModule>(10000, 20000, report, "Animation"));
+    members.push_back(std::make_shared<WorkingModule>(10000, 20000, report, "Render"));
+    members.push_back(std::make_shared<WorkingModule>(10000, 20000, report, "Audio"));
+    members.push_back(std::make_shared<StoppingModule>(50));
+    std::shared_ptr<LoopScheduler::DependencyGroup> dependency_group(
+        new LoopScheduler::DependencyGroup(members, { { 0, 2 }, { 1, 2 } })
+    );
+
+    LoopScheduler::Loop loop(dependency_group);
+    loop.Run(4);
+
+    std::cout << report.GetReport();
+    if (report.IsEachRunAfter("Physics", "Render") && report.IsEachRunAfter("Animation", "Render"))
+        std::cout << "Test 5-1 passed.\n";
+    else
+        std::cout << "Test 5-1 failed. Render ran before its dependencies.\n";
+
+    try
+    {
+        std::vector<LoopScheduler::DependencyGroupMember> cycle_members;
+        cycle_members.push_back(std::make_shared<WorkingModule>(10000, 20000, report, "A"));
+        cycle_members.push_back(std::make_shared<WorkingModule>(10000, 20000, report, "B"));
+        cycle_members.push_back(std::make_shared<WorkingModule>(10000, 20000, report, "C"));
+        LoopScheduler::DependencyGroup cycle_group(cycle_members, { { 0, 1 }, { 1, 2 }, { 2, 0 } });
+        std::cout << "Test 5-2 failed. The cycle was not rejected.\n";
+    }
+    catch (const std::logic_error& e)
+    {
+        std::cout << "Test 5-2 passed.\n";
+    }
+}
+
+void test6()
+{
+    Report report;
+
+    // The next member waits for the suspended run to finish.
+    auto sequential_suspender = std::make_shared<SuspendingModule>(0.005, report, "SequentialSuspender");
+    std::vector<LoopScheduler::SequentialGroupMember> sequential_members;
+    sequential_members.push_back(sequential_suspender);
+    sequential_members.push_back(std::make_shared<WorkingModule>(10000, 20000, report, "After"));
+    sequential_members.push_back(std::make_shared<StoppingModule>(20));
+    std::shared_ptr<LoopScheduler::SequentialGroup> sequential_group(new LoopScheduler::SequentialGroup(sequential_members));
+    {
+        LoopScheduler::Loop loop(sequential_group);
+        loop.Run(4);
+    }
+
+    // The next iterations start while the run is suspended.
+    auto parallel_suspender = std::make_shared<SuspendingModule>(0.02, report, "ParallelSuspender");
+    std::vector<LoopScheduler::ParallelGroupMember> parallel_members;
+    parallel_members.push_back(LoopScheduler::ParallelGroupMember(parallel_suspender));
+    parallel_members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<WorkingModule>(10000, 20000, report, "Fast")));
+    parallel_members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<StoppingModule>(100)));
+    std::shared_ptr<LoopScheduler::ParallelGroup> parallel_group(new LoopScheduler::ParallelGroup(parallel_members));
+    {
+        LoopScheduler::Loop loop(parallel_group);
+        loop.Run(4);
+    }
+
+    std::cout << report.GetReport();
+    if (report.IsEachRunAfter("SequentialSuspender", "After"))
+        std::cout << "Test 6-1 passed.\n";
+    else
+        std::cout << "Test 6-1 failed. The next member ran before the suspended run was finished.\n";
+    if (report.HasNewerFrameRunDuring("ParallelSuspender", "Fast"))
+        std::cout << "Test 6-2 passed.\n";
+    else
+        std::cout << "Test 6-2 failed. No iteration started while the run was suspended.\n";
+    if (!sequential_suspender->HasFailed && !parallel_suspender->HasFailed
+        && sequential_suspender->GetFinishedRunsCount() == sequential_suspender->RunsCount
+        && parallel_suspender->GetFinishedRunsCount() == parallel_suspender->RunsCount)
+        std::cout << "Test 6-3 passed.\n";
+    else
+        std::cout << "Test 6-3 failed. A run was finished before it was resumed, or lost its frame.\n";
+}
+
+/// @brief Checks whether the prediction is in the bucket resolution of the expected value.
+bool IsPredictionNear(const LoopScheduler::QuantileTimeSpanPredictor& Predictor, double Expected)
+{
+    double prediction = Predictor.Predict();
+    std::cout << "Prediction: " << prediction << ", expected: " << Expected << '\n';
+    return prediction > Expected * 0.9 && prediction < Expected * 1.1;
+}
+
+void test7()
+{
+    LoopScheduler::QuantileTimeSpanPredictor initial_predictor(0.9, 1, 0.005);
+    if (initial_predictor.Predict() == 0.005)
+        std::cout << "Test 7-1 passed.\n";
+    else
+        std::cout << "Test 7-1 failed. The initial value wasn't predicted before the first observation.\n";
+
+    // A single spike in 100 observations is above p90.
+    LoopScheduler::QuantileTimeSpanPredictor spike_predictor(0.9, 1);
+    for (int i = 0; i < 99; i++)
+        spike_predictor.ReportObservation(0.001);
+    spike_predictor.ReportObservation(0.1);
+    if (IsPredictionNear(spike_predictor, 0.001))
+        std::cout << "Test 7-2 passed.\n";
+    else
+        std::cout << "Test 7-2 failed. A single spike changed the p90 prediction.\n";
+
+    // 2 spikes in 10 observations are in p90.
+    LoopScheduler::QuantileTimeSpanPredictor tail_predictor(0.9, 1);
+    for (int i = 0; i < 8; i++)
+        tail_predictor.ReportObservation(0.001);
+    tail_predictor.ReportObservation(0.1);
+    tail_predictor.ReportObservation(0.1);
+    if (IsPredictionNear(tail_predictor, 0.1))
+        std::cout << "Test 7-3 passed.\n";
+    else
+        std::cout << "Test 7-3 failed. The frequent spikes weren't predicted by p90.\n";
+
+    // The old observations age out.
+    LoopScheduler::QuantileTimeSpanPredictor decaying_predictor(0.9, 0.5);
+    for (int i = 0; i < 2000; i++)
+        decaying_predictor.ReportObservation(0.1);
+    for (int i = 0; i < 20; i++)
+        decaying_predictor.ReportObservation(0.001);
+    if (IsPredictionNear(decaying_predictor, 0.001))
+        std::cout << "Test 7-4 passed.\n";
+    else
+        std::cout << "Test 7-4 failed. The old observations didn't age out.\n";
+}
+
+/// @return The number of the packer's runs that the long module started first in.
+int run_packing_test(bool BudgetPacking, int IterationsCount)
+{
+    Report report;
+    std::vector<LoopScheduler::ParallelGroupMember> members;
+    members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<PackingModule>(0.03, report, "Packer")));
+    members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<SleepingModule>(0.001, report, "Short")));
+    members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<SleepingModule>(0.005, report, "Long")));
+    members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<StoppingModule>(IterationsCount)));
+    std::shared_ptr<LoopScheduler::ParallelGroup> group(new LoopScheduler::ParallelGroup(members));
+    group->SetBudgetPacking(BudgetPacking);
+    {
+        LoopScheduler::Loop loop(group);
+        // A single thread, so that the others only run while the packer is idling.
+        loop.Run(1);
+    }
+    int count = report.CountRunsStartingFirstDuring("Packer", "Long", "Short");
+    std::cout << "Budget packing " << (BudgetPacking ? "enabled" : "disabled") << ": the long module started first in "
+              << count << " of " << IterationsCount << " idling windows.\n";
+    return count;
+}
+
+void test8()
+{
+    const int iterations_count = 20;
+    // The predictions are learned in the first iterations.
+    if (run_packing_test(true, iterations_count) >= iterations_count - 3)
+        std::cout << "Test 8-1 passed.\n";
+    else
+        std::cout << "Test 8-1 failed. Budget packing didn't run the longest fitting module first.\n";
+    if (run_packing_test(false, iterations_count) <= 3)
+        std::cout << "Test 8-2 passed.\n";
+    else
+        std::cout << "Test 8-2 failed. The members weren't run in their order without budget packing.\n";
+}
+
+void test9()
+{
+    Report report;
+    const int iterations_count = 20;
+
+    // The deadline leaves less slack than the lower-priority module takes, until the deadline module starts.
+    std::vector<LoopScheduler::PriorityGroupMember> members;
+    members.push_back(LoopScheduler::PriorityGroupMember(std::make_shared<SleepingModule>(0.02, report, "Deadline"), 1, 0.025));
+    members.push_back(LoopScheduler::PriorityGroupMember(std::make_shared<SleepingModule>(0.02, report, "Lower"), 0));
+    members.push_back(LoopScheduler::PriorityGroupMember(std::make_shared<StoppingModule>(iterations_count), -1));
+    std::shared_ptr<LoopScheduler::PriorityGroup> group(new LoopScheduler::PriorityGroup(members));
+    {
+        LoopScheduler::Loop loop(group);
+        loop.Run(2);
+    }
+
+    std::cout << report.GetReport();
+    int count = report.CountRunsWithStartDuring("Deadline", "Lower");
+    std::cout << "The lower-priority module started during " << count << " of " << iterations_count << " deadline module runs.\n";
+    // The predictions are learned in the first iterations.
+    if (count >= iterations_count - 3)
+        std::cout << "Test 9-1 passed.\n";
+    else
+        std::cout << "Test 9-1 failed. The running deadline module held back the lower-priority module.\n";
+}
+
+void test10()
+{
+    Report report;
+    auto parallel_for_module = std::make_shared<ParallelForModule>(10000, 16);
+    std::vector<LoopScheduler::ParallelGroupMember> members;
+    members.push_back(LoopScheduler::ParallelGroupMember(parallel_for_module));
+    members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<WorkingModule>(10000, 20000, report, "Worker")));
+    members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<StoppingModule>(20)));
+    std::shared_ptr<LoopScheduler::ParallelGroup> group(new LoopScheduler::ParallelGroup(members));
+    {
+        LoopScheduler::Loop loop(group);
+        loop.Run(4);
+    }
+
+    std::cout << "The chunks were run by " << parallel_for_module->GetThreadsCount() << " threads.\n";
+    bool is_each_index_run_once = true;
+    for (auto& count : parallel_for_module->IndexRunsCounts)
+        if (count.load() != parallel_for_module->RunsCount)
+            is_each_index_run_once = false;
+    if (is_each_index_run_once)
+        std::cout << "Test 10-1 passed.\n";
+    else
+        std::cout << "Test 10-1 failed. An index wasn't run exactly once per ParallelFor call.\n";
+}
+
+void test11()
+{
+    const int tries_count = 20;
+
+    // The root is done while the pipelined group's newer iteration is in progress when the loop stops.
+    bool is_each_frame_finished = true;
+    for (int i = 0; i < tries_count; i++)
+    {
+        Report report;
+        // The last stage is a group, the pipelined group is done once that stage has started.
+        std::vector<LoopScheduler::ParallelGroupMember> stage_members;
+        stage_members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<WorkingModule>(10000, 20000, report, "Stage2A")));
+        stage_members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<WorkingModule>(10000, 20000, report, "Stage2B")));
+        std::vector<LoopScheduler::SequentialGroupMember> sequential_members;
+        sequential_members.push_back(std::make_shared<WorkingModule>(10000, 20000, report, "Stage1"));
+        sequential_members.push_back(std::shared_ptr<LoopScheduler::ParallelGroup>(new LoopScheduler::ParallelGroup(stage_members)));
+        std::shared_ptr<LoopScheduler::SequentialGroup> pipelined_group(new LoopScheduler::SequentialGroup(
+            sequential_members, nullptr, nullptr, nullptr, {}, 2
+        ));
+        std::vector<LoopScheduler::ParallelGroupMember> parallel_members;
+        parallel_members.push_back(LoopScheduler::ParallelGroupMember(pipelined_group));
+        parallel_members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<StoppingModule>(10)));
+        std::shared_ptr<LoopScheduler::ParallelGroup> parallel_group(new LoopScheduler::ParallelGroup(parallel_members));
+        {
+            LoopScheduler::Loop loop(parallel_group);
+            loop.Run(4);
+        }
+        if (!report.HasRunOnEachFrameOf("Stage1", "Stage2A") || !report.HasRunOnEachFrameOf("Stage1", "Stage2B"))
+        {
+            std::cout << report.GetReport();
+            is_each_frame_finished = false;
+        }
+    }
+
+    if (is_each_frame_finished)
+        std::cout << "Test 11-1 passed.\n";
+    else
+        std::cout << "Test 11-1 failed. A started frame didn't reach the last stage before the loop stopped.\n";
+}
+
+/// @brief Checks whether the frames are Period apart, starting from a phase in [0, Period - 1].
+bool IsRunEvery(const std::vector<std::int64_t>& Frames, int Period, int FramesCount)
+{
+    if (Frames.size() == 0 || Frames[0] >= Period || Frames.size() != (FramesCount - Frames[0] + Period - 1) / Period)
+        return false;
+    for (int i = 1; i < Frames.size(); i++)
+        if (Frames[i] - Frames[i - 1] != Period)
+            return false;
+    return true;
+}
+
+void test12()
+{
+    // The lighter members are spread across the iterations that the heavier one is not on.
+    {
+        Report report;
+        const int frames_count = 30;
+        std::vector<std::string> names = { "Heavy", "Light1", "Light2", "Light3" };
+        std::vector<LoopScheduler::ParallelGroupMember> members;
+        members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<PeriodicModule>(0.003, report, "Heavy"), 0, LoopScheduler::RunPeriod(3)));
+        for (int i = 1; i < names.size(); i++)
+            members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<PeriodicModule>(0.001, report, names[i]), 0, LoopScheduler::RunPeriod(3)));
+        members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<StoppingModule>(frames_count)));
+        std::shared_ptr<LoopScheduler::ParallelGroup> group(new LoopScheduler::ParallelGroup(members));
+        {
+            LoopScheduler::Loop loop(group);
+            loop.Run(2);
+        }
+
+        bool is_periodic = true;
+        std::vector<int> phase_loads(3, 0);
+        std::vector<int> phases;
+        for (auto& name : names)
+        {
+            auto frames = report.GetFrames(name);
+            if (!IsRunEvery(frames, 3, frames_count))
+            {
+                is_periodic = false;
+                continue;
+            }
+            phases.push_back(frames[0]);
+            phase_loads[frames[0]] += name == "Heavy" ? 3 : 1;
+            std::cout << name << " ran on the iterations " << frames[0] << " + 3k.\n";
+        }
+        if (is_periodic)
+            std::cout << "Test 12-1 passed.\n";
+        else
+            std::cout << "Test 12-1 failed. A member didn't run on 1 of every 3 iterations on a fixed phase.\n";
+        // The heavy member alone (3), and the 3 light ones spread on the other 2 iterations (2 + 1).
+        std::sort(phase_loads.begin(), phase_loads.end());
+        if (is_periodic && phase_loads == std::vector<int>({ 1, 2, 3 }))
+            std::cout << "Test 12-2 passed.\n";
+        else
+            std::cout << "Test 12-2 failed. The members weren't balanced by their predicted times.\n";
+    }
+
+    // The phases of the periods with an LCM over RunPeriodTracker::MAX_BALANCING_ITERATIONS are still valid.
+    {
+        Report report;
+        const int frames_count = 80;
+        std::vector<LoopScheduler::ParallelGroupMember> members;
+        members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<PeriodicModule>(0.001, report, "Period31"), 0, LoopScheduler::RunPeriod(31)));
+        members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<PeriodicModule>(0.001, report, "Period37"), 0, LoopScheduler::RunPeriod(37)));
+        members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<StoppingModule>(frames_count)));
+        std::shared_ptr<LoopScheduler::ParallelGroup> group(new LoopScheduler::ParallelGroup(members));
+        {
+            LoopScheduler::Loop loop(group);
+            loop.Run(2);
+        }
+        if (IsRunEvery(report.GetFrames("Period31"), 31, frames_count) && IsRunEvery(report.GetFrames("Period37"), 37, frames_count))
+            std::cout << "Test 12-3 passed.\n";
+        else
+            std::cout << "Test 12-3 failed. A member with a long period didn't run on 1 of every period iterations.\n";
+    }
+
+    // A time period runs about once per period in a wall-clock window, and skips the runs missed in a stall.
+    {
+        Report report;
+        const double period = 0.01;
+        const double stall_time = 0.05;
+        std::vector<LoopScheduler::ParallelGroupMember> members;
+        members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<PeriodicModule>(0.001, report, "Timed"), 0, LoopScheduler::RunPeriod(1, period)));
+        members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<SleepingModule>(0.002, report, "Frame")));
+        members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<SleepingModule>(stall_time, report, "Stall"), 0, LoopScheduler::RunPeriod(1000, 0, 20)));
+        members.push_back(LoopScheduler::ParallelGroupMember(std::make_shared<StoppingModule>(100)));
+        std::shared_ptr<LoopScheduler::ParallelGroup> group(new LoopScheduler::ParallelGroup(members));
+        auto start = std::chrono::steady_clock::now();
+        {
+            // 1 thread, for the stall to hold back the next iterations.
+            LoopScheduler::Loop loop(group);
+            loop.Run(1);
+        }
+        double window = ((std::chrono::duration<double>)(std::chrono::steady_clock::now() - start)).count();
+
+        int count = report.GetFrames("Timed").size();
+        int max_count = (int)(window / period) + 1;
+        int min_count = (int)((window - stall_time) / period) - 2;
+        std::cout << "The time period ran " << count << " times in " << window << "s.\n";
+        if (count >= min_count && count <= max_count)
+            std::cout << "Test 12-4 passed.\n";
+        else
+            std::cout << "Test 12-4 failed. Expected " << min_count << "-" << max_count << " runs.\n";
+        // The missed runs would run on the iterations right after the stall if they were caught up.
+        if (report.GetShortestTimeBetweenRuns("Timed") >= period / 2)
+            std::cout << "Test 12-5 passed.\n";
+        else
+            std::cout << "Test 12-5 failed. The runs missed in the stall were caught up.\n";
+    }
+}
+
 int main()
 {
     std::cout << "1: Run test1. A test to showcase some features.\n";
     std::cout << "2: Run test2. Tests whether adding 1 module to 2 groups throws an exception.\n";
+    std::cout << "3: Run test1 with budget packing to fill the idling time windows.\n";
+    std::cout << "4: Run test4. Tests passing items between modules through channels.\n";
+    std::cout << "5: Run test5. Tests DependencyGroup's ordering and its cycle rejection.\n";
+    std::cout << "6: Run test6. Tests suspending CoroutineModule runs across iterations.\n";
+    std::cout << "7: Run test7. Tests QuantileTimeSpanPredictor's predictions on known observations.\n";
+    std::cout << "8: Run test8. Tests whether budget packing runs the longest fitting modules first while idling.\n";
+    std::cout << "9: Run test9. Tests whether a running PriorityGroup deadline member lets a lower-priority member run beside it.\n";
+    std::cout << "10: Run test10. Tests whether Module::ParallelFor runs each index exactly once with several threads.\n";
+    std::cout << "11: Run test11. Tests whether a pipelined group below the root finishes its started iterations before the loop stops.\n";
+    std::cout << "12: Run test12. Tests the run periods' automatic phases and their time periods.\n";
     std::cout << "c: Create and run a custom test.\n";
-    std::cout << "Enter 1, 2, or c: ";
+    std::cout << "Enter 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, or c: ";
     std::string input;
     std::cin >> input;
     if (input == "1")
-        test1();
+        test1(false);
+    else if (input == "3")
+        test1(true);
     else if (input == "2")
         test2();
+    else if (input == "4")
+        test4();
+    else if (input == "5")
+        test5();
+    else if (input == "6")
+        test6();
+    else if (input == "7")
+        test7();
+    else if (input == "8")
+        test8();
+    else if (input == "9")
+        test9();
+    else if (input == "10")
+        test10();
+    else if (input == "11")
+        test11();
+    else if (input == "12")
+        test12();
     else if (input == "c")
         test_custom();
     return 0;
@@ -68,6 +68,7 @@ int main()
     int total_work_amount;
     int test_repeats;
     int test_module_repeats;
+    int executor;
     std::cout << "Enter the number of threads/modules: ";
     std::cin >> count;
     if (count > std::thread::hardware_concurrency() && count % std::thread::hardware_concurrency() == 0)
@@ -85,6 +86,8 @@ int main()
     std::cin >> test_repeats;
     std::cout << "Enter the number of repeats for the test module used to estimate the work amount time: ";
     std::cin >> test_module_repeats;
+    std::cout << "Enter the loop executor (0: default, 1: work-stealing): ";
+    std::cin >> executor;
 
     if (count < 1)
     {
@@ -123,7 +126,10 @@ int main()
                 )
             );
         }
-        LoopScheduler::Loop loop(std::shared_ptr<LoopScheduler::Group>(new LoopScheduler::ParallelGroup(members)));
+        LoopScheduler::Loop loop(
+            std::shared_ptr<LoopScheduler::Group>(new LoopScheduler::ParallelGroup(members)),
+            executor == 1 ? LoopScheduler::Loop::WorkStealingExecutor : LoopScheduler::Loop::DefaultExecutor
+        );
 
         auto start = std::chrono::steady_clock::now();
         loop.Run(count < std::thread::hardware_concurrency() ? count : std::thread::hardware_concurrency());
@@ -0,0 +1,148 @@
+// clang++ ../LoopScheduler/*.cpp policy_evaluation.cpp -o Build/policy_evaluation --std=c++20 -pthread && ./Build/policy_evaluation
+// Evaluates the scheduling policies of a ParallelGroup with modules of different work amounts.
+
+#include "../LoopScheduler/LoopScheduler.h"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+void WorkUnit()
+{
+    for (int i = 0; i < 100; i++);
+}
+
+void Work(int WorkAmount)
+{
+    for (int i = 0; i < WorkAmount; i++)
+        WorkUnit();
+}
+
+class WorkingModule : public LoopScheduler::Module
+{
+public:
+    WorkingModule(int WorkAmount);
+protected:
+    virtual void OnRun() override;
+    int WorkAmount;
+};
+
+WorkingModule::WorkingModule(int WorkAmount)
+    : WorkAmount(WorkAmount)
+{}
+
+void WorkingModule::OnRun()
+{
+    Work(WorkAmount);
+}
+
+class StopperWorkingModule : public LoopScheduler::Module
+{
+public:
+    StopperWorkingModule(int WorkAmount, int IterationsCountLimit);
+protected:
+    virtual void OnRun() override;
+    int WorkAmount;
+    int IterationsCount;
+    int IterationsCountLimit;
+};
+
+StopperWorkingModule::StopperWorkingModule(int WorkAmount, int IterationsCountLimit)
+    : WorkAmount(WorkAmount), IterationsCount(0), IterationsCountLimit(IterationsCountLimit)
+{}
+
+void StopperWorkingModule::OnRun()
+{
+    IterationsCount++;
+    Work(WorkAmount);
+    if (IterationsCount >= IterationsCountLimit) // Will stop after this iteration
+        GetLoop()->Stop();
+}
+
+int main()
+{
+    int threads_count;
+    int short_modules_count;
+    int short_work_amount;
+    int long_work_amount;
+    int iterations_count;
+    int test_repeats;
+    std::cout << "Enter the number of threads: ";
+    std::cin >> threads_count;
+    std::cout << "Enter the number of short modules: ";
+    std::cin >> short_modules_count;
+    std::cout << "Enter the work amount for short modules on each iteration: ";
+    std::cin >> short_work_amount;
+    std::cout << "Enter the work amount for the long module on each iteration, it's the last member: ";
+    std::cin >> long_work_amount;
+    std::cout << "Enter the number of iterations on each test: ";
+    std::cin >> iterations_count;
+    std::cout << "Enter the number of test repeats: ";
+    std::cin >> test_repeats;
+
+    if (threads_count < 1 || short_modules_count < 1)
+    {
+        std::cout << "Threads and short modules count can't be 0 or less.\n";
+        return 0;
+    }
+
+    std::cout << "\npolicy,"
+              << "iterations_count,"
+              << "loopscheduler_time,"
+              << "loopscheduler_iterations_per_second\n";
+
+    for (int repeat_number = 0; repeat_number < test_repeats; repeat_number++)
+    {
+        for (int policy_number = 0; policy_number < 2; policy_number++)
+        {
+            std::vector<LoopScheduler::ParallelGroupMember> members;
+            members.push_back(
+                LoopScheduler::ParallelGroupMember(
+                    std::shared_ptr<LoopScheduler::Module>(
+                        new StopperWorkingModule(short_work_amount, iterations_count)
+                    )
+                )
+            );
+            for (int i = 1; i < short_modules_count; i++)
+            {
+                members.push_back(
+                    LoopScheduler::ParallelGroupMember(
+                        std::shared_ptr<LoopScheduler::Module>(
+                            new WorkingModule(short_work_amount)
+                        )
+                    )
+                );
+            }
+            members.push_back(
+                LoopScheduler::ParallelGroupMember(
+                    std::shared_ptr<LoopScheduler::Module>(
+                        new WorkingModule(long_work_amount)
+                    )
+                )
+            );
+            std::shared_ptr<LoopScheduler::SchedulingPolicy> policy = nullptr;
+            if (policy_number == 1)
+                policy = std::shared_ptr<LoopScheduler::SchedulingPolicy>(
+                    new LoopScheduler::LongestFirstSchedulingPolicy()
+                );
+            LoopScheduler::Loop loop(
+                std::shared_ptr<LoopScheduler::Group>(
+                    new LoopScheduler::ParallelGroup(members, false, nullptr, nullptr, nullptr, policy)
+                )
+            );
+
+            auto start = std::chrono::steady_clock::now();
+            loop.Run(threads_count);
+            auto stop = std::chrono::steady_clock::now();
+
+            std::chrono::duration<double> loop_scheduler_duration = stop - start;
+
+            std::cout << (policy_number == 0 ? "members_order" : "longest_first") << ',' // policy
+                      << iterations_count << ',' // iterations_count
+                      << loop_scheduler_duration.count() << ',' // loopscheduler_time
+                      << iterations_count / loop_scheduler_duration.count() << '\n'; // loopscheduler_iterations_per_second
+        }
+    }
+
+    return 0;
+}